@@ -0,0 +1,65 @@
+#include "baud_switch.h"
+
+void baud_switch_init(baud_switch_t *b, uint32_t rate)
+{
+    b->state = BAUD_SWITCH_IDLE;
+    b->rate = rate;
+    b->pending = rate;
+    b->start_ms = 0;
+}
+
+bool baud_switch_valid(uint32_t rate)
+{
+    return rate >= BAUD_SWITCH_MIN && rate <= BAUD_SWITCH_MAX;
+}
+
+baud_switch_result_t baud_switch_request(baud_switch_t *b, uint32_t rate)
+{
+    switch (b->state)
+    {
+    case BAUD_SWITCH_IDLE:
+        if (!baud_switch_valid(rate))
+        {
+            return BAUD_SWITCH_INVALID;
+        }
+        b->pending = rate;
+        b->state = BAUD_SWITCH_REQUESTED;
+        return BAUD_SWITCH_ACCEPTED;
+
+    case BAUD_SWITCH_PENDING:
+        if (rate != b->pending)
+        {
+            return BAUD_SWITCH_INVALID;
+        }
+        b->rate = rate;
+        b->state = BAUD_SWITCH_IDLE;
+        return BAUD_SWITCH_COMMITTED;
+
+    default:
+        return BAUD_SWITCH_INVALID;
+    }
+}
+
+bool baud_switch_start(baud_switch_t *b, uint32_t now_ms)
+{
+    if (b->state != BAUD_SWITCH_REQUESTED)
+    {
+        return false;
+    }
+
+    b->state = BAUD_SWITCH_PENDING;
+    b->start_ms = now_ms;
+    return true;
+}
+
+bool baud_switch_timeout(baud_switch_t *b, uint32_t now_ms)
+{
+    if (b->state != BAUD_SWITCH_PENDING || now_ms - b->start_ms < BAUD_SWITCH_TIMEOUT_MS)
+    {
+        return false;
+    }
+
+    b->pending = b->rate;
+    b->state = BAUD_SWITCH_IDLE;
+    return true;
+}
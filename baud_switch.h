@@ -0,0 +1,66 @@
+#ifndef _BAUD_SWITCH_H_
+#define _BAUD_SWITCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BAUD_SWITCH_MIN 9600
+#define BAUD_SWITCH_MAX 7812500        // clk_peri 125 MHz / 16
+#define BAUD_SWITCH_TIMEOUT_MS 1000    // time for the host's probe at the new rate
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        BAUD_SWITCH_IDLE = 0,
+        BAUD_SWITCH_REQUESTED, // accepted, the UART changes once the reply is out
+        BAUD_SWITCH_PENDING,   // running at the new rate, waiting for the probe
+    } baud_switch_state_t;
+
+    typedef enum
+    {
+        BAUD_SWITCH_INVALID = 0, // rate out of range, or a switch is already under way
+        BAUD_SWITCH_ACCEPTED,    // reply at the current rate, then switch
+        BAUD_SWITCH_COMMITTED,   // probe received at the new rate, it stays
+    } baud_switch_result_t;
+
+    // Two-phase change of the command channel's baud rate:
+    //
+    //   host: baud,<rate>        device: baud,<rate>,switch   (old rate)
+    //   both switch, host: baud,<rate> again                  (new rate)
+    //                            device: baud,<rate>,ok       (new rate)
+    //
+    // Without the probe, BAUD_SWITCH_TIMEOUT_MS after the switch the device
+    // goes back to the old rate and says baud,<old>,revert, so a rate the
+    // link cannot carry never locks the host out.
+    typedef struct
+    {
+        uint8_t state;
+        uint32_t rate;     // rate in use, or the one to revert to
+        uint32_t pending;  // rate being tried
+        uint32_t start_ms; // when the UART switched to pending
+    } baud_switch_t;
+
+    void baud_switch_init(baud_switch_t *b, uint32_t rate);
+
+    bool baud_switch_valid(uint32_t rate);
+
+    // baud,<rate> received at the current rate
+    baud_switch_result_t baud_switch_request(baud_switch_t *b, uint32_t rate);
+
+    // Call after the reply to an accepted request went out. Return true if
+    // the UART has to be set to b->pending now
+    bool baud_switch_start(baud_switch_t *b, uint32_t now_ms);
+
+    // Return true if the probe did not come in time and the UART has to go
+    // back to b->rate
+    bool baud_switch_timeout(baud_switch_t *b, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BAUD_SWITCH_H_ */
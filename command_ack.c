@@ -0,0 +1,69 @@
+#include "command_ack.h"
+#include "text_out.h"
+
+void command_ack_init(command_ack_t *a)
+{
+    a->enabled = false;
+    a->acked = 0;
+    a->nacked = 0;
+}
+
+bool command_ack_parse_seq(char const *line, uint8_t *seq, char const **command)
+{
+    uint16_t value = 0;
+    uint8_t digits = 0;
+
+    while (line[digits] >= '0' && line[digits] <= '9')
+    {
+        value = (uint16_t)(value * 10 + (uint16_t)(line[digits] - '0'));
+        if (++digits > 3)
+        {
+            return false;
+        }
+    }
+
+    if (digits == 0 || value > UINT8_MAX || line[digits] != ':')
+    {
+        return false;
+    }
+
+    *seq = (uint8_t)value;
+    *command = line + digits + 1;
+    return true;
+}
+
+uint8_t command_ack_credits(uint16_t queue_free, uint16_t typer_free, uint16_t ring_free)
+{
+    uint16_t const typer_credits = typer_free / COMMAND_ACK_CREDIT_CHARS;
+    uint16_t const ring_credits = ring_free / COMMAND_ACK_CREDIT_BYTES;
+    uint16_t credits = queue_free < typer_credits ? queue_free : typer_credits;
+
+    credits = credits < ring_credits ? credits : ring_credits;
+
+    return credits > UINT8_MAX ? UINT8_MAX : (uint8_t)credits;
+}
+
+bool command_ack_reply(command_ack_t *a, bool ok, uint8_t seq, uint8_t credits, char *buf, uint16_t size)
+{
+    text_out_t out;
+    text_out_init(&out, buf, size);
+
+    if (!a->enabled)
+    {
+        return false;
+    }
+
+    if (ok)
+    {
+        a->acked++;
+    }
+    else
+    {
+        a->nacked++;
+    }
+
+    text_out_field(&out, ok ? "ack," : "nak,", seq);
+    text_out_field(&out, ",", credits);
+    text_out_str(&out, "\n");
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef _COMMAND_ACK_H_
+#define _COMMAND_ACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COMMAND_ACK_CREDIT_BYTES 64 // RX ring space one credit stands for
+#define COMMAND_ACK_CREDIT_CHARS 32 // typer space one credit stands for, a type frame's text
+#define COMMAND_ACK_REPLY_SIZE 16   // longest reply line, "nak,255,255\n", and the NUL
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Acknowledge mode of the command channel. While enabled the received bytes
+    // are no longer echoed; every command that carries a sequence number (text
+    // "<seq>:<command>", frame opcode | FRAME_OP_SEQ with seq as first payload
+    // byte) is answered with one line instead:
+    //
+    //   ack,<seq>,<credits>   command executed
+    //   nak,<seq>,<credits>   command unknown or invalid, or a report was
+    //                         dropped or coalesced while executing it
+    //
+    // A scheduled command is answered when it is queued, what happens when it
+    // runs is only counted in command_schedule_t.failed.
+    //
+    // credits is how many more credits the commands the host has in flight
+    // (sent after this one, not answered yet) may cost without overrunning
+    // the device: free slots on the fullest report queue, 0 while a COALESCE
+    // queue holds a report in its overflow slot, limited by the free typer
+    // space in units of COMMAND_ACK_CREDIT_CHARS and the free RX ring space in
+    // units of COMMAND_ACK_CREDIT_BYTES. Clicks and keystrokes cost two, type
+    // one per COMMAND_ACK_CREDIT_CHARS characters or part of them, every other
+    // command one. "<seq>:ack,0" turns the mode off and is not answered.
+    typedef struct
+    {
+        bool enabled;
+
+        uint32_t acked;  // ack replies sent
+        uint32_t nacked; // nak replies sent
+    } command_ack_t;
+
+    void command_ack_init(command_ack_t *a);
+
+    // Split the "<seq>:" prefix, seq 0..255, off a text command. Return false
+    // and leave seq and command alone if line has none
+    bool command_ack_parse_seq(char const *line, uint8_t *seq, char const **command);
+
+    uint8_t command_ack_credits(uint16_t queue_free, uint16_t typer_free, uint16_t ring_free);
+
+    // Build the reply line for seq into buf and count it. Return false, with
+    // buf empty, if acknowledge mode is off
+    bool command_ack_reply(command_ack_t *a, bool ok, uint8_t seq, uint8_t credits, char *buf, uint16_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COMMAND_ACK_H_ */
@@ -0,0 +1,126 @@
+#include <string.h>
+
+#include "command_frame.h"
+
+enum
+{
+    STATE_IDLE = 0,
+    STATE_OPCODE,
+    STATE_LEN,
+    STATE_PAYLOAD,
+    STATE_CRC,
+};
+
+uint8_t command_frame_crc8(uint8_t crc, void const *data, size_t len)
+{
+    uint8_t const *p = (uint8_t const *)data;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+void command_frame_reset(command_frame_parser_t *parser)
+{
+    parser->state = STATE_IDLE;
+    parser->len = 0;
+    parser->index = 0;
+    parser->crc = 0;
+}
+
+bool command_frame_busy(command_frame_parser_t const *parser)
+{
+    return parser->state != STATE_IDLE;
+}
+
+bool command_frame_expire(command_frame_parser_t *parser, uint32_t idle_ms)
+{
+    if (parser->state == STATE_IDLE || idle_ms < COMMAND_FRAME_TIMEOUT_MS)
+    {
+        return false;
+    }
+
+    command_frame_reset(parser);
+    return true;
+}
+
+command_frame_result_t command_frame_parse(command_frame_parser_t *parser, uint8_t c)
+{
+    switch (parser->state)
+    {
+    case STATE_IDLE:
+        if (c == START_CHARACTER)
+        {
+            command_frame_reset(parser);
+            parser->state = STATE_OPCODE;
+        }
+        break;
+
+    case STATE_OPCODE:
+        parser->opcode = c;
+        parser->crc = command_frame_crc8(0, &c, 1);
+        parser->state = STATE_LEN;
+        break;
+
+    case STATE_LEN:
+        if (c > COMMAND_FRAME_MAX_PAYLOAD)
+        {
+            command_frame_reset(parser);
+            return COMMAND_FRAME_ERROR;
+        }
+        parser->len = c;
+        parser->crc = command_frame_crc8(parser->crc, &c, 1);
+        parser->state = c ? STATE_PAYLOAD : STATE_CRC;
+        break;
+
+    case STATE_PAYLOAD:
+        parser->payload[parser->index++] = c;
+        if (parser->index == parser->len)
+        {
+            parser->crc = command_frame_crc8(parser->crc, parser->payload, parser->len);
+            parser->state = STATE_CRC;
+        }
+        break;
+
+    case STATE_CRC:
+    {
+        bool const valid = (c == parser->crc);
+        parser->state = STATE_IDLE;
+        return valid ? COMMAND_FRAME_COMPLETE : COMMAND_FRAME_ERROR;
+    }
+
+    default:
+        command_frame_reset(parser);
+        break;
+    }
+
+    return COMMAND_FRAME_PENDING;
+}
+
+uint16_t command_frame_encode(uint8_t opcode, void const *payload, uint8_t len, uint8_t *out, uint16_t out_size)
+{
+    uint16_t const total = (uint16_t)(len + COMMAND_FRAME_OVERHEAD);
+
+    if (len > COMMAND_FRAME_MAX_PAYLOAD || out_size < total)
+    {
+        return 0;
+    }
+
+    out[0] = START_CHARACTER;
+    out[1] = opcode;
+    out[2] = len;
+    if (len)
+    {
+        memcpy(out + 3, payload, len);
+    }
+    out[3 + len] = command_frame_crc8(0, out + 1, (size_t)len + 2);
+
+    return total;
+}
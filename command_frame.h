@@ -0,0 +1,103 @@
+#ifndef _COMMAND_FRAME_H_
+#define _COMMAND_FRAME_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Binary command frame, sent alongside the text commands:
+//
+//   | START_CHARACTER | opcode | len | payload (len bytes) | crc8 |
+//
+// The CRC-8 (poly 0x07, init 0x00) covers opcode, len and payload. Multi-byte
+// payload fields are little endian. A mouse move is 8 bytes on the wire instead
+// of ~20 for "mouse_move,<x>,<y>\n".
+#define START_CHARACTER '~'
+
+#define COMMAND_FRAME_MAX_PAYLOAD 32
+#define COMMAND_FRAME_OVERHEAD 4 // start + opcode + len + crc
+#define COMMAND_FRAME_MAX_SIZE (COMMAND_FRAME_MAX_PAYLOAD + COMMAND_FRAME_OVERHEAD)
+
+// A frame whose bytes stop for this long lost one on the way: drop it, so the
+// length byte does not swallow the text commands that follow
+#define COMMAND_FRAME_TIMEOUT_MS 10
+
+    // Opcodes mirror the text commands handled by process_command()
+    enum
+    {
+        FRAME_OP_MOUSE_MOVE = 0x01,         // int16 x, int16 y
+        FRAME_OP_MOUSE_CLICK = 0x02,        // uint8 button
+        FRAME_OP_MOUSE_PRESS = 0x03,        // uint8 button
+        FRAME_OP_MOUSE_RELEASE = 0x04,      // no payload
+        FRAME_OP_MOUSE_REL_MOVE = 0x05,     // int16 dx, int16 dy
+        FRAME_OP_MOUSE_REL_CLICK = 0x06,    // uint8 button
+        FRAME_OP_MOUSE_REL_PRESS = 0x07,    // uint8 button
+        FRAME_OP_MOUSE_REL_RELEASE = 0x08,  // no payload
+        FRAME_OP_MOUSE_PATH = 0x09,         // int16 x0, y0, x1, y1, uint16 duration_ms, uint8 easing, 0..2 x int16 cx, cy
+        FRAME_OP_MOUSE_REL_PATH = 0x0A,     // int16 dx, dy, uint16 duration_ms, uint8 easing, 0..2 x int16 cx, cy
+        FRAME_OP_KEYBOARD_KEYSTROKE = 0x10, // uint8 keycode
+        FRAME_OP_KEYBOARD_PRESS = 0x11,     // uint8 keycode
+        FRAME_OP_KEYBOARD_RELEASE = 0x12,   // uint8 keycode, or no payload to release all
+        FRAME_OP_KEYBOARD_TYPE = 0x13,      // text to type, ASCII/UTF-8
+        FRAME_OP_KEYBOARD_LEDS = 0x14,      // no payload, answered with led,<bits>
+        FRAME_OP_ACK_MODE = 0x15,           // uint8 1 to enable acknowledge mode, 0 to disable
+        FRAME_OP_BAUD = 0x16,               // uint32 rate to switch to or probe, see baud_switch.h; no payload to print it
+        FRAME_OP_BAUD_SAVE = 0x17,          // no payload, keep the current rate as power up default
+        FRAME_OP_FRAME = 0x18,              // no payload, answered with frame,<USB frame count>
+    };
+
+// Set on any opcode: the first payload byte is a sequence number and the rest
+// the opcode's payload, answered in acknowledge mode (see command_ack.h)
+#define FRAME_OP_SEQ 0x80
+
+// Set on any opcode: the payload starts with the uint32 USB frame count the
+// command is scheduled for (see command_schedule.h), after the sequence number
+#define FRAME_OP_AT 0x40
+
+    typedef enum
+    {
+        COMMAND_FRAME_PENDING = 0, // need more bytes
+        COMMAND_FRAME_COMPLETE,    // a valid frame is available in the parser
+        COMMAND_FRAME_ERROR,       // bad length or crc, frame discarded
+    } command_frame_result_t;
+
+    typedef struct
+    {
+        uint8_t state;
+        uint8_t opcode;
+        uint8_t len;
+        uint8_t index;
+        uint8_t crc;
+        uint8_t payload[COMMAND_FRAME_MAX_PAYLOAD];
+    } command_frame_parser_t;
+
+    // Reset parser to wait for the next START_CHARACTER
+    void command_frame_reset(command_frame_parser_t *parser);
+
+    // True while the parser is in the middle of a frame
+    bool command_frame_busy(command_frame_parser_t const *parser);
+
+    // Call while no bytes arrive, with how long the line has been idle. Drops
+    // a partial frame after COMMAND_FRAME_TIMEOUT_MS, return true if it did
+    bool command_frame_expire(command_frame_parser_t *parser, uint32_t idle_ms);
+
+    // Feed one received byte. Bytes outside of a frame are ignored until START_CHARACTER.
+    // On COMMAND_FRAME_COMPLETE, opcode/len/payload stay valid until the next call.
+    command_frame_result_t command_frame_parse(command_frame_parser_t *parser, uint8_t c);
+
+    // Encode a frame into out, return number of bytes written or 0 if it does not fit
+    uint16_t command_frame_encode(uint8_t opcode, void const *payload, uint8_t len, uint8_t *out, uint16_t out_size);
+
+    // CRC-8, polynomial 0x07
+    uint8_t command_frame_crc8(uint8_t crc, void const *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COMMAND_FRAME_H_ */
@@ -0,0 +1,113 @@
+#include <string.h>
+
+#include "command_schedule.h"
+
+// Frames until frame, negative once it started. Frame numbers wrap, the
+// difference does not as long as both are within 2^31 frames
+static inline int32_t frames_until(uint32_t frame, uint32_t now)
+{
+    return (int32_t)(frame - now);
+}
+
+void command_schedule_init(command_schedule_t *s)
+{
+    s->count = 0;
+    s->scheduled = 0;
+    s->released = 0;
+    s->late = 0;
+    s->rejected = 0;
+    s->failed = 0;
+}
+
+void command_schedule_clear(command_schedule_t *s)
+{
+    s->count = 0;
+}
+
+bool command_schedule_parse(char const *line, uint32_t now, uint32_t *frame, char const **command)
+{
+    char const *p = line + 1;
+    uint32_t value = 0;
+
+    if (line[0] != '@' && line[0] != '+')
+    {
+        return false;
+    }
+
+    // 10 digits hold any uint32, more can only be garbage
+    while (*p >= '0' && *p <= '9' && p - line <= 10)
+    {
+        value = value * 10 + (uint32_t)(*p++ - '0');
+    }
+
+    if (p == line + 1 || *p != ':')
+    {
+        return false;
+    }
+
+    *frame = line[0] == '@' ? value : now + value;
+    *command = p + 1;
+    return true;
+}
+
+bool command_schedule_add(command_schedule_t *s, uint32_t now, uint32_t frame, uint8_t opcode, void const *data,
+                          uint8_t len)
+{
+    int32_t const ahead = frames_until(frame, now);
+
+    if (s->count >= COMMAND_SCHEDULE_DEPTH || len > COMMAND_SCHEDULE_DATA_SIZE || ahead > COMMAND_SCHEDULE_MAX_AHEAD)
+    {
+        s->rejected++;
+        return false;
+    }
+
+    if (ahead <= 0)
+    {
+        s->late++;
+    }
+
+    // After every command due on the same frame or earlier
+    uint8_t i = s->count;
+    while (i > 0 && frames_until(s->item[i - 1].frame, frame) > 0)
+    {
+        i--;
+    }
+    memmove(&s->item[i + 1], &s->item[i], (s->count - i) * sizeof(s->item[0]));
+
+    command_schedule_item_t *item = &s->item[i];
+    item->frame = frame;
+    item->opcode = opcode;
+    item->len = len;
+    memcpy(item->data, data, len);
+    item->data[len] = 0;
+
+    s->count++;
+    s->scheduled++;
+    return true;
+}
+
+bool command_schedule_pop(command_schedule_t *s, uint32_t now, command_schedule_item_t *out)
+{
+    if (s->count == 0 || frames_until(s->item[0].frame, now) > 0)
+    {
+        return false;
+    }
+
+    *out = s->item[0];
+    s->count--;
+    memmove(&s->item[0], &s->item[1], s->count * sizeof(s->item[0]));
+    s->released++;
+    return true;
+}
+
+uint32_t command_schedule_frames_between(uint16_t last, uint16_t number, uint32_t elapsed_ms)
+{
+    uint32_t const frames = (uint16_t)(number - last) & 0x7FF;
+
+    if (elapsed_ms <= frames)
+    {
+        return frames;
+    }
+    // The wrap count that lands closest to elapsed_ms
+    return frames + (elapsed_ms - frames + 1024u) / 2048u * 2048u;
+}
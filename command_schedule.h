@@ -0,0 +1,72 @@
+#ifndef _COMMAND_SCHEDULE_H_
+#define _COMMAND_SCHEDULE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COMMAND_SCHEDULE_DEPTH 32        // commands waiting for their frame
+#define COMMAND_SCHEDULE_DATA_SIZE 48    // longest scheduled command, text or frame payload
+#define COMMAND_SCHEDULE_MAX_AHEAD 60000 // frames (1 min) a command may be scheduled ahead
+#define COMMAND_SCHEDULE_TEXT 0          // opcode of a text command
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // A command held back until its USB frame
+    typedef struct
+    {
+        uint32_t frame;
+        uint8_t opcode; // frame opcode, COMMAND_SCHEDULE_TEXT for a text command
+        uint8_t len;
+        uint8_t data[COMMAND_SCHEDULE_DATA_SIZE + 1]; // frame payload, or the text NUL terminated
+    } command_schedule_item_t;
+
+    // Commands ordered by the frame they are due, so a recorded sequence
+    // plays back on the device's frame clock instead of the UART's timing.
+    // Frames are counted by tud_sof_isr(); commands due on the same frame keep
+    // their arrival order. Filled and released in the main loop, no locking.
+    typedef struct
+    {
+        command_schedule_item_t item[COMMAND_SCHEDULE_DEPTH]; // sorted by frame
+        uint8_t count;
+
+        uint32_t scheduled; // commands queued
+        uint32_t released;  // commands handed back on their frame
+        uint32_t late;      // commands queued for a frame that had already started
+        uint32_t rejected;  // commands not queued: full, too long or too far ahead
+        uint32_t failed;    // released commands that were invalid or lost a report
+                            // when they ran, counted by the caller
+    } command_schedule_t;
+
+    void command_schedule_init(command_schedule_t *s);
+
+    // Drop everything queued, e.g. on unmount. Counters are kept
+    void command_schedule_clear(command_schedule_t *s);
+
+    // Split a "@<frame>:" (absolute) or "+<frames>:" (relative to now) prefix
+    // off a text command. Return false and leave frame and command alone if
+    // line has none
+    bool command_schedule_parse(char const *line, uint32_t now, uint32_t *frame, char const **command);
+
+    // Queue a command for frame, now being the current frame. A frame that
+    // already started is released with the next one and counted late.
+    // Return false if it was rejected
+    bool command_schedule_add(command_schedule_t *s, uint32_t now, uint32_t frame, uint8_t opcode, void const *data,
+                              uint8_t len);
+
+    // Take the first command due at frame now into out. Return false if none is
+    bool command_schedule_pop(command_schedule_t *s, uint32_t now, command_schedule_item_t *out);
+
+    // Frames between SOFs with the 11-bit bus frame numbers last and number,
+    // elapsed_ms apart by the CPU clock: the difference of the numbers plus
+    // the whole 2048 frame wraps elapsed_ms says went by, e.g. while the bus
+    // was suspended. elapsed_ms may be off by up to 1 s
+    uint32_t command_schedule_frames_between(uint16_t last, uint16_t number, uint32_t elapsed_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COMMAND_SCHEDULE_H_ */
@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "command_table.h"
+
+#define SLOT_MASK (COMMAND_TABLE_SLOTS - 1)
+
+// FNV-1a, folded so the low bits see the whole hash
+static uint8_t hash_slot(uint32_t seed, char const *name, size_t len)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return (uint8_t)((h ^ (h >> 16)) & SLOT_MASK);
+}
+
+// Place every name with the given seed, probing on collision. Return true if
+// no name had to probe
+static bool place_all(command_table_t *t, uint32_t seed)
+{
+    bool perfect = true;
+
+    memset(t->slot, 0, sizeof(t->slot));
+    for (uint8_t i = 0; i < t->count; i++)
+    {
+        uint8_t s = hash_slot(seed, t->commands[i].name, strlen(t->commands[i].name));
+        while (t->slot[s])
+        {
+            perfect = false;
+            s = (uint8_t)((s + 1) & SLOT_MASK);
+        }
+        t->slot[s] = (uint8_t)(i + 1);
+    }
+    return perfect;
+}
+
+void command_table_init(command_table_t *t, command_t const *commands, uint8_t count, uint32_t seed)
+{
+    t->commands = commands;
+    t->count = count < COMMAND_TABLE_SLOTS ? count : COMMAND_TABLE_SLOTS - 1;
+    t->seed = seed;
+    t->perfect = place_all(t, seed);
+}
+
+bool command_table_find_seed(command_t const *commands, uint8_t count, uint32_t tries, uint32_t *seed)
+{
+    command_table_t t;
+
+    for (uint32_t s = 0; s < tries; s++)
+    {
+        command_table_init(&t, commands, count, s);
+        if (t.perfect)
+        {
+            *seed = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool name_equal(command_t const *cmd, char const *name, size_t len)
+{
+    return strncmp(cmd->name, name, len) == 0 && cmd->name[len] == '\0';
+}
+
+command_t const *command_table_find(command_table_t const *t, char const *name, size_t len)
+{
+    uint8_t s = hash_slot(t->seed, name, len);
+
+    for (uint8_t probes = 0; probes < COMMAND_TABLE_SLOTS && t->slot[s]; probes++)
+    {
+        command_t const *cmd = &t->commands[t->slot[s] - 1];
+        if (name_equal(cmd, name, len))
+        {
+            return cmd;
+        }
+        if (t->perfect)
+        {
+            break;
+        }
+        s = (uint8_t)((s + 1) & SLOT_MASK);
+    }
+    return NULL;
+}
+
+uint8_t command_parse_ints(char const *s, int16_t *out, uint8_t max)
+{
+    uint8_t n = 0;
+
+    while (n < max)
+    {
+        while (*s == ' ' || *s == '\t')
+        {
+            s++;
+        }
+
+        bool const negative = (*s == '-');
+        if (*s == '-' || *s == '+')
+        {
+            s++;
+        }
+
+        if (*s < '0' || *s > '9')
+        {
+            break;
+        }
+
+        uint32_t value = 0;
+        while (*s >= '0' && *s <= '9')
+        {
+            value = value * 10 + (uint32_t)(*s++ - '0');
+        }
+        out[n++] = (int16_t)(uint16_t)(negative ? 0u - value : value);
+
+        if (*s != ',')
+        {
+            break;
+        }
+        s++;
+    }
+    return n;
+}
+
+bool command_parse_u32(char const *s, uint32_t *out)
+{
+    uint32_t value = 0;
+
+    if (*s == '\0')
+    {
+        return false;
+    }
+
+    for (; *s; s++)
+    {
+        uint32_t const digit = (uint32_t)(*s - '0');
+        if (*s < '0' || *s > '9' || value > (UINT32_MAX - digit) / 10)
+        {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+
+    *out = value;
+    return true;
+}
+
+bool command_table_dispatch(command_table_t const *t, char const *line)
+{
+    char const *comma = strchr(line, ',');
+    size_t const name_len = comma ? (size_t)(comma - line) : strlen(line);
+
+    command_t const *cmd = command_table_find(t, line, name_len);
+    if (!cmd)
+    {
+        return false;
+    }
+
+    command_args_t args;
+    args.count = 0;
+    args.text = comma ? comma + 1 : NULL;
+    args.text_len = comma ? (uint16_t)strlen(comma + 1) : 0;
+
+    if (!comma)
+    {
+        if (cmd->min_args > 0)
+        {
+            return false;
+        }
+    }
+    else if (cmd->max_args != COMMAND_ARGS_TEXT)
+    {
+        uint8_t const max = cmd->max_args < COMMAND_MAX_ARGS ? cmd->max_args : COMMAND_MAX_ARGS;
+        args.count = command_parse_ints(args.text, args.v, max);
+        if (args.count == 0 || args.count < cmd->min_args)
+        {
+            return false;
+        }
+    }
+
+    return cmd->handler(&args);
+}
@@ -0,0 +1,83 @@
+#ifndef _COMMAND_TABLE_H_
+#define _COMMAND_TABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define COMMAND_MAX_ARGS 10       // integer arguments of the longest command (mouse_path)
+#define COMMAND_TABLE_SLOTS 64    // hash slots, a power of 2 above the command count
+#define COMMAND_ARGS_TEXT 0xFF    // max_args of a command taking the rest of the line as text
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Arguments of a text command line "<name>[,<arg>,<arg>...]"
+    typedef struct
+    {
+        int16_t v[COMMAND_MAX_ARGS]; // only the first count are set
+        uint8_t count;               // integers parsed
+        char const *text;            // everything after the first comma, NULL if there is none
+        uint16_t text_len;
+    } command_args_t;
+
+    // Run a command whose arguments match its grammar. Return false if their
+    // values are out of range, the command did nothing
+    typedef bool (*command_handler_t)(command_args_t const *args);
+
+    // A command and its grammar: min_args..max_args integers after the name, or
+    // max_args = COMMAND_ARGS_TEXT for raw text, required with min_args 1.
+    // Commands without arguments take no comma, commands with arguments need
+    // at least one that parses
+    typedef struct
+    {
+        char const *name;
+        command_handler_t handler;
+        uint8_t min_args;
+        uint8_t max_args;
+    } command_t;
+
+    // Lookup table over the command names: with a hash seed that gives every
+    // name its own slot, a lookup is one hash and one compare whatever the
+    // number of commands. The seed is searched on the host and pinned in the
+    // source, not at boot. Under a seed that does not fit the names, colliding
+    // ones fall back to the next free slot.
+    typedef struct
+    {
+        command_t const *commands;
+        uint8_t count;
+        uint32_t seed;
+        bool perfect;                       // no name had to probe
+        uint8_t slot[COMMAND_TABLE_SLOTS];  // command index + 1, 0 = empty
+    } command_table_t;
+
+    void command_table_init(command_table_t *t, command_t const *commands, uint8_t count, uint32_t seed);
+
+    // Search seeds 0..tries-1 for one that gives every name its own slot, the
+    // first one found is stored in seed. Return false if there is none
+    bool command_table_find_seed(command_t const *commands, uint8_t count, uint32_t tries, uint32_t *seed);
+
+    // Command named by the first len bytes of name, NULL if unknown
+    command_t const *command_table_find(command_table_t const *t, char const *name, size_t len);
+
+    // Parse a NUL terminated line and run its command. Return false if the
+    // command is unknown, its arguments do not match the grammar or the
+    // handler rejected them
+    bool command_table_dispatch(command_table_t const *t, char const *line);
+
+    // Parse up to max comma separated decimal integers, with optional sign and
+    // leading spaces, stopping at the first one that does not parse. Values
+    // wrap to int16 like sscanf's %hd. Return the number of values parsed
+    uint8_t command_parse_ints(char const *s, int16_t *out, uint8_t max);
+
+    // Parse a whole string as an unsigned decimal, for values beyond int16
+    // such as baud rates. Return false on anything but digits or overflow
+    bool command_parse_u32(char const *s, uint32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _COMMAND_TABLE_H_ */
@@ -0,0 +1,42 @@
+#ifndef _COMMANDS_H_
+#define _COMMANDS_H_
+
+#include "command_table.h"
+
+// Grammar of the text commands, X(name, min_args, max_args): the command is
+// "<name>" or "<name>,<arg>,...", its handler is cmd_<name>() in main.c.
+// Argument rules are in command_table.h. Adding a command is a line here and
+// its handler; should test_command_table then report that the names collide,
+// pin the seed it prints in PICO_HID_COMMAND_SEED.
+#define PICO_HID_COMMANDS(X)                              \
+    X(mouse_move, 2, 2)              /* x,y */            \
+    X(mouse_rel_move, 2, 2)          /* dx,dy */          \
+    X(mouse_click_left, 0, 0)                             \
+    X(mouse_click_right, 0, 0)                            \
+    X(mouse_press_left, 0, 0)                             \
+    X(mouse_press_right, 0, 0)                            \
+    X(mouse_release, 0, 0)                                \
+    X(mouse_path, 1, 10)             /* x0,y0,x1,y1,duration_ms,easing[,cx,cy[,cx,cy]] */ \
+    X(mouse_rel_click_left, 0, 0)                         \
+    X(mouse_rel_click_right, 0, 0)                        \
+    X(mouse_rel_press_left, 0, 0)                         \
+    X(mouse_rel_press_right, 0, 0)                        \
+    X(mouse_rel_release, 0, 0)                            \
+    X(mouse_rel_path, 1, 8)          /* dx,dy,duration_ms,easing[,cx,cy[,cx,cy]] */ \
+    X(keyboard_keystroke, 1, 1)      /* keycode */        \
+    X(keyboard_press, 1, 1)          /* keycode */        \
+    X(keyboard_release, 0, 1)        /* [keycode], none releases all */ \
+    X(type, 1, COMMAND_ARGS_TEXT)    /* text, commas included */ \
+    X(stats, 0, 0)                                        \
+    X(led, 0, 0)                                          \
+    X(poll_interval, 0, 2)           /* [interface,ms] */ \
+    X(queue_policy, 2, 2)            /* interface,policy */ \
+    X(ack, 1, 1)                     /* 0|1 */           \
+    X(baud, 0, COMMAND_ARGS_TEXT)    /* [rate] */        \
+    X(baud_save, 0, 0)                                    \
+    X(frame, 0, 0)
+
+// Hash seed under which every name above has its own command_table slot
+#define PICO_HID_COMMAND_SEED 421
+
+#endif /* _COMMANDS_H_ */
@@ -0,0 +1,341 @@
+#include <string.h>
+
+#include "hid_reports.h"
+
+static report_queue_t *keyboard_queue;
+static report_queue_t *mouse_queue;
+static mouse_accum_t *mouse_rel;
+static typer_t *typer;
+
+static nkro_state_t keys;                               // Keys held down
+static nkro_state_t prev_keys;                          // Keys of the last report handed to the queue
+static uint8_t keyboard_protocol = HID_PROTOCOL_REPORT; // Boot or report format, selected by the host
+static uint8_t keyboard_leds;                           // LED output report of the host, KEYBOARD_LED_* bits
+
+static uint8_t mouse_buttons;      // Buttons held down
+static uint8_t prev_mouse_buttons; // Buttons of the last report handed to the queue
+static int16_t mouse_x, mouse_y;   // Last absolute position, clicks happen there
+
+static uint8_t mouse_rel_buttons; // Buttons held down on the relative mouse
+
+static mouse_path_t path;         // Trajectory of the absolute mouse
+static mouse_path_t rel_path;     // Trajectory of the relative mouse
+static mouse_point_t rel_path_at; // Relative path position already reported
+
+void hid_reports_init(report_queue_t *keyboard, report_queue_t *mouse, mouse_accum_t *relative, typer_t *text)
+{
+    keyboard_queue = keyboard;
+    mouse_queue = mouse;
+    mouse_rel = relative;
+    typer = text;
+    hid_reports_reset();
+}
+
+void hid_reports_reset(void)
+{
+    nkro_clear(&keys);
+    nkro_clear(&prev_keys);
+    keyboard_protocol = HID_PROTOCOL_REPORT;
+    hid_reports_set_keyboard_leds(0);
+    mouse_buttons = 0;
+    prev_mouse_buttons = 0;
+    mouse_rel_buttons = 0;
+    mouse_path_stop(&path);
+    mouse_path_stop(&rel_path);
+}
+
+// A state change is about to be reported, bring the host back first
+static void wakeup_host(void)
+{
+    if (tud_suspended())
+    {
+        tud_remote_wakeup();
+    }
+}
+
+bool send_mouse_report(uint8_t buttons, int16_t x, int16_t y, int8_t vertical, int8_t horizontal)
+{
+    hid_mouse_report_t *report = report_queue_stage(mouse_queue, 0, sizeof(hid_mouse_report_t));
+    if (!report)
+    {
+        return false;
+    }
+
+    report->buttons = buttons;
+    report->x = x;
+    report->y = y;
+    report->wheel = vertical;
+    report->pan = horizontal;
+
+    return report_queue_commit(mouse_queue, sizeof(hid_mouse_report_t));
+}
+
+//--------------------------------------------------------------------+
+// Keyboard
+//--------------------------------------------------------------------+
+
+// Queue a report of the given key state in the format the host selected,
+// built right in the endpoint buffer when it is idle
+static void keyboard_send(nkro_state_t const *state)
+{
+    if (keyboard_protocol == HID_PROTOCOL_BOOT)
+    {
+        hid_keyboard_report_t *report = report_queue_stage(keyboard_queue, 0, sizeof(hid_keyboard_report_t));
+        if (report)
+        {
+            nkro_boot_report(state, report);
+            report_queue_commit(keyboard_queue, sizeof(hid_keyboard_report_t));
+        }
+    }
+    else
+    {
+        nkro_report_t *report = report_queue_stage(keyboard_queue, 0, sizeof(nkro_report_t));
+        if (report)
+        {
+            nkro_report(state, report);
+            report_queue_commit(keyboard_queue, sizeof(nkro_report_t));
+        }
+    }
+}
+
+// Report the key state if it differs from the last report
+static void keyboard_update(nkro_state_t const *state)
+{
+    if (nkro_equal(state, &prev_keys))
+    {
+        return;
+    }
+
+    wakeup_host();
+    keyboard_send(state);
+    prev_keys = *state;
+}
+
+void hid_reports_set_keyboard_protocol(uint8_t protocol)
+{
+    if (protocol == keyboard_protocol)
+    {
+        return;
+    }
+    keyboard_protocol = protocol;
+
+    // Reports still queued are in the old format, replace them with the current state
+    report_queue_clear(keyboard_queue);
+    keyboard_send(&keys);
+    prev_keys = keys;
+}
+
+bool hid_reports_set_keyboard_leds(uint8_t leds)
+{
+    bool const changed = leds != keyboard_leds;
+
+    keyboard_leds = leds;
+    typer_set_caps_lock(typer, leds & KEYBOARD_LED_CAPSLOCK);
+    return changed;
+}
+
+uint8_t hid_reports_keyboard_leds(void)
+{
+    return keyboard_leds;
+}
+
+void keyboard_keystroke(uint8_t code)
+{
+    // Press and release back to back, the queue keeps both reports in order
+    nkro_state_t stroke = keys;
+    if (nkro_press(&stroke, code))
+    {
+        keyboard_update(&stroke);
+        keyboard_update(&keys);
+    }
+}
+
+void keyboard_press(uint8_t code)
+{
+    if (nkro_press(&keys, code))
+    {
+        keyboard_update(&keys);
+    }
+}
+
+void keyboard_release(uint8_t code)
+{
+    if (nkro_release(&keys, code))
+    {
+        keyboard_update(&keys);
+    }
+}
+
+void keyboard_release_all(void)
+{
+    nkro_clear(&keys);
+    keyboard_update(&keys);
+}
+
+uint16_t keyboard_type(char const *text, uint16_t len)
+{
+    uint16_t const n = typer_write(typer, text, len);
+    keyboard_type_task();
+    return n;
+}
+
+void keyboard_type_task(void)
+{
+    uint8_t modifier, keycode;
+
+    // Typed keys follow the reports already queued, one state per report
+    while (tud_hid_n_ready(keyboard_queue->instance) && report_queue_count(keyboard_queue) == 0 &&
+           typer_next(typer, &modifier, &keycode))
+    {
+        nkro_state_t state = keys;
+        state.modifier |= modifier;
+        if (keycode)
+        {
+            nkro_press(&state, keycode);
+        }
+
+        // A key the user already holds changes nothing, go on with the next one
+        if (!nkro_equal(&state, &prev_keys))
+        {
+            keyboard_update(&state);
+            return;
+        }
+    }
+}
+
+//--------------------------------------------------------------------+
+// Mouse
+//--------------------------------------------------------------------+
+static void mouse_update(uint8_t buttons)
+{
+    if (buttons == prev_mouse_buttons)
+    {
+        return;
+    }
+
+    wakeup_host();
+    send_mouse_report(buttons, mouse_x, mouse_y, 0, 0);
+    prev_mouse_buttons = buttons;
+}
+
+void mouse_click(uint8_t button)
+{
+    mouse_update(mouse_buttons | button);
+    mouse_update(mouse_buttons);
+}
+
+void mouse_press(uint8_t button)
+{
+    mouse_buttons = button;
+    mouse_update(mouse_buttons);
+}
+
+void mouse_release(void)
+{
+    mouse_buttons = 0;
+    mouse_update(mouse_buttons);
+}
+
+void mouse_move(int16_t x, int16_t y)
+{
+    // An explicit position overrides the path
+    mouse_path_stop(&path);
+
+    mouse_x = x;
+    mouse_y = y;
+
+    wakeup_host();
+    send_mouse_report(mouse_buttons, x, y, 0, 0);
+    prev_mouse_buttons = mouse_buttons;
+}
+
+bool mouse_path(mouse_point_t start, mouse_point_t end, mouse_point_t const *controls, uint8_t control_count,
+                uint8_t easing, uint16_t duration_ms, uint32_t now_ms)
+{
+    if (!mouse_path_start(&path, start, end, controls, control_count, easing, duration_ms, now_ms))
+    {
+        return false;
+    }
+
+    mouse_path_task(now_ms);
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Relative mouse
+//--------------------------------------------------------------------+
+void mouse_rel_click(uint8_t button)
+{
+    wakeup_host();
+    mouse_accum_buttons(mouse_rel, mouse_rel_buttons | button);
+    mouse_accum_buttons(mouse_rel, mouse_rel_buttons);
+}
+
+void mouse_rel_press(uint8_t button)
+{
+    wakeup_host();
+    mouse_rel_buttons = button;
+    mouse_accum_buttons(mouse_rel, mouse_rel_buttons);
+}
+
+void mouse_rel_release(void)
+{
+    wakeup_host();
+    mouse_rel_buttons = 0;
+    mouse_accum_buttons(mouse_rel, mouse_rel_buttons);
+}
+
+void mouse_rel_move(int16_t dx, int16_t dy)
+{
+    wakeup_host();
+    mouse_accum_move(mouse_rel, dx, dy);
+}
+
+bool mouse_rel_path(mouse_point_t end, mouse_point_t const *controls, uint8_t control_count, uint8_t easing,
+                    uint16_t duration_ms, uint32_t now_ms)
+{
+    mouse_point_t const origin = {0, 0};
+
+    if (!mouse_path_start(&rel_path, origin, end, controls, control_count, easing, duration_ms, now_ms))
+    {
+        return false;
+    }
+
+    rel_path_at = origin;
+    mouse_path_task(now_ms);
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Paths
+//--------------------------------------------------------------------+
+void mouse_path_task(uint32_t now_ms)
+{
+    mouse_point_t p;
+
+    // One sample per report: only sample when the previous one has left.
+    // A sample that did not move (slow path, same ms) waits for a later call
+    if (mouse_path_active(&path) && tud_hid_n_ready(mouse_queue->instance) && report_queue_count(mouse_queue) == 0 &&
+        mouse_path_next(&path, now_ms, &p) && (p.x != mouse_x || p.y != mouse_y))
+    {
+        mouse_x = p.x;
+        mouse_y = p.y;
+
+        wakeup_host();
+        send_mouse_report(mouse_buttons, mouse_x, mouse_y, 0, 0);
+        prev_mouse_buttons = mouse_buttons;
+    }
+
+    if (mouse_path_active(&rel_path) && tud_hid_n_ready(mouse_rel->instance) && !mouse_accum_pending(mouse_rel) &&
+        mouse_path_next(&rel_path, now_ms, &p) && (p.x != rel_path_at.x || p.y != rel_path_at.y))
+    {
+        // A jump across the whole int16 range needs two moves
+        int32_t const dx = p.x - rel_path_at.x;
+        int32_t const dy = p.y - rel_path_at.y;
+        rel_path_at = p;
+
+        wakeup_host();
+        mouse_accum_move(mouse_rel, (int16_t)(dx / 2), (int16_t)(dy / 2));
+        mouse_accum_move(mouse_rel, (int16_t)(dx - dx / 2), (int16_t)(dy - dy / 2));
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef _HID_REPORTS_H_
+#define _HID_REPORTS_H_
+
+#include "tusb.h"
+#include "report_queue.h"
+#include "mouse_accum.h"
+#include "mouse_path.h"
+#include "nkro.h"
+#include "typer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Keyboard and mouse state driven by the command channel. Every state change
+    // builds a report and hands it to the interface's report queue right away:
+    // it goes out immediately when the endpoint is idle, otherwise from the
+    // transfer complete callback. Nothing waits for a software tick.
+    // The relative mouse sums motion in its accumulator instead of queueing.
+    void hid_reports_init(report_queue_t *keyboard_queue, report_queue_t *mouse_queue, mouse_accum_t *mouse_rel,
+                          typer_t *typer);
+
+    // Forget pressed keys, buttons and the last sent reports, e.g. on unmount
+    void hid_reports_reset(void);
+
+    // Host switched the keyboard between boot (6KRO) and report (NKRO) protocol,
+    // the key state is sent again in the new format
+    void hid_reports_set_keyboard_protocol(uint8_t protocol);
+
+    // Host set the keyboard LEDs (KEYBOARD_LED_* bits) with an output report.
+    // Caps Lock is passed on to the typer. Return true if the LEDs changed
+    bool hid_reports_set_keyboard_leds(uint8_t leds);
+    uint8_t hid_reports_keyboard_leds(void);
+
+    bool send_mouse_report(uint8_t buttons, int16_t x, int16_t y, int8_t vertical, int8_t horizontal);
+
+    void keyboard_keystroke(uint8_t code);
+    void keyboard_press(uint8_t code);
+    void keyboard_release(uint8_t code);
+    void keyboard_release_all(void);
+
+    // Type text, one keyboard report per poll. Return the number of bytes accepted
+    uint16_t keyboard_type(char const *text, uint16_t len);
+
+    // Send the next typed key once the keyboard queue is empty, call from
+    // tud_hid_report_complete_cb() after the queue had its turn
+    void keyboard_type_task(void);
+
+    void mouse_click(uint8_t button);
+    void mouse_press(uint8_t button);
+    void mouse_release(void);
+    void mouse_move(int16_t x, int16_t y);
+
+    // Move the pointer along a path over duration_ms, one sample per report.
+    // Return false if the path parameters are invalid
+    bool mouse_path(mouse_point_t start, mouse_point_t end, mouse_point_t const *controls, uint8_t control_count,
+                    uint8_t easing, uint16_t duration_ms, uint32_t now_ms);
+
+    void mouse_rel_click(uint8_t button);
+    void mouse_rel_press(uint8_t button);
+    void mouse_rel_release(void);
+    void mouse_rel_move(int16_t dx, int16_t dy);
+
+    // Same for the relative mouse, the path starts at 0,0 and control points
+    // are relative to the current position
+    bool mouse_rel_path(mouse_point_t end, mouse_point_t const *controls, uint8_t control_count, uint8_t easing,
+                        uint16_t duration_ms, uint32_t now_ms);
+
+    // Send the next path samples while their endpoints are idle, call from the
+    // main loop and from tud_hid_report_complete_cb()
+    void mouse_path_task(uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HID_REPORTS_H_ */
@@ -1,29 +1,69 @@
 #include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
 
 #include "tusb.h"
 #include "bsp/board_api.h"
 #include "hardware/uart.h"
+#include "hardware/dma.h"
 #include <hardware/gpio.h>
 
+#include "baud_switch.h"
+#include "command_ack.h"
+#include "command_frame.h"
+#include "command_schedule.h"
+#include "command_table.h"
+#include "commands.h"
+#include "rx_ring.h"
+#include "report_queue.h"
+#include "report_snapshot.h"
+#include "hid_reports.h"
+#include "settings.h"
+#include "text_out.h"
+#include "usb_descriptors.h"
+#include "pico_hid.h"
+
 #define UART_ID uart0
-#define BAUD_RATE 115200
+#define BAUD_RATE 115200 // until changed with baud,<rate>, see baud_switch.h
 #define UART_PIN_TX 0
 #define UART_PIN_RX 1
-#define START_CHARACTER '~'
-#define END_CHARACTER '$'
-#define UART_BUFFER_SIZE 50
-
-#define UART_IRQ_HANDLER uart0_irq_handler
+#define UART_BUFFER_SIZE 256 // long enough for a line of text in the type command
+#define RX_RING_SIZE_BITS 10 // room for a full window of acknowledged commands, see command_ack.h
+#define RX_RING_SIZE (1u << RX_RING_SIZE_BITS)
+#define RX_DMA_TRANSFER_COUNT 0xFFFFFFFFu
+#define USB_RECONNECT_DELAY_MS 100 // time detached before enumerating again with a new descriptor
+#define REPORT_QUEUE_DEPTH 16 // reports buffered per HID interface while its endpoint is busy
+#define REPORT_QUEUE_COUNT 2  // keyboard and absolute mouse, the relative mouse accumulates instead
+#define TYPER_BUFFER_SIZE 512 // characters waiting to be typed
 
 char uart_rx_buffer[UART_BUFFER_SIZE];
 int buffer_index = 0;
+command_frame_parser_t frame_parser;
+uint32_t rx_last_ms; // last time command_task() found new bytes
+command_table_t command_table;
+command_ack_t command_ack;
+baud_switch_t baud_switch;
+
+// Commands waiting for their USB frame, and the frame clock they wait on:
+// SOFs counted since power up, extended from the bus's 11-bit frame number.
+// Only tud_sof_isr() writes the clock, a 32-bit load of it is atomic
+command_schedule_t command_schedule;
+volatile uint32_t usb_frame;
+static uint16_t usb_frame_number;
+static volatile bool usb_frame_synced = false;
+static volatile bool usb_frame_suspended = false; // count the suspend in at the next SOF
+static uint32_t usb_suspend_ms;
+
+// Filled by a DMA channel in ring mode, drained by command_task() in the main loop.
+// DMA ring wrapping requires the buffer to be aligned to its size.
+uint8_t rx_ring_buf[RX_RING_SIZE] __attribute__((aligned(RX_RING_SIZE)));
+rx_ring_t rx_ring;
+int rx_dma_chan;
 
 enum
 {
     ITF_KEYBOARD = 0,
-    ITF_MOUSE = 1
+    ITF_MOUSE = 1,
+    ITF_MOUSE_REL = 2
 };
 
 enum
@@ -33,30 +73,57 @@ enum
     BLINK_SUSPENDED = 2500,
 };
 
-#define MAX_KEYS 5 // Maximum number of keys that can be pressed at once
+// Input reports waiting for their IN endpoint, one queue per HID interface
+report_queue_item_t report_queue_buf[REPORT_QUEUE_COUNT][REPORT_QUEUE_DEPTH];
+report_queue_t report_queue[REPORT_QUEUE_COUNT];
 
-struct HID_FORMAT
-{
-    uint8_t keystroke;
-    uint8_t keys_pressed[MAX_KEYS]; // Array representing the list of pressed keys
-    uint8_t key_index;              // Number of keys currently pressed
-    uint8_t button;
-    uint8_t button_pressed;
-};
+// Last report sent on each interface, for GET_REPORT
+report_snapshot_t report_snapshot;
+
+// Relative mouse motion summed while its endpoint is busy
+mouse_accum_t mouse_rel;
 
-struct HID_FORMAT hid_report = {0, {0}, 0, 0, 0};
+// Text from the type command, typed one keyboard report at a time
+uint8_t typer_buf[TYPER_BUFFER_SIZE];
+typer_t typer;
 
 static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
 
+static bool usb_reconnect_pending = false;
+static uint32_t usb_reconnect_start_ms = 0;
+
 void led_blinking_task(void);
-void hid_task();
-void on_uart_rx();
+void uart_rx_dma_init(void);
+void uart_rx_dma_flush(void);
+void command_task(void);
+void baud_switch_task(void);
 void button_debug_task(void);
+void usb_reconnect_task(void);
+void command_schedule_task(void);
+void get_report_reset(void);
+void commands_init(void);
 void process_command(const char *command);
+void print_keyboard_leds(void);
+void print_baud(uint32_t rate, char const *state);
+void print_frame(void);
+void process_frame(const command_frame_parser_t *frame);
+bool execute_frame(uint8_t opcode, uint8_t const *p, uint8_t len);
 
-int main(void)
+// Bring up the board, USB and the command channel
+void pico_hid_init(void)
 {
     board_init();
+
+    // Descriptors depend on the stored settings, apply them before USB starts
+    settings_load();
+    for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+    {
+        if (settings.poll_interval_ms[i])
+        {
+            hid_poll_interval_set(i, settings.poll_interval_ms[i]);
+        }
+    }
+
     tusb_init();
 
     // UART Intialization
@@ -68,10 +135,12 @@ int main(void)
     gpio_set_function(UART_PIN_TX, GPIO_FUNC_UART);
     gpio_set_function(UART_PIN_RX, GPIO_FUNC_UART);
 
-    // Actually, we want a different speed
+    // Actually, we want a different speed, the saved default if there is one.
     // The call will return the actual baud rate selected, which will be as close as
     // possible to that requested
-    uart_set_baudrate(UART_ID, BAUD_RATE);
+    uint32_t const baud_rate = baud_switch_valid(settings.baud_rate) ? settings.baud_rate : BAUD_RATE;
+    uart_set_baudrate(UART_ID, baud_rate);
+    baud_switch_init(&baud_switch, baud_rate);
 
     // Set UART flow control CTS/RTS, we don't want these, so turn them off
     uart_set_hw_flow(UART_ID, false, false);
@@ -79,149 +148,222 @@ int main(void)
     // Set our data format
     uart_set_format(UART_ID, 8, 1, UART_PARITY_NONE);
 
-    // Turn off FIFO's - we want to do this character by character
-    uart_set_fifo_enabled(UART_ID, false);
-
-    // Set up a RX interrupt
-    // We need to set up the handler first
-    // Select correct interrupt for the UART we are using
-    int UART_IRQ = UART_ID == uart0 ? UART0_IRQ : UART1_IRQ;
-
-    // And set up and enable the interrupt handlers
-    irq_set_exclusive_handler(UART_IRQ, on_uart_rx);
-    irq_set_enabled(UART_IRQ, true);
+    // Keep the 32 byte FIFOs on, the DMA drains RX so no per-byte interrupt is needed
+    uart_set_fifo_enabled(UART_ID, true);
 
-    // Now enable the UART to send interrupts - RX only
-    uart_set_irq_enables(UART_ID, true, false);
+    uart_rx_dma_init();
+    command_frame_reset(&frame_parser);
+    buffer_index = 0;
+    rx_last_ms = board_millis();
+    commands_init();
+    command_ack_init(&command_ack);
+    command_schedule_init(&command_schedule);
 
     //-------------------------------------------------------------//
 
+    // Keyboard reports carry state, so keep the latest one on overflow.
+    // For the absolute mouse the newest position matters most.
+    report_queue_init(&report_queue[ITF_KEYBOARD], ITF_KEYBOARD, report_queue_buf[ITF_KEYBOARD], REPORT_QUEUE_DEPTH, REPORT_QUEUE_COALESCE);
+    report_queue_init(&report_queue[ITF_MOUSE], ITF_MOUSE, report_queue_buf[ITF_MOUSE], REPORT_QUEUE_DEPTH, REPORT_QUEUE_DROP_OLDEST);
+    mouse_accum_init(&mouse_rel, ITF_MOUSE_REL);
+    typer_init(&typer, typer_buf, TYPER_BUFFER_SIZE);
+    hid_reports_init(&report_queue[ITF_KEYBOARD], &report_queue[ITF_MOUSE], &mouse_rel, &typer);
+    report_snapshot_init(&report_snapshot);
+    get_report_reset();
+
     tud_init(BOARD_TUD_RHPORT);
 
     uart_puts(UART_ID, "Initialization complete.\n");
+}
+
+// One pass of the main loop
+void pico_hid_task(void)
+{
+    tud_task();
+    command_task();
+    command_schedule_task();
+    baud_switch_task();
+    led_blinking_task();
+    button_debug_task();
+    usb_reconnect_task();
+    mouse_path_task(board_millis());
+}
+
+// The host simulation (sim/) provides its own main() and drives the loop
+#ifndef PICO_HID_SIM
+int main(void)
+{
+    pico_hid_init();
 
     while (1)
     {
-        tud_task();
-        led_blinking_task();
-        hid_task();
-        button_debug_task();
+        pico_hid_task();
     }
     return 0;
 }
+#endif
 
 void tud_mount_cb(void)
 {
     blink_interval_ms = BLINK_MOUNTED;
+
+    // A bus reset puts every interface back in report protocol, e.g. when the
+    // OS takes over from a BIOS that used boot protocol
+    hid_reports_set_keyboard_protocol(HID_PROTOCOL_REPORT);
+    mouse_accum_set_protocol(&mouse_rel, HID_PROTOCOL_REPORT);
+
+    // The frame clock for scheduled commands
+    usb_frame_synced = false;
+    tud_sof_isr_enable(true);
 }
 
 void tud_umount_cb(void)
 {
     blink_interval_ms = BLINK_NOT_MOUNTED;
+
+    for (uint8_t i = 0; i < REPORT_QUEUE_COUNT; i++)
+    {
+        report_queue_clear(&report_queue[i]);
+    }
+    mouse_accum_clear(&mouse_rel);
+    typer_clear(&typer);
+    hid_reports_reset();
+    get_report_reset();
+
+    tud_sof_isr_enable(false);
+    command_schedule_clear(&command_schedule);
 }
 
 void tud_suspend_cb(bool remote_wakeup_en)
 {
     (void)remote_wakeup_en;
     blink_interval_ms = BLINK_SUSPENDED;
+
+    // No SOFs until the resume, 2048 of them or more would go unseen
+    usb_suspend_ms = board_millis();
+    usb_frame_suspended = true;
 }
 
 void tud_resume_cb(void)
 {
     blink_interval_ms = BLINK_MOUNTED;
+
+    // Reports queued while suspended triggered the remote wakeup, send them now
+    for (uint8_t i = 0; i < REPORT_QUEUE_COUNT; i++)
+    {
+        report_queue_complete(&report_queue[i]);
+    }
+    mouse_accum_complete(&mouse_rel);
+    keyboard_type_task();
+    mouse_path_task(board_millis());
 }
 
-void hid_task()
+// Invoked in the USB interrupt on every frame while mounted, only advances the
+// frame clock: nothing is queued for tud_task(), command_schedule_task() finds
+// the commands due. A missed SOF still counts, the bus frame number says how
+// many frames passed; after a suspend the CPU clock adds the wraps of it
+void tud_sof_isr(uint32_t frame_count)
 {
-    const uint32_t interval_ms = 10;
-    static uint32_t start_ms = 0;
-
-    if (board_millis() - start_ms < interval_ms)
-        return; // not enough time
-    start_ms += interval_ms;
+    uint16_t const number = (uint16_t)(frame_count & 0x7FF);
 
-    if (tud_suspended())
+    if (usb_frame_synced && usb_frame_suspended)
     {
-        tud_remote_wakeup();
+        usb_frame += command_schedule_frames_between(usb_frame_number, number, board_millis() - usb_suspend_ms);
     }
-
-    if (tud_hid_n_ready(ITF_KEYBOARD))
+    else if (usb_frame_synced)
     {
-        static uint8_t prev_keycode[6] = {0}; // Array representing the list of pressed keys and the last keystroke
+        usb_frame += (uint16_t)(number - usb_frame_number) & 0x7FF;
+    }
+    usb_frame_suspended = false;
+    usb_frame_number = number;
+    usb_frame_synced = true;
+}
 
-        // Assign hid_report.keys_pressed to the keycode array
-        uint8_t keycode[6] = {0};
-        for (int i = 0; i < hid_report.key_index; i++)
-        {
-            keycode[i] = hid_report.keys_pressed[i];
-        }
-        keycode[hid_report.key_index] = hid_report.keystroke;
-        hid_report.keystroke = 0; // Clear the keystroke
+// Invoked when a report was sent, start the next queued one right away
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    (void)report;
+    (void)len;
 
-        bool report_changed = false;
-        // Check if the report has changed
-        for (int i = 0; i < 6; i++)
-        {
-            if (keycode[i] != prev_keycode[i])
-            {
-                report_changed = true;
-                break;
-            }
-        }
+    if (instance == ITF_MOUSE_REL)
+    {
+        mouse_accum_complete(&mouse_rel);
+    }
+    else
+    {
+        report_queue_complete(&report_queue[instance]);
+    }
 
-        if (report_changed)
-        {
-            tud_hid_n_keyboard_report(ITF_KEYBOARD, 0, 0, keycode);
-            // Update previous report
-            memcpy(prev_keycode, keycode, 6);
-        }
+    if (instance == ITF_KEYBOARD)
+    {
+        keyboard_type_task();
     }
+    else
+    {
+        mouse_path_task(board_millis());
+    }
+}
+
+// Invoked when a report is about to go out, it becomes the one GET_REPORT returns
+void tud_hid_report_commit_cb(uint8_t instance, uint8_t report_id, uint8_t const *report, uint16_t len)
+{
+    report_snapshot_store(&report_snapshot, instance, report_id, report, len);
+}
 
-    if (tud_hid_n_ready(ITF_MOUSE))
+// Answer GET_REPORT with the last input report sent, straight from the
+// snapshot so the interrupt endpoint is left alone. Other report types stall
+uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
+{
+    if (report_type != HID_REPORT_TYPE_INPUT)
     {
-        static uint8_t prev_mouse_button = 0x00;
+        return 0;
+    }
 
-        if (hid_report.button != prev_mouse_button)
-        {
-            tud_hid_n_mouse_report(ITF_MOUSE, 0, hid_report.button, 0, 0, 0, 0);
-            prev_mouse_button = hid_report.button;
-        }
+    return report_snapshot_get(&report_snapshot, itf, report_id, buffer, reqlen);
+}
 
-        if (hid_report.button_pressed == 1)
-        {
-            hid_report.button = MOUSE_BUTTON_LEFT;
-        }
-        else if (hid_report.button_pressed == 2)
-        {
-            hid_report.button = MOUSE_BUTTON_RIGHT;
-        }
-        else
-        {
-            hid_report.button = 0x00;
-        }
+// Invoked when the host selects boot or report protocol, e.g. a BIOS asking for
+// boot. Commands keep working, their reports switch format
+void tud_hid_set_protocol_cb(uint8_t instance, uint8_t protocol)
+{
+    if (instance == ITF_KEYBOARD)
+    {
+        hid_reports_set_keyboard_protocol(protocol);
+    }
+    else if (instance == ITF_MOUSE_REL)
+    {
+        mouse_accum_set_protocol(&mouse_rel, protocol);
     }
 }
 
-uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
+// Keyboard LED output report, by SET_REPORT or on an OUT endpoint (report type
+// invalid). A change is pushed to the command channel as led,<bits>
+void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
 {
-    // TODO not Implemented
-    (void)itf;
     (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)reqlen;
 
-    return 0;
+    if (itf != ITF_KEYBOARD || bufsize < 1 ||
+        (report_type != HID_REPORT_TYPE_OUTPUT && report_type != HID_REPORT_TYPE_INVALID))
+    {
+        return;
+    }
+
+    if (hid_reports_set_keyboard_leds(buffer[0]))
+    {
+        print_keyboard_leds();
+    }
 }
 
-void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
+// Idle reports until the first one is sent, so GET_REPORT has an answer
+// right after enumeration
+void get_report_reset(void)
 {
-    // TODO set LED based on CAPLOCK, NUMLOCK etc...
-    (void)itf;
-    (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)bufsize;
+    static const uint8_t idle[CFG_TUD_HID_EP_BUFSIZE];
+
+    report_snapshot_clear(&report_snapshot);
+    report_snapshot_store(&report_snapshot, ITF_KEYBOARD, 0, idle, sizeof(nkro_report_t));
+    report_snapshot_store(&report_snapshot, ITF_MOUSE, 0, idle, sizeof(hid_mouse_report_t));
+    report_snapshot_store(&report_snapshot, ITF_MOUSE_REL, 0, idle, sizeof(hid_mouse_report_t));
 }
 
 void led_blinking_task(void)
@@ -250,50 +392,117 @@ void button_debug_task(void)
     uint32_t const btn = board_button_read();
     static bool has_key = false;
 
-    // If USB is suspended and a button is pressed, wake up the device
-    if (tud_suspended() && btn)
-    {
-        tud_remote_wakeup();
-    }
-
     // If a button is pressed
     if (btn)
     {
-        // If keyboard HID interface is ready
-        if (tud_hid_n_ready(ITF_KEYBOARD))
-        {
-            uint8_t keycode[6] = {0};
-            keycode[0] = HID_KEY_A; // Sending 'A' key
-            tud_hid_n_keyboard_report(ITF_KEYBOARD, 0, 0, keycode);
-            has_key = true;
-        }
-
-        // If mouse HID interface is ready
-        if (tud_hid_n_ready(ITF_MOUSE))
-        {
-            int8_t pos = 5;
-            tud_hid_n_mouse_report(ITF_MOUSE, 0, 0x00, pos, pos, 0, 0);
-        }
+        // Hold 'A' and move the mouse, both wake up a suspended host
+        keyboard_press(HID_KEY_A);
+        mouse_move(5, 5);
+        has_key = true;
     }
     else
     {
-        // If there was previously a key pressed, send an empty key report
+        // If there was previously a key pressed, release it
         if (has_key)
         {
-            tud_hid_n_keyboard_report(ITF_KEYBOARD, 0, 0, NULL);
+            keyboard_release(HID_KEY_A);
         }
         has_key = false;
     }
 }
 
-void on_uart_rx()
+// Detach from the bus so the host enumerates again and reads the new descriptor
+static void usb_reenumerate(void)
+{
+    tud_disconnect();
+    usb_reconnect_pending = true;
+    usb_reconnect_start_ms = board_millis();
+}
+
+void usb_reconnect_task(void)
+{
+    if (usb_reconnect_pending && board_millis() - usb_reconnect_start_ms >= USB_RECONNECT_DELAY_MS)
+    {
+        usb_reconnect_pending = false;
+        tud_connect();
+    }
+}
+
+// RX DMA: the channel is paced by the UART RX DREQ and writes into rx_ring_buf
+// wrapping at RX_RING_SIZE, so received bytes never cost a CPU interrupt.
+void uart_rx_dma_init(void)
+{
+    rx_ring_init(&rx_ring, rx_ring_buf, RX_RING_SIZE);
+
+    rx_dma_chan = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config(rx_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, RX_RING_SIZE_BITS); // wrap write address
+    channel_config_set_dreq(&c, uart_get_dreq(UART_ID, false));
+
+    rx_ring_dma_start(&rx_ring, RX_DMA_TRANSFER_COUNT);
+    dma_channel_configure(rx_dma_chan, &c, rx_ring_buf, &uart_get_hw(UART_ID)->dr, RX_DMA_TRANSFER_COUNT, true);
+}
+
+// Publish whatever the DMA wrote so far. This runs on every main loop pass
+// instead of waiting for an RX timeout interrupt: with the DMA keeping the
+// UART FIFO empty the PL011 receive timeout never asserts, and polling the
+// transfer count is a single register read.
+void uart_rx_dma_flush(void)
+{
+    uint32_t const remaining = dma_channel_hw_addr(rx_dma_chan)->transfer_count;
+
+    if (rx_ring_dma_update(&rx_ring, remaining))
+    {
+        // Channel ran out of transfers, re-arm it. The write address keeps its ring position
+        dma_channel_set_trans_count(rx_dma_chan, RX_DMA_TRANSFER_COUNT, true);
+    }
+}
+
+void command_task(void)
 {
-    while (uart_is_readable(UART_ID))
+    uint8_t chunk[32];
+    uint16_t count;
+
+    uart_rx_dma_flush();
+
+    // The line is idle once a pass finds nothing new; bytes that piled up
+    // while the loop was busy do not count as a gap
+    if (rx_ring_count(&rx_ring) > 0)
+    {
+        rx_last_ms = board_millis();
+    }
+    else
+    {
+        command_frame_expire(&frame_parser, board_millis() - rx_last_ms);
+    }
+
+    while ((count = rx_ring_read(&rx_ring, chunk, sizeof(chunk))) > 0)
     {
-        char c = uart_getc(UART_ID);
-        if (uart_is_writable(UART_ID))
+        for (uint16_t i = 0; i < count; i++)
         {
-            uart_putc(UART_ID, c);
+            char c = (char)chunk[i];
+
+            // Binary frames start with START_CHARACTER, which never begins a text command
+            if (buffer_index == 0 && (command_frame_busy(&frame_parser) || c == START_CHARACTER))
+            {
+                if (command_frame_parse(&frame_parser, (uint8_t)c) == COMMAND_FRAME_COMPLETE)
+                {
+                    process_frame(&frame_parser);
+                }
+                continue;
+            }
+
+            // Echo is best effort, never block the loop on it. Acknowledge
+            // mode answers whole commands instead
+            if (!command_ack.enabled && uart_is_writable(UART_ID))
+            {
+                uart_putc(UART_ID, c);
+            }
+
             if (c == '\r' || c == '\n' || buffer_index >= UART_BUFFER_SIZE - 1)
             {
                 uart_rx_buffer[buffer_index] = '\0'; // Null-terminate the string
@@ -311,85 +520,744 @@ void on_uart_rx()
         }
     }
 }
-void process_command(const char *command)
+
+// Change the UART rate once the reply to baud,<rate> left at the old one,
+// and go back if the host's probe does not follow in time
+void baud_switch_task(void)
 {
-    if (strcmp(command, "mouse_click_left") == 0)
+    uint32_t const now_ms = board_millis();
+
+    if (baud_switch_start(&baud_switch, now_ms))
     {
-        hid_report.button = MOUSE_BUTTON_LEFT;
-        hid_report.button_pressed = false;
+        uart_tx_wait_blocking(UART_ID);
+        uart_set_baudrate(UART_ID, baud_switch.pending);
     }
-    else if (strcmp(command, "mouse_click_right") == 0)
+    else if (baud_switch_timeout(&baud_switch, now_ms))
     {
-        hid_report.button = MOUSE_BUTTON_RIGHT;
-        hid_report.button_pressed = false;
+        uart_tx_wait_blocking(UART_ID);
+        uart_set_baudrate(UART_ID, baud_switch.rate);
+        print_baud(baud_switch.rate, "revert");
     }
-    else if (strcmp(command, "mouse_press_left") == 0)
+}
+
+//--------------------------------------------------------------------+
+// Commands, HID actions live in hid_reports.c
+//--------------------------------------------------------------------+
+static void print_poll_intervals(void)
+{
+    char line[32];
+    text_out_t out;
+    for (uint8_t i = 0; i < CFG_TUD_HID; i++)
     {
-        hid_report.button_pressed = 1;
+        text_out_init(&out, line, sizeof(line));
+        text_out_field(&out, "poll_interval,", i);
+        text_out_field(&out, ",", hid_poll_interval_get(i));
+        text_out_str(&out, "\n");
+        uart_puts(UART_ID, line);
     }
-    else if (strcmp(command, "mouse_press_right") == 0)
+}
+
+// Return false if the interval does not fit the interface
+static bool set_poll_interval(uint8_t itf, uint8_t interval_ms)
+{
+    if (!hid_poll_interval_set(itf, interval_ms))
     {
-        hid_report.button_pressed = 2;
+        return false;
     }
-    else if (strcmp(command, "mouse_release") == 0)
+
+    // Flash erase stalls the CPU, do it while detached
+    usb_reenumerate();
+    settings.poll_interval_ms[itf] = interval_ms;
+    settings_save();
+    return true;
+}
+
+// Start a path from its fields: x0, y0 (absolute only), x1, y1, duration_ms,
+// easing, then up to two control points. Return false if the fields do not
+// make a path
+static bool start_mouse_path(bool relative, int16_t const *v, uint8_t count)
+{
+    uint8_t const fixed = relative ? 4 : 6;
+
+    if (count < fixed || (count - fixed) % 2 || (count - fixed) / 2 > MOUSE_PATH_MAX_CONTROLS)
     {
-        hid_report.button_pressed = 0;
+        return false;
     }
-    else if (strncmp(command, "mouse_move,", 11) == 0)
+
+    mouse_point_t controls[MOUSE_PATH_MAX_CONTROLS];
+    uint8_t const control_count = (uint8_t)((count - fixed) / 2);
+    for (uint8_t i = 0; i < control_count; i++)
+    {
+        controls[i].x = v[fixed + 2 * i];
+        controls[i].y = v[fixed + 2 * i + 1];
+    }
+
+    uint16_t const duration_ms = (uint16_t)v[fixed - 2];
+    uint8_t const easing = (uint8_t)v[fixed - 1];
+
+    if (relative)
+    {
+        mouse_point_t const end = {v[0], v[1]};
+        return mouse_rel_path(end, controls, control_count, easing, duration_ms, board_millis());
+    }
+
+    mouse_point_t const start = {v[0], v[1]};
+    mouse_point_t const end = {v[2], v[3]};
+    return mouse_path(start, end, controls, control_count, easing, duration_ms, board_millis());
+}
+
+// led,<bits>: KEYBOARD_LED_* bits, 1 Num Lock, 2 Caps Lock, 4 Scroll Lock
+void print_keyboard_leds(void)
+{
+    char line[16];
+    text_out_t out;
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "led,", hid_reports_keyboard_leds());
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+}
+
+// baud,<rate>,<switch|ok|revert|invalid|saved>
+void print_baud(uint32_t rate, char const *state)
+{
+    char line[32];
+    text_out_t out;
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "baud,", rate);
+    text_out_str(&out, ",");
+    text_out_str(&out, state);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+}
+
+// baud,<current>,<power up default>
+static void print_baud_rates(void)
+{
+    char line[32];
+    text_out_t out;
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "baud,", baud_switch.rate);
+    text_out_field(&out, ",", baud_switch_valid(settings.baud_rate) ? settings.baud_rate : BAUD_RATE);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+}
+
+// First baud,<rate> at the old rate switches, the same again at the new rate
+// commits. Return false if the rate is invalid
+static bool baud_request(uint32_t rate)
+{
+    switch (baud_switch_request(&baud_switch, rate))
+    {
+    case BAUD_SWITCH_ACCEPTED:
+        print_baud(rate, "switch");
+        return true;
+
+    case BAUD_SWITCH_COMMITTED:
+        print_baud(rate, "ok");
+        return true;
+
+    default:
+        print_baud(rate, "invalid");
+        return false;
+    }
+}
+
+// Unlike a poll interval the rate is not in the descriptors, the host has
+// nothing to enumerate again, settings_save() runs without detaching
+static void baud_save(void)
+{
+    settings.baud_rate = baud_switch.rate;
+    settings_save();
+    print_baud(baud_switch.rate, "saved");
+}
+
+static void print_stats(void)
+{
+    char line[128];
+    text_out_t out;
+
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "stats,rx=", rx_ring.received);
+    text_out_field(&out, ",rx_overflow=", rx_ring.overflow);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+
+    for (uint8_t i = 0; i < REPORT_QUEUE_COUNT; i++)
+    {
+        report_queue_t *q = &report_queue[i];
+        text_out_init(&out, line, sizeof(line));
+        text_out_field(&out, "queue,", i);
+        text_out_field(&out, ",policy=", q->policy);
+        text_out_field(&out, ",count=", report_queue_count(q));
+        text_out_field(&out, ",sent=", q->sent);
+        text_out_field(&out, ",queued=", q->queued);
+        text_out_field(&out, ",dropped=", q->dropped);
+        text_out_field(&out, ",coalesced=", q->coalesced);
+        text_out_str(&out, "\n");
+        uart_puts(UART_ID, line);
+    }
+
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "type,pending=", tu_fifo_count(&typer.ff));
+    text_out_field(&out, ",typed=", typer.typed);
+    text_out_field(&out, ",skipped=", typer.skipped);
+    text_out_field(&out, ",overflow=", typer.overflow);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "mouse_rel,", ITF_MOUSE_REL);
+    text_out_field(&out, ",reports=", mouse_rel.reports);
+    text_out_field(&out, ",merged=", mouse_rel.merged);
+    text_out_field(&out, ",splits=", mouse_rel.splits);
+    text_out_field(&out, ",dropped=", mouse_rel.dropped);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "ack,enabled=", command_ack.enabled);
+    text_out_field(&out, ",acked=", command_ack.acked);
+    text_out_field(&out, ",nacked=", command_ack.nacked);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "schedule,count=", command_schedule.count);
+    text_out_field(&out, ",scheduled=", command_schedule.scheduled);
+    text_out_field(&out, ",released=", command_schedule.released);
+    text_out_field(&out, ",late=", command_schedule.late);
+    text_out_field(&out, ",rejected=", command_schedule.rejected);
+    text_out_field(&out, ",failed=", command_schedule.failed);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+}
+
+// frame,<USB frame count>, the clock scheduled commands are timed on
+void print_frame(void)
+{
+    char line[24];
+    text_out_t out;
+    text_out_init(&out, line, sizeof(line));
+    text_out_field(&out, "frame,", usb_frame);
+    text_out_str(&out, "\n");
+    uart_puts(UART_ID, line);
+}
+
+// Hold a command back until frame. Without SOFs it would never run, so
+// nothing is scheduled while unmounted
+static bool schedule_command(uint32_t frame, uint8_t opcode, void const *data, size_t len)
+{
+    return tud_mounted() &&
+           command_schedule_add(&command_schedule, usb_frame, frame, opcode, data, (uint8_t)tu_min32(len, UINT8_MAX));
+}
+
+// Reports lost so far, a command that raises this is answered with nak
+static uint32_t command_losses(void)
+{
+    uint32_t losses = typer.overflow + mouse_rel.dropped;
+    for (uint8_t i = 0; i < REPORT_QUEUE_COUNT; i++)
+    {
+        // A report overwritten in the COALESCE slot never reaches the host either
+        losses += report_queue[i].dropped + report_queue[i].coalesced;
+    }
+    return losses;
+}
+
+// Run the scheduled commands due by the frame clock, from the main loop like
+// every other command. Their answer went out when they were queued, what
+// goes wrong now only shows in the failed count
+void command_schedule_task(void)
+{
+    uint32_t const now = usb_frame;
+    command_schedule_item_t item;
+
+    while (command_schedule_pop(&command_schedule, now, &item))
     {
-        // Parse mouse move command
-        int16_t dx, dy;
-        if (sscanf(command + 11, "%hd,%hd", &dx, &dy) == 2)
+        uint32_t const losses = command_losses();
+        bool ok;
+
+        if (item.opcode == COMMAND_SCHEDULE_TEXT)
+        {
+            ok = command_table_dispatch(&command_table, (char const *)item.data);
+        }
+        else
+        {
+            ok = execute_frame(item.opcode, item.data, item.len);
+        }
+
+        if (!ok || command_losses() != losses)
         {
-            tud_hid_n_mouse_report(ITF_MOUSE, 0, 0, dx, dy, 0, 0);
+            command_schedule.failed++;
         }
     }
-    else if (strncmp(command, "keyboard_keystroke,", 19) == 0)
+}
+
+// Answer a sequenced command in acknowledge mode
+static void command_reply(uint8_t seq, bool ok)
+{
+    // The schedule is a queue too, a host replaying input must not overfill it
+    uint16_t queue_free = (uint16_t)(COMMAND_SCHEDULE_DEPTH - command_schedule.count);
+    for (uint8_t i = 0; i < REPORT_QUEUE_COUNT; i++)
+    {
+        queue_free = tu_min16(queue_free, report_queue_free(&report_queue[i]));
+    }
+
+    uint8_t const credits = command_ack_credits(queue_free, typer_free(&typer),
+                                                (uint16_t)(RX_RING_SIZE - rx_ring_count(&rx_ring)));
+    char line[COMMAND_ACK_REPLY_SIZE];
+
+    if (command_ack_reply(&command_ack, ok, seq, credits, line, sizeof(line)))
     {
+        uart_puts(UART_ID, line);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Text command handlers, the grammar is PICO_HID_COMMANDS in commands.h
+//--------------------------------------------------------------------+
+static bool cmd_mouse_move(command_args_t const *args)
+{
+    mouse_move(args->v[0], args->v[1]);
+    return true;
+}
+
+static bool cmd_mouse_rel_move(command_args_t const *args)
+{
+    // Deltas, summed on the device while the endpoint is busy
+    mouse_rel_move(args->v[0], args->v[1]);
+    return true;
+}
+
+static bool cmd_mouse_click_left(command_args_t const *args)
+{
+    (void)args;
+    mouse_click(MOUSE_BUTTON_LEFT);
+    return true;
+}
+
+static bool cmd_mouse_click_right(command_args_t const *args)
+{
+    (void)args;
+    mouse_click(MOUSE_BUTTON_RIGHT);
+    return true;
+}
+
+static bool cmd_mouse_press_left(command_args_t const *args)
+{
+    (void)args;
+    mouse_press(MOUSE_BUTTON_LEFT);
+    return true;
+}
+
+static bool cmd_mouse_press_right(command_args_t const *args)
+{
+    (void)args;
+    mouse_press(MOUSE_BUTTON_RIGHT);
+    return true;
+}
+
+static bool cmd_mouse_release(command_args_t const *args)
+{
+    (void)args;
+    mouse_release();
+    return true;
+}
+
+static bool cmd_mouse_path(command_args_t const *args)
+{
+    // Interpolated on the device
+    return start_mouse_path(false, args->v, args->count);
+}
+
+static bool cmd_mouse_rel_click_left(command_args_t const *args)
+{
+    (void)args;
+    mouse_rel_click(MOUSE_BUTTON_LEFT);
+    return true;
+}
+
+static bool cmd_mouse_rel_click_right(command_args_t const *args)
+{
+    (void)args;
+    mouse_rel_click(MOUSE_BUTTON_RIGHT);
+    return true;
+}
+
+static bool cmd_mouse_rel_press_left(command_args_t const *args)
+{
+    (void)args;
+    mouse_rel_press(MOUSE_BUTTON_LEFT);
+    return true;
+}
+
+static bool cmd_mouse_rel_press_right(command_args_t const *args)
+{
+    (void)args;
+    mouse_rel_press(MOUSE_BUTTON_RIGHT);
+    return true;
+}
 
-        // Parse keyboard keystroke command
-        int16_t signed_code;
-        if (sscanf(command + 19, "%hd", &signed_code) == 1)
+static bool cmd_mouse_rel_release(command_args_t const *args)
+{
+    (void)args;
+    mouse_rel_release();
+    return true;
+}
+
+static bool cmd_mouse_rel_path(command_args_t const *args)
+{
+    // Control points relative to the start
+    return start_mouse_path(true, args->v, args->count);
+}
+
+// Key codes are parsed as int16 and truncated to uint8
+static bool cmd_keyboard_keystroke(command_args_t const *args)
+{
+    keyboard_keystroke((uint8_t)args->v[0]);
+    return true;
+}
+
+static bool cmd_keyboard_press(command_args_t const *args)
+{
+    keyboard_press((uint8_t)args->v[0]);
+    return true;
+}
+
+static bool cmd_keyboard_release(command_args_t const *args)
+{
+    if (args->count)
+    {
+        keyboard_release((uint8_t)args->v[0]);
+    }
+    else
+    {
+        keyboard_release_all();
+    }
+    return true;
+}
+
+static bool cmd_type(command_args_t const *args)
+{
+    keyboard_type(args->text, args->text_len);
+    return true;
+}
+
+static bool cmd_stats(command_args_t const *args)
+{
+    (void)args;
+    print_stats();
+    return true;
+}
+
+static bool cmd_led(command_args_t const *args)
+{
+    (void)args;
+    print_keyboard_leds();
+    return true;
+}
+
+// poll_interval prints the intervals, poll_interval,<interface>,<1|2|4|8|10 ms>
+// sets one, persisted and applied by re-enumerating
+static bool cmd_poll_interval(command_args_t const *args)
+{
+    if (args->count == 0)
+    {
+        print_poll_intervals();
+        return true;
+    }
+    if (args->count != 2)
+    {
+        return false;
+    }
+
+    int16_t const itf = args->v[0];
+    int16_t const interval_ms = args->v[1];
+
+    if (itf < 0 || itf >= CFG_TUD_HID || interval_ms <= 0 || interval_ms > UINT8_MAX)
+    {
+        return false;
+    }
+    return set_poll_interval((uint8_t)itf, (uint8_t)interval_ms);
+}
+
+// ack,<0|1>: acknowledge mode off or on, "0:ack,1" is answered with the
+// initial credits
+static bool cmd_ack(command_args_t const *args)
+{
+    command_ack.enabled = args->v[0] != 0;
+    return true;
+}
+
+// baud prints the current and default rate, baud,<rate> switches and
+// commits, see baud_switch.h
+static bool cmd_baud(command_args_t const *args)
+{
+    uint32_t rate = 0;
+
+    if (!args->text)
+    {
+        print_baud_rates();
+        return true;
+    }
+
+    return command_parse_u32(args->text, &rate) && baud_request(rate);
+}
+
+// baud_save: the current rate becomes the power up default
+static bool cmd_baud_save(command_args_t const *args)
+{
+    (void)args;
+    baud_save();
+    return true;
+}
+
+static bool cmd_frame(command_args_t const *args)
+{
+    (void)args;
+    print_frame();
+    return true;
+}
+
+// queue_policy,<interface>,<0: drop oldest | 1: drop newest | 2: coalesce>
+static bool cmd_queue_policy(command_args_t const *args)
+{
+    int16_t const itf = args->v[0];
+    int16_t const policy = args->v[1];
+
+    if (itf < 0 || itf >= REPORT_QUEUE_COUNT || policy < REPORT_QUEUE_DROP_OLDEST || policy > REPORT_QUEUE_COALESCE)
+    {
+        return false;
+    }
+    report_queue[itf].policy = (uint8_t)policy;
+    return true;
+}
+
+#define COMMAND_ENTRY(name, min_args, max_args) {#name, cmd_##name, min_args, max_args},
+
+static const command_t commands[] = {PICO_HID_COMMANDS(COMMAND_ENTRY)};
+
+void commands_init(void)
+{
+    command_table_init(&command_table, commands, TU_ARRAY_SIZE(commands), PICO_HID_COMMAND_SEED);
+}
+
+// "[<seq>:][@<frame>:|+<frames>:]<command>", sequenced commands are answered
+// in acknowledge mode, scheduled ones when they were queued
+void process_command(const char *command)
+{
+    uint8_t seq;
+    uint32_t frame;
+    bool const sequenced = command_ack_parse_seq(command, &seq, &command);
+    uint32_t const losses = command_losses();
+    bool ok;
+
+    if (command_schedule_parse(command, usb_frame, &frame, &command))
+    {
+        // Only the name can be checked now, the arguments are parsed when it runs
+        ok = command_table_find(&command_table, command, strcspn(command, ",")) &&
+             schedule_command(frame, COMMAND_SCHEDULE_TEXT, command, strlen(command));
+    }
+    else
+    {
+        ok = command_table_dispatch(&command_table, command);
+    }
+
+    if (sequenced)
+    {
+        command_reply(seq, ok && command_losses() == losses);
+    }
+}
+
+void process_frame(const command_frame_parser_t *frame)
+{
+    uint8_t const *p = frame->payload;
+    uint8_t len = frame->len;
+    uint8_t const opcode = frame->opcode & (uint8_t)~(FRAME_OP_SEQ | FRAME_OP_AT);
+    bool const sequenced = frame->opcode & FRAME_OP_SEQ;
+    uint8_t seq = 0;
+
+    if (sequenced)
+    {
+        if (len == 0)
         {
-            hid_report.keystroke = (uint8_t)signed_code; // it did not read the uint8_t with %hhu correctly so had to use %hd and then cast it to uint8_t
+            return; // no sequence number to answer
         }
+        seq = *p++;
+        len--;
     }
-    else if (strncmp(command, "keyboard_press,", 15) == 0)
+
+    uint32_t const losses = command_losses();
+    bool ok;
+
+    if (frame->opcode & FRAME_OP_AT)
+    {
+        ok = len >= 4 && schedule_command(tu_unaligned_read32(p), opcode, p + 4, len - 4u);
+    }
+    else
     {
-        // Parse keyboard press command
-        int16_t signed_code;
-        if (sscanf(command + 15, "%hd", &signed_code) == 1)
+        ok = execute_frame(opcode, p, len);
+    }
+
+    if (sequenced)
+    {
+        command_reply(seq, ok && command_losses() == losses);
+    }
+}
+
+// Run a frame's command. Return false if the opcode is unknown, the payload
+// does not fit it or the command rejects its values
+bool execute_frame(uint8_t opcode, uint8_t const *p, uint8_t len)
+{
+    switch (opcode)
+    {
+    case FRAME_OP_MOUSE_MOVE:
+        if (len != 4)
         {
-            if (hid_report.key_index < MAX_KEYS)
-            {
-                hid_report.keys_pressed[hid_report.key_index++] = (uint8_t)signed_code; // it did not read the uint8_t with %hhu correctly so had to use %hd and then cast it to uint8_t
-            }
+            return false;
         }
-    }
-    else if (strncmp(command, "keyboard_release,", 17) == 0)
+        mouse_move((int16_t)tu_unaligned_read16(p), (int16_t)tu_unaligned_read16(p + 2));
+        return true;
+
+    case FRAME_OP_MOUSE_CLICK:
+        if (len != 1)
+        {
+            return false;
+        }
+        mouse_click(p[0]);
+        return true;
+
+    case FRAME_OP_MOUSE_PRESS:
+        if (len != 1)
+        {
+            return false;
+        }
+        mouse_press(p[0]);
+        return true;
+
+    case FRAME_OP_MOUSE_RELEASE:
+        mouse_release();
+        return true;
+
+    case FRAME_OP_MOUSE_PATH:
+    case FRAME_OP_MOUSE_REL_PATH:
     {
-        int16_t signed_code;
-        if (sscanf(command + 17, "%hd", &signed_code) == 1)
+        // int16 fields, except duration (uint16) and easing (uint8) at the end of the fixed part
+        bool const relative = opcode == FRAME_OP_MOUSE_REL_PATH;
+        uint8_t const points = relative ? 1 : 2;
+        uint8_t const fixed_len = (uint8_t)(points * 4 + 3);
+        int16_t v[10];
+        uint8_t n = 0;
+
+        if (len < fixed_len || (len - fixed_len) % 4 || (len - fixed_len) / 4 > MOUSE_PATH_MAX_CONTROLS)
         {
-            uint8_t code = (uint8_t)signed_code; // it did not read the uint8_t with %hhu correctly so had to use %hd and then cast it to uint8_t
-            for (int i = 0; i < hid_report.key_index; i++)
-            {
-                if (hid_report.keys_pressed[i] == code)
-                {
-                    // Shift elements to remove released key
-                    for (int j = i; j < hid_report.key_index - 1; j++)
-                    {
-                        hid_report.keys_pressed[j] = hid_report.keys_pressed[j + 1];
-                    }
-                    hid_report.key_index--;
-                    break;
-                }
-            }
+            return false;
+        }
+
+        for (uint8_t i = 0; i < points * 2; i++)
+        {
+            v[n++] = (int16_t)tu_unaligned_read16(p + 2 * i);
         }
+        v[n++] = (int16_t)tu_unaligned_read16(p + points * 4);
+        v[n++] = p[points * 4 + 2];
+        for (uint8_t i = fixed_len; i < len; i += 2)
+        {
+            v[n++] = (int16_t)tu_unaligned_read16(p + i);
+        }
+        return start_mouse_path(relative, v, n);
     }
-    else if (strcmp(command, "keyboard_release") == 0)
-    {
-        hid_report.key_index = 0;
-        memset(hid_report.keys_pressed, 0, MAX_KEYS); // Clear keys_pressed array
+
+    case FRAME_OP_MOUSE_REL_MOVE:
+        if (len != 4)
+        {
+            return false;
+        }
+        mouse_rel_move((int16_t)tu_unaligned_read16(p), (int16_t)tu_unaligned_read16(p + 2));
+        return true;
+
+    case FRAME_OP_MOUSE_REL_CLICK:
+        if (len != 1)
+        {
+            return false;
+        }
+        mouse_rel_click(p[0]);
+        return true;
+
+    case FRAME_OP_MOUSE_REL_PRESS:
+        if (len != 1)
+        {
+            return false;
+        }
+        mouse_rel_press(p[0]);
+        return true;
+
+    case FRAME_OP_MOUSE_REL_RELEASE:
+        mouse_rel_release();
+        return true;
+
+    case FRAME_OP_KEYBOARD_KEYSTROKE:
+        if (len != 1)
+        {
+            return false;
+        }
+        keyboard_keystroke(p[0]);
+        return true;
+
+    case FRAME_OP_KEYBOARD_PRESS:
+        if (len != 1)
+        {
+            return false;
+        }
+        keyboard_press(p[0]);
+        return true;
+
+    case FRAME_OP_KEYBOARD_RELEASE:
+        if (len == 1)
+        {
+            keyboard_release(p[0]);
+        }
+        else
+        {
+            keyboard_release_all();
+        }
+        return true;
+
+    case FRAME_OP_KEYBOARD_TYPE:
+        keyboard_type((char const *)p, len);
+        return true;
+
+    case FRAME_OP_KEYBOARD_LEDS:
+        print_keyboard_leds();
+        return true;
+
+    case FRAME_OP_BAUD:
+        if (len == 0)
+        {
+            print_baud_rates();
+            return true;
+        }
+        if (len != 4)
+        {
+            return false;
+        }
+        return baud_request(tu_unaligned_read32(p));
+
+    case FRAME_OP_BAUD_SAVE:
+        baud_save();
+        return true;
+
+    case FRAME_OP_FRAME:
+        print_frame();
+        return true;
+
+    case FRAME_OP_ACK_MODE:
+        if (len != 1)
+        {
+            return false;
+        }
+        command_ack.enabled = p[0] != 0;
+        return true;
+
+    default:
+        return false;
     }
 }
@@ -0,0 +1,179 @@
+#include <string.h>
+
+#include "mouse_accum.h"
+
+// Pending motion saturates here instead of overflowing while unmounted
+#define MOUSE_ACCUM_LIMIT (1L << 24)
+
+static int32_t clamp(int32_t value, int32_t limit)
+{
+    return (value > limit) ? limit : (value < -limit) ? -limit : value;
+}
+
+static mouse_segment_t *segment_at(mouse_accum_t *m, uint8_t index)
+{
+    return &m->segment[(m->head + index) % MOUSE_ACCUM_SEGMENTS];
+}
+
+static bool segment_done(mouse_segment_t const *seg)
+{
+    return seg->reported && seg->x == 0 && seg->y == 0;
+}
+
+void mouse_accum_init(mouse_accum_t *m, uint8_t instance)
+{
+    memset(m, 0, sizeof(mouse_accum_t));
+    m->instance = instance;
+    m->protocol = HID_PROTOCOL_REPORT;
+    mouse_accum_clear(m);
+}
+
+void mouse_accum_clear(mouse_accum_t *m)
+{
+    m->head = 0;
+    m->count = 1;
+    memset(&m->segment[0], 0, sizeof(mouse_segment_t));
+    m->segment[0].reported = true;
+}
+
+void mouse_accum_set_protocol(mouse_accum_t *m, uint8_t protocol)
+{
+    if (protocol == m->protocol)
+    {
+        return;
+    }
+
+    m->protocol = protocol;
+    segment_at(m, m->count - 1)->reported = false;
+    mouse_accum_complete(m);
+}
+
+bool mouse_accum_pending(mouse_accum_t const *m)
+{
+    return m->count > 1 || !segment_done(&m->segment[m->head]);
+}
+
+void mouse_accum_move(mouse_accum_t *m, int16_t dx, int16_t dy)
+{
+    if (dx == 0 && dy == 0)
+    {
+        return;
+    }
+
+    if (mouse_accum_pending(m))
+    {
+        m->merged++;
+    }
+
+    mouse_segment_t *last = segment_at(m, m->count - 1);
+    last->x = clamp(last->x + dx, MOUSE_ACCUM_LIMIT);
+    last->y = clamp(last->y + dy, MOUSE_ACCUM_LIMIT);
+
+    mouse_accum_complete(m);
+}
+
+void mouse_accum_buttons(mouse_accum_t *m, uint8_t buttons)
+{
+    mouse_segment_t *last = segment_at(m, m->count - 1);
+
+    if (last->buttons == buttons)
+    {
+        return;
+    }
+
+    if (m->count == 1 && segment_done(last))
+    {
+        // Nothing pending, reuse the segment
+        last->buttons = buttons;
+        last->reported = false;
+    }
+    else if (m->count < MOUSE_ACCUM_SEGMENTS)
+    {
+        m->count++;
+        last = segment_at(m, m->count - 1);
+        memset(last, 0, sizeof(mouse_segment_t));
+        last->buttons = buttons;
+    }
+    else
+    {
+        // Out of segments, the previous button change is never seen
+        last->buttons = buttons;
+        last->reported = false;
+        m->dropped++;
+    }
+
+    mouse_accum_complete(m);
+}
+
+void mouse_accum_complete(mouse_accum_t *m)
+{
+    if (!tud_hid_n_ready(m->instance))
+    {
+        return;
+    }
+
+    mouse_segment_t *seg = &m->segment[m->head];
+    if (segment_done(seg) && m->count > 1)
+    {
+        m->head = (uint8_t)((m->head + 1) % MOUSE_ACCUM_SEGMENTS);
+        m->count--;
+        seg = &m->segment[m->head];
+    }
+
+    if (segment_done(seg))
+    {
+        return;
+    }
+
+    bool const boot = m->protocol == HID_PROTOCOL_BOOT;
+    int32_t const limit = boot ? MOUSE_ACCUM_MAX_BOOT_DELTA : MOUSE_ACCUM_MAX_DELTA;
+    int16_t const x = (int16_t)clamp(seg->x, limit);
+    int16_t const y = (int16_t)clamp(seg->y, limit);
+
+    if (boot)
+    {
+        mouse_boot_report_t *report = tud_hid_n_report_stage(m->instance, 0, sizeof(mouse_boot_report_t));
+        if (!report)
+        {
+            return;
+        }
+
+        report->buttons = seg->buttons;
+        report->x = (int8_t)x;
+        report->y = (int8_t)y;
+
+        if (!tud_hid_n_report_commit(m->instance, sizeof(mouse_boot_report_t)))
+        {
+            return;
+        }
+    }
+    else
+    {
+        hid_mouse_report_t *report = tud_hid_n_report_stage(m->instance, 0, sizeof(hid_mouse_report_t));
+        if (!report)
+        {
+            return;
+        }
+
+        report->buttons = seg->buttons;
+        report->x = x;
+        report->y = y;
+        report->wheel = 0;
+        report->pan = 0;
+
+        if (!tud_hid_n_report_commit(m->instance, sizeof(hid_mouse_report_t)))
+        {
+            return;
+        }
+    }
+
+    seg->x -= x;
+    seg->y -= y;
+    seg->reported = true;
+    m->reports++;
+
+    if (seg->x || seg->y)
+    {
+        m->splits++;
+    }
+}
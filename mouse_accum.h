@@ -0,0 +1,74 @@
+#ifndef _MOUSE_ACCUM_H_
+#define _MOUSE_ACCUM_H_
+
+#include "tusb.h"
+
+#define MOUSE_ACCUM_SEGMENTS 8 // button changes that can wait for the endpoint
+#define MOUSE_ACCUM_MAX_DELTA 32767
+#define MOUSE_ACCUM_MAX_BOOT_DELTA 127
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Motion under one button state. A button change starts a new segment so
+    // clicks stay in order with the motion around them.
+    typedef struct
+    {
+        uint8_t buttons;
+        bool reported; // buttons were sent at least once
+        int32_t x;     // motion not sent yet
+        int32_t y;
+    } mouse_segment_t;
+
+    // Boot protocol mouse report, the first three bytes every BIOS parses
+    typedef struct TU_ATTR_PACKED
+    {
+        uint8_t buttons;
+        int8_t x;
+        int8_t y;
+    } mouse_boot_report_t;
+
+    // Relative mouse output for one HID instance. Deltas are summed while the
+    // endpoint is busy and sent as one report when it frees up; sums beyond
+    // int16 (int8 in boot protocol) are split over several reports. A report is only sent when there
+    // is motion or a button change, so no poll is spent on an empty report.
+    typedef struct
+    {
+        uint8_t instance;
+        uint8_t protocol; // HID_PROTOCOL_BOOT or HID_PROTOCOL_REPORT, selected by the host
+        uint8_t head;  // oldest segment, the one being sent
+        uint8_t count; // always at least 1, the newest segment accumulates
+        mouse_segment_t segment[MOUSE_ACCUM_SEGMENTS];
+
+        uint32_t reports; // reports handed to the endpoint
+        uint32_t merged;  // moves summed into a pending report
+        uint32_t splits;  // reports that had to leave motion for the next one
+        uint32_t dropped; // button changes lost because all segments were in use
+    } mouse_accum_t;
+
+    void mouse_accum_init(mouse_accum_t *m, uint8_t instance);
+
+    // Drop pending motion and buttons, e.g. on unmount. Counters are kept
+    void mouse_accum_clear(mouse_accum_t *m);
+
+    // Host switched between boot and report protocol. Pending motion goes out
+    // in the new format, and the buttons are reported again in it
+    void mouse_accum_set_protocol(mouse_accum_t *m, uint8_t protocol);
+
+    void mouse_accum_move(mouse_accum_t *m, int16_t dx, int16_t dy);
+    void mouse_accum_buttons(mouse_accum_t *m, uint8_t buttons);
+
+    // Send the next report if the endpoint is idle, call from
+    // tud_hid_report_complete_cb() and after resume
+    void mouse_accum_complete(mouse_accum_t *m);
+
+    // True while motion or a button change waits for the endpoint
+    bool mouse_accum_pending(mouse_accum_t const *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOUSE_ACCUM_H_ */
@@ -0,0 +1,133 @@
+#include "mouse_path.h"
+
+#define Q15_ONE 32768
+
+// Q15 product, rounded. Callers keep the product within int32
+static int32_t q15_mul(int32_t a, int32_t b)
+{
+    return (a * b + (Q15_ONE / 2)) >> 15;
+}
+
+// Map linear progress to eased progress, both Q15 in [0, Q15_ONE]
+static int32_t ease(uint8_t easing, int32_t t)
+{
+    switch (easing)
+    {
+    case MOUSE_PATH_EASE_IN:
+        return q15_mul(t, t);
+
+    case MOUSE_PATH_EASE_OUT:
+    {
+        int32_t const u = Q15_ONE - t;
+        return Q15_ONE - q15_mul(u, u);
+    }
+
+    case MOUSE_PATH_EASE_IN_OUT:
+        return q15_mul(q15_mul(t, t), 3 * Q15_ONE - 2 * t);
+
+    default:
+        return t;
+    }
+}
+
+// Weighted sum of coordinates, weights are Q15 and add up to Q15_ONE. Every
+// product fits in int32 (2^15 * 2^15), and so does the sum
+static int16_t blend(int16_t const *v, int32_t const *w, uint8_t n)
+{
+    int32_t sum = Q15_ONE / 2;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        sum += w[i] * v[i];
+    }
+    return (int16_t)(sum >> 15);
+}
+
+bool mouse_path_start(mouse_path_t *path, mouse_point_t start, mouse_point_t end, mouse_point_t const *controls,
+                      uint8_t control_count, uint8_t easing, uint16_t duration_ms, uint32_t now_ms)
+{
+    if (control_count > MOUSE_PATH_MAX_CONTROLS || easing >= MOUSE_PATH_EASING_COUNT)
+    {
+        return false;
+    }
+
+    path->p[0] = start;
+    for (uint8_t i = 0; i < control_count; i++)
+    {
+        path->p[1 + i] = controls[i];
+    }
+    path->p[1 + control_count] = end;
+    path->controls = control_count;
+    path->easing = easing;
+    path->duration_ms = duration_ms;
+    path->start_ms = now_ms;
+    path->active = true;
+    return true;
+}
+
+void mouse_path_stop(mouse_path_t *path)
+{
+    path->active = false;
+}
+
+bool mouse_path_active(mouse_path_t const *path)
+{
+    return path->active;
+}
+
+bool mouse_path_next(mouse_path_t *path, uint32_t now_ms, mouse_point_t *point)
+{
+    if (!path->active)
+    {
+        return false;
+    }
+
+    // Linear progress in Q15, the wrap-safe difference handles the ms counter overflow
+    uint32_t const elapsed = now_ms - path->start_ms;
+    int32_t t = Q15_ONE;
+    if (elapsed < path->duration_ms)
+    {
+        t = (int32_t)((elapsed * Q15_ONE) / path->duration_ms);
+    }
+    else
+    {
+        path->active = false;
+    }
+
+    t = ease(path->easing, t);
+    int32_t const u = Q15_ONE - t;
+    int32_t w[MOUSE_PATH_MAX_CONTROLS + 2];
+    uint8_t const n = (uint8_t)(path->controls + 2);
+
+    // Bernstein weights of the line, quadratic or cubic curve
+    if (path->controls == 0)
+    {
+        w[0] = u;
+        w[1] = t;
+    }
+    else if (path->controls == 1)
+    {
+        w[0] = q15_mul(u, u);
+        w[2] = q15_mul(t, t);
+        w[1] = Q15_ONE - w[0] - w[2];
+    }
+    else
+    {
+        int32_t const u2 = q15_mul(u, u);
+        int32_t const t2 = q15_mul(t, t);
+        w[0] = q15_mul(u2, u);
+        w[1] = 3 * q15_mul(u2, t);
+        w[2] = 3 * q15_mul(u, t2);
+        w[3] = Q15_ONE - w[0] - w[1] - w[2];
+    }
+
+    int16_t xs[MOUSE_PATH_MAX_CONTROLS + 2], ys[MOUSE_PATH_MAX_CONTROLS + 2];
+    for (uint8_t i = 0; i < n; i++)
+    {
+        xs[i] = path->p[i].x;
+        ys[i] = path->p[i].y;
+    }
+
+    point->x = blend(xs, w, n);
+    point->y = blend(ys, w, n);
+    return true;
+}
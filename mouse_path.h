@@ -0,0 +1,62 @@
+#ifndef _MOUSE_PATH_H_
+#define _MOUSE_PATH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MOUSE_PATH_MAX_CONTROLS 2
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Speed profile along the path
+    typedef enum
+    {
+        MOUSE_PATH_LINEAR = 0,  // constant speed
+        MOUSE_PATH_EASE_IN,     // t^2, starts slow
+        MOUSE_PATH_EASE_OUT,    // 1-(1-t)^2, ends slow
+        MOUSE_PATH_EASE_IN_OUT, // smoothstep, slow at both ends
+        MOUSE_PATH_EASING_COUNT
+    } mouse_path_easing_t;
+
+    typedef struct
+    {
+        int16_t x;
+        int16_t y;
+    } mouse_point_t;
+
+    // Pointer trajectory sampled by time, once per report. With no control
+    // point the path is a straight line, one control point makes it a
+    // quadratic and two a cubic Bezier curve. All math is Q15 fixed point,
+    // the RP2040 has no FPU.
+    typedef struct
+    {
+        mouse_point_t p[MOUSE_PATH_MAX_CONTROLS + 2]; // start, controls, end
+        uint8_t controls;                             // number of control points
+        uint8_t easing;                               // mouse_path_easing_t
+        bool active;                                  // end not sampled yet
+        uint16_t duration_ms;
+        uint32_t start_ms;
+    } mouse_path_t;
+
+    // Start a path from `start` to `end` taking `duration_ms`, at time `now_ms`.
+    // Return false for an unknown easing or too many control points
+    bool mouse_path_start(mouse_path_t *path, mouse_point_t start, mouse_point_t end, mouse_point_t const *controls,
+                          uint8_t control_count, uint8_t easing, uint16_t duration_ms, uint32_t now_ms);
+
+    void mouse_path_stop(mouse_path_t *path);
+
+    // True until the end point was sampled
+    bool mouse_path_active(mouse_path_t const *path);
+
+    // Position at time `now_ms`. Once the duration is over this is the end
+    // point and the path stops. Return false if the path is not active
+    bool mouse_path_next(mouse_path_t *path, uint32_t now_ms, mouse_point_t *point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MOUSE_PATH_H_ */
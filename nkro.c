@@ -0,0 +1,114 @@
+#include <string.h>
+
+#include "nkro.h"
+
+#define KEYBOARD_ERROR_ROLLOVER 0x01
+
+TU_VERIFY_STATIC(NKRO_KEY_COUNT == 128 || NKRO_KEY_COUNT == 256, "NKRO_KEY_COUNT must be 128 or 256");
+
+static bool is_modifier(uint8_t keycode)
+{
+    return keycode >= HID_KEY_CONTROL_LEFT && keycode <= HID_KEY_GUI_RIGHT;
+}
+
+static bool has_bit(uint8_t keycode)
+{
+#if NKRO_KEY_COUNT < 256
+    return keycode != HID_KEY_NONE && keycode < NKRO_KEY_COUNT;
+#else
+    return keycode != HID_KEY_NONE;
+#endif
+}
+
+void nkro_clear(nkro_state_t *s)
+{
+    memset(s, 0, sizeof(nkro_state_t));
+}
+
+bool nkro_press(nkro_state_t *s, uint8_t keycode)
+{
+    if (is_modifier(keycode))
+    {
+        s->modifier |= (uint8_t)TU_BIT(keycode - HID_KEY_CONTROL_LEFT);
+        return true;
+    }
+
+    if (!has_bit(keycode))
+    {
+        return false;
+    }
+
+    s->keys[keycode >> 3] |= (uint8_t)TU_BIT(keycode & 7);
+    return true;
+}
+
+bool nkro_release(nkro_state_t *s, uint8_t keycode)
+{
+    if (is_modifier(keycode))
+    {
+        s->modifier &= (uint8_t)~TU_BIT(keycode - HID_KEY_CONTROL_LEFT);
+        return true;
+    }
+
+    if (!has_bit(keycode))
+    {
+        return false;
+    }
+
+    s->keys[keycode >> 3] &= (uint8_t)~TU_BIT(keycode & 7);
+    return true;
+}
+
+bool nkro_is_pressed(nkro_state_t const *s, uint8_t keycode)
+{
+    if (is_modifier(keycode))
+    {
+        return s->modifier & TU_BIT(keycode - HID_KEY_CONTROL_LEFT);
+    }
+
+    if (!has_bit(keycode))
+    {
+        return false;
+    }
+
+    return s->keys[keycode >> 3] & TU_BIT(keycode & 7);
+}
+
+bool nkro_equal(nkro_state_t const *a, nkro_state_t const *b)
+{
+    return memcmp(a, b, sizeof(nkro_state_t)) == 0;
+}
+
+void nkro_report(nkro_state_t const *s, nkro_report_t *report)
+{
+    report->modifier = s->modifier;
+    report->reserved = 0;
+    memcpy(report->keys, s->keys, sizeof(report->keys));
+}
+
+void nkro_boot_report(nkro_state_t const *s, hid_keyboard_report_t *report)
+{
+    uint8_t count = 0;
+
+    memset(report, 0, sizeof(hid_keyboard_report_t));
+    report->modifier = s->modifier;
+
+    for (uint8_t i = 0; i < NKRO_BITMAP_SIZE; i++)
+    {
+        uint8_t bits = s->keys[i];
+
+        // Only walk set bits, most bytes are zero
+        while (bits)
+        {
+            uint8_t const bit = (uint8_t)__builtin_ctz(bits);
+            bits &= (uint8_t)(bits - 1);
+
+            if (count == sizeof(report->keycode))
+            {
+                memset(report->keycode, KEYBOARD_ERROR_ROLLOVER, sizeof(report->keycode));
+                return;
+            }
+            report->keycode[count++] = (uint8_t)(i * 8 + bit);
+        }
+    }
+}
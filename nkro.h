@@ -0,0 +1,56 @@
+#ifndef _NKRO_H_
+#define _NKRO_H_
+
+#include "tusb.h"
+
+// Usages 0 .. NKRO_KEY_COUNT-1 get a bit in the report, modifiers (0xE0 ..
+// 0xE7) always go to the modifier byte. 256 covers every keycode, including
+// the international and LANG keys (0x87 .. 0x94) and the keypad extras; 128
+// stops at F24 and the editing keys but makes an 18 byte report
+#ifndef NKRO_KEY_COUNT
+#define NKRO_KEY_COUNT 256
+#endif
+
+#define NKRO_BITMAP_SIZE (NKRO_KEY_COUNT / 8)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Report protocol input report of TUD_HID_REPORT_DESC_KEYBOARD_NKRO()
+    typedef struct TU_ATTR_PACKED
+    {
+        uint8_t modifier;
+        uint8_t reserved;
+        uint8_t keys[NKRO_BITMAP_SIZE];
+    } nkro_report_t;
+
+    // Set of keys held down. Press and release are single bit operations, any
+    // number of keys can be held at once.
+    typedef struct
+    {
+        uint8_t modifier;
+        uint8_t keys[NKRO_BITMAP_SIZE];
+    } nkro_state_t;
+
+    void nkro_clear(nkro_state_t *s);
+
+    // Return false if the keycode has no bit in the report
+    bool nkro_press(nkro_state_t *s, uint8_t keycode);
+    bool nkro_release(nkro_state_t *s, uint8_t keycode);
+    bool nkro_is_pressed(nkro_state_t const *s, uint8_t keycode);
+
+    bool nkro_equal(nkro_state_t const *a, nkro_state_t const *b);
+
+    void nkro_report(nkro_state_t const *s, nkro_report_t *report);
+
+    // Boot protocol report derived from the bitmap: up to 6 keys in usage
+    // order, or ErrorRollOver in every slot if more keys are held
+    void nkro_boot_report(nkro_state_t const *s, hid_keyboard_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NKRO_H_ */
@@ -0,0 +1,18 @@
+#ifndef _PICO_HID_H_
+#define _PICO_HID_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Firmware entry points, main() is pico_hid_init() followed by
+    // pico_hid_task() forever. Split so a host build can drive the loop.
+    void pico_hid_init(void);
+    void pico_hid_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PICO_HID_H_ */
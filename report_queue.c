@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include "report_queue.h"
+
+void report_queue_init(report_queue_t *q, uint8_t instance, report_queue_item_t *buffer, uint16_t depth,
+                       report_queue_policy_t policy)
+{
+    memset(q, 0, sizeof(report_queue_t));
+    tu_fifo_config(&q->ff, buffer, depth, sizeof(report_queue_item_t), false);
+    q->instance = instance;
+    q->policy = (uint8_t)policy;
+}
+
+void report_queue_clear(report_queue_t *q)
+{
+    tu_fifo_clear(&q->ff);
+    q->overflow_valid = false;
+}
+
+uint16_t report_queue_count(report_queue_t *q)
+{
+    return (uint16_t)(tu_fifo_count(&q->ff) + (q->overflow_valid ? 1 : 0));
+}
+
+uint16_t report_queue_free(report_queue_t *q)
+{
+    return q->overflow_valid ? 0 : tu_fifo_remaining(&q->ff);
+}
+
+static bool item_send(report_queue_t *q, report_queue_item_t const *item)
+{
+    if (!tud_hid_n_report(q->instance, item->report_id, item->data, item->len))
+    {
+        return false;
+    }
+
+    q->sent++;
+    return true;
+}
+
+static bool item_enqueue(report_queue_t *q, report_queue_item_t const *item)
+{
+    if (tu_fifo_full(&q->ff))
+    {
+        switch (q->policy)
+        {
+        case REPORT_QUEUE_DROP_OLDEST:
+        {
+            report_queue_item_t oldest;
+            tu_fifo_read(&q->ff, &oldest);
+            q->dropped++;
+            break;
+        }
+
+        case REPORT_QUEUE_COALESCE:
+            // Only the most recent overflowing report survives
+            if (q->overflow_valid)
+            {
+                q->coalesced++;
+            }
+            q->overflow = *item;
+            q->overflow_valid = true;
+            q->queued++;
+            return true;
+
+        case REPORT_QUEUE_DROP_NEWEST:
+        default:
+            q->dropped++;
+            return false;
+        }
+    }
+
+    tu_fifo_write(&q->ff, item);
+    q->queued++;
+    return true;
+}
+
+void report_queue_complete(report_queue_t *q)
+{
+    report_queue_item_t item;
+
+    if (!tud_hid_n_ready(q->instance))
+    {
+        return;
+    }
+
+    if (tu_fifo_read(&q->ff, &item) && !item_send(q, &item))
+    {
+        q->dropped++;
+    }
+
+    if (q->overflow_valid && !tu_fifo_full(&q->ff))
+    {
+        tu_fifo_write(&q->ff, &q->overflow);
+        q->overflow_valid = false;
+    }
+}
+
+void *report_queue_stage(report_queue_t *q, uint8_t report_id, uint16_t len)
+{
+    if (len > CFG_TUD_HID_EP_BUFSIZE)
+    {
+        q->dropped++;
+        return NULL;
+    }
+
+    q->staging.report_id = report_id;
+    q->staging.len = (uint8_t)len;
+
+    if (tud_hid_n_ready(q->instance))
+    {
+        // Endpoint is idle: flush any backlog first so reports stay in order
+        report_queue_complete(q);
+
+        if (report_queue_count(q) == 0)
+        {
+            q->staged = tud_hid_n_report_stage(q->instance, report_id, len);
+            if (q->staged)
+            {
+                return q->staged;
+            }
+        }
+    }
+
+    return q->staging.data;
+}
+
+bool report_queue_commit(report_queue_t *q, uint16_t len)
+{
+    uint8_t *const staged = q->staged;
+    q->staged = NULL;
+
+    if (len > q->staging.len)
+    {
+        if (staged)
+        {
+            tud_hid_n_report_cancel(q->instance);
+        }
+        q->dropped++;
+        return false;
+    }
+    q->staging.len = (uint8_t)len;
+
+    if (staged)
+    {
+        if (tud_hid_n_report_commit(q->instance, len))
+        {
+            q->sent++;
+            return true;
+        }
+
+        // The transfer did not start, queue the report instead
+        memcpy(q->staging.data, staged, len);
+    }
+
+    return item_enqueue(q, &q->staging);
+}
+
+bool report_queue_send(report_queue_t *q, uint8_t report_id, void const *report, uint16_t len)
+{
+    void *const buf = report_queue_stage(q, report_id, len);
+    if (!buf)
+    {
+        return false;
+    }
+
+    memcpy(buf, report, len);
+    return report_queue_commit(q, len);
+}
@@ -0,0 +1,81 @@
+#ifndef _REPORT_QUEUE_H_
+#define _REPORT_QUEUE_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // What to do with a new report when the queue is full
+    typedef enum
+    {
+        REPORT_QUEUE_DROP_OLDEST = 0, // discard the oldest queued report
+        REPORT_QUEUE_DROP_NEWEST,     // discard the new report
+        REPORT_QUEUE_COALESCE,        // keep the new report in a side slot, overwriting older overflow
+    } report_queue_policy_t;
+
+    typedef struct
+    {
+        uint8_t report_id;
+        uint8_t len;
+        uint8_t data[CFG_TUD_HID_EP_BUFSIZE];
+    } report_queue_item_t;
+
+    // Bounded queue of input reports for one HID instance. Reports are sent right
+    // away when the endpoint is idle, otherwise queued and sent from
+    // tud_hid_report_complete_cb() as soon as the previous transfer finished.
+    // Both run in tud_task() context, so no locking is needed.
+    typedef struct
+    {
+        tu_fifo_t ff;
+        uint8_t instance;
+        uint8_t policy;
+
+        bool overflow_valid; // COALESCE: overflow slot holds a report
+        report_queue_item_t overflow;
+
+        uint8_t *staged;             // endpoint IN buffer handed out by report_queue_stage(), NULL if queued
+        report_queue_item_t staging; // report_queue_stage() buffer when the report has to wait
+
+        uint32_t sent;      // reports handed to the endpoint
+        uint32_t queued;    // reports that had to wait for the endpoint
+        uint32_t dropped;   // reports discarded by DROP_OLDEST/DROP_NEWEST or a failed transfer
+        uint32_t coalesced; // reports overwritten in the COALESCE overflow slot
+    } report_queue_t;
+
+    void report_queue_init(report_queue_t *q, uint8_t instance, report_queue_item_t *buffer, uint16_t depth,
+                           report_queue_policy_t policy);
+
+    // Drop everything queued, e.g. on unmount. Counters are kept
+    void report_queue_clear(report_queue_t *q);
+
+    // Send report now if possible, otherwise queue it according to the policy.
+    // Return false if the report was dropped
+    bool report_queue_send(report_queue_t *q, uint8_t report_id, void const *report, uint16_t len);
+
+    // Zero-copy variant: return a buffer to build a report of up to len bytes in,
+    // the endpoint's own IN buffer when the report can go out right away, or NULL
+    // if len is too large. Follow with report_queue_commit() and the final length
+    void *report_queue_stage(report_queue_t *q, uint8_t report_id, uint16_t len);
+
+    // Send or queue the staged report. Return false if it was dropped
+    bool report_queue_commit(report_queue_t *q, uint16_t len);
+
+    // Start the next queued report if the endpoint is idle, call from
+    // tud_hid_report_complete_cb() and after resume
+    void report_queue_complete(report_queue_t *q);
+
+    // Number of reports waiting for the endpoint
+    uint16_t report_queue_count(report_queue_t *q);
+
+    // Reports that can still be queued without loss. The COALESCE overflow
+    // slot is not room: a report landing there may be overwritten
+    uint16_t report_queue_free(report_queue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _REPORT_QUEUE_H_ */
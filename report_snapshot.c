@@ -0,0 +1,68 @@
+#include <string.h>
+
+#include "report_snapshot.h"
+
+void report_snapshot_init(report_snapshot_t *s)
+{
+    memset(s, 0, sizeof(report_snapshot_t));
+}
+
+void report_snapshot_clear(report_snapshot_t *s)
+{
+    s->count = 0;
+}
+
+static report_snapshot_item_t *find(report_snapshot_t const *s, uint8_t instance, uint8_t report_id)
+{
+    for (uint8_t i = 0; i < s->count; i++)
+    {
+        report_snapshot_item_t const *item = &s->item[i];
+        if (item->instance == instance && item->report_id == report_id)
+        {
+            return (report_snapshot_item_t *)item;
+        }
+    }
+    return NULL;
+}
+
+bool report_snapshot_store(report_snapshot_t *s, uint8_t instance, uint8_t report_id, void const *report,
+                           uint16_t len)
+{
+    if (len > CFG_TUD_HID_EP_BUFSIZE)
+    {
+        s->dropped++;
+        return false;
+    }
+
+    report_snapshot_item_t *item = find(s, instance, report_id);
+    if (!item)
+    {
+        if (s->count >= REPORT_SNAPSHOT_SLOTS)
+        {
+            s->dropped++;
+            return false;
+        }
+
+        item = &s->item[s->count++];
+        item->instance = instance;
+        item->report_id = report_id;
+    }
+
+    memcpy(item->data, report, len);
+    item->len = (uint8_t)len;
+    return true;
+}
+
+uint16_t report_snapshot_get(report_snapshot_t const *s, uint8_t instance, uint8_t report_id, uint8_t *buffer,
+                             uint16_t reqlen)
+{
+    report_snapshot_item_t const *item = find(s, instance, report_id);
+    if (!item)
+    {
+        return 0;
+    }
+
+    uint16_t const len = tu_min16(item->len, reqlen);
+    memcpy(buffer, item->data, len);
+    return len;
+}
@@ -0,0 +1,52 @@
+#ifndef _REPORT_SNAPSHOT_H_
+#define _REPORT_SNAPSHOT_H_
+
+#include "tusb.h"
+
+#define REPORT_SNAPSHOT_SLOTS 8 // (instance, report ID) pairs remembered
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        uint8_t instance;
+        uint8_t report_id;
+        uint8_t len;
+        uint8_t data[CFG_TUD_HID_EP_BUFSIZE];
+    } report_snapshot_item_t;
+
+    // Last input report committed on each HID instance and report ID, to answer
+    // GET_REPORT from the control pipe with the state the host was last sent.
+    // Updated from tud_hid_report_commit_cb() and read from
+    // tud_hid_get_report_cb(), both in tud_task() context.
+    typedef struct
+    {
+        uint8_t count;
+        report_snapshot_item_t item[REPORT_SNAPSHOT_SLOTS];
+
+        uint32_t dropped; // reports not kept because all slots were in use
+    } report_snapshot_t;
+
+    void report_snapshot_init(report_snapshot_t *s);
+
+    // Forget all reports, e.g. on unmount. Counters are kept
+    void report_snapshot_clear(report_snapshot_t *s);
+
+    // Keep a copy of report (without its report ID) as the current one for
+    // instance and report_id. Return false if it is too long or no slot is free
+    bool report_snapshot_store(report_snapshot_t *s, uint8_t instance, uint8_t report_id, void const *report,
+                               uint16_t len);
+
+    // Copy up to reqlen bytes of the current report into buffer. Return the
+    // number of bytes copied, 0 if nothing was stored for instance and report_id
+    uint16_t report_snapshot_get(report_snapshot_t const *s, uint8_t instance, uint8_t report_id, uint8_t *buffer,
+                                 uint16_t reqlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _REPORT_SNAPSHOT_H_ */
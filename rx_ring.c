@@ -0,0 +1,67 @@
+#include "rx_ring.h"
+
+void rx_ring_init(rx_ring_t *ring, uint8_t *buffer, uint16_t depth)
+{
+    tu_fifo_config(&ring->ff, buffer, depth, 1, false);
+    ring->received = 0;
+    ring->overflow = 0;
+    ring->dma_armed = 0;
+    ring->dma_base = 0;
+    ring->dma_total = 0;
+}
+
+void rx_ring_dma_start(rx_ring_t *ring, uint32_t transfer_count)
+{
+    ring->dma_armed = transfer_count;
+    ring->dma_base = 0;
+    ring->dma_total = 0;
+}
+
+bool rx_ring_dma_update(rx_ring_t *ring, uint32_t remaining)
+{
+    uint32_t const total = ring->dma_base + (ring->dma_armed - remaining);
+    uint32_t const n = total - ring->dma_total;
+
+    if (n)
+    {
+        uint16_t const depth = tu_fifo_depth(&ring->ff);
+        uint32_t const count = tu_fifo_count(&ring->ff);
+
+        ring->dma_total = total;
+
+        // Keep the write index in step with the DMA write address, even if the
+        // channel lapped the reader. Indices live in [0, 2*depth).
+        tu_fifo_advance_write_pointer(&ring->ff, (uint16_t)(n % (2u * depth)));
+
+        if (count + n > depth)
+        {
+            // The oldest bytes were overwritten by the DMA
+            uint32_t const lost = count + n - depth;
+            tu_fifo_correct_read_pointer(&ring->ff);
+            ring->overflow += lost;
+            ring->received += n - lost;
+        }
+        else
+        {
+            ring->received += n;
+        }
+    }
+
+    if (remaining == 0)
+    {
+        ring->dma_base += ring->dma_armed;
+        return true;
+    }
+
+    return false;
+}
+
+uint16_t rx_ring_read(rx_ring_t *ring, uint8_t *buffer, uint16_t bufsize)
+{
+    return tu_fifo_read_n(&ring->ff, buffer, bufsize);
+}
+
+uint16_t rx_ring_count(rx_ring_t *ring)
+{
+    return tu_fifo_count(&ring->ff);
+}
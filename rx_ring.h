@@ -0,0 +1,53 @@
+#ifndef _RX_RING_H_
+#define _RX_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "osal/osal.h"
+#include "common/tusb_fifo.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Single producer / single consumer byte ring.
+    // tu_fifo_t keeps read and write indices separate, so no locking is needed
+    // as long as only one context produces and only the main loop reads.
+    //
+    // The producer is a DMA channel writing straight into the ring buffer in
+    // circular mode, whose progress is published with rx_ring_dma_update().
+    typedef struct
+    {
+        tu_fifo_t ff;
+        uint32_t received; // bytes accepted into the ring
+        uint32_t overflow; // bytes overwritten by the DMA because the ring was full
+
+        // DMA producer accounting
+        uint32_t dma_armed; // transfer count the channel is (re)armed with
+        uint32_t dma_base;  // bytes written by previous runs of the channel
+        uint32_t dma_total; // bytes written by the channel that are already committed
+    } rx_ring_t;
+
+    void rx_ring_init(rx_ring_t *ring, uint8_t *buffer, uint16_t depth);
+
+    // DMA producer: the channel writes into the ring buffer wrapping at depth
+    // (depth must be a power of 2) starting at offset 0, armed with transfer_count.
+    void rx_ring_dma_start(rx_ring_t *ring, uint32_t transfer_count);
+
+    // Publish DMA progress, remaining is the channel's current transfer count.
+    // Every received byte becomes readable, there is no watermark to wait for.
+    // Return true when the channel ran out and must be re-armed with the same count.
+    bool rx_ring_dma_update(rx_ring_t *ring, uint32_t remaining);
+
+    // Consumer side, called from the main loop. Return number of bytes copied
+    uint16_t rx_ring_read(rx_ring_t *ring, uint8_t *buffer, uint16_t bufsize);
+
+    uint16_t rx_ring_count(rx_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RX_RING_H_ */
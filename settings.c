@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/regs/addressmap.h"
+
+#include "settings.h"
+
+#define SETTINGS_MAGIC 0x48444950u // "PIDH"
+#define SETTINGS_VERSION 2
+#define SETTINGS_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+// One flash page holds the whole struct
+_Static_assert(sizeof(settings_t) <= FLASH_PAGE_SIZE, "settings_t must fit in a flash page");
+
+settings_t settings;
+
+static void settings_default(void)
+{
+    memset(&settings, 0, sizeof(settings));
+    settings.magic = SETTINGS_MAGIC;
+    settings.version = SETTINGS_VERSION;
+    settings.size = sizeof(settings_t);
+}
+
+void settings_load(void)
+{
+    settings_t const *stored = (settings_t const *)(XIP_BASE + SETTINGS_FLASH_OFFSET);
+
+    if (stored->magic == SETTINGS_MAGIC && stored->version == SETTINGS_VERSION && stored->size == sizeof(settings_t))
+    {
+        memcpy(&settings, stored, sizeof(settings));
+    }
+    else
+    {
+        settings_default();
+    }
+}
+
+void settings_save(void)
+{
+    uint8_t page[FLASH_PAGE_SIZE];
+
+    memset(page, 0xff, sizeof(page));
+    memcpy(page, &settings, sizeof(settings));
+
+    // Code runs from flash, nothing may fetch from it while it is erased
+    uint32_t const irq = save_and_disable_interrupts();
+    flash_range_erase(SETTINGS_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(SETTINGS_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+    restore_interrupts(irq);
+}
@@ -0,0 +1,38 @@
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SETTINGS_MAX_INTERFACES 4
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Runtime configuration kept in the last flash sector
+    typedef struct
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size; // sizeof(settings_t), a layout change invalidates stored settings
+
+        uint8_t poll_interval_ms[SETTINGS_MAX_INTERFACES]; // bInterval per HID interface, 0 = build default
+        uint32_t baud_rate;                                 // command UART at power up, 0 = build default
+    } settings_t;
+
+    extern settings_t settings;
+
+    // Load settings from flash, fall back to defaults if none were saved
+    void settings_load(void);
+
+    // Write settings to flash. Stalls the CPU with interrupts off for the
+    // erase and program of one sector
+    void settings_save(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SETTINGS_H_ */
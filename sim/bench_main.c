@@ -0,0 +1,647 @@
+// End-to-end latency benchmark: replays a recorded command stream into the
+// simulated UART at a fixed command rate and measures, per command, the time
+// from its last byte arriving on the UART to the IN transfer that carries
+// its effect completing on the USB. Results are printed as JSON.
+//
+//   pico_hid_bench [--rate N] [--repeat N] [--loop-us N] [--out FILE] stream
+//
+// The stream has one command per line as sent over the UART. A line
+// "frame <hex bytes>" is sent as a binary frame (tools/pico_hid.py prints
+// them in that form); empty lines and lines starting with '#' are skipped.
+//
+// A command is matched to the first report on its endpoint that was armed
+// after the firmware picked up the command and shows its effect: the
+// position of a mouse_move, the key of a keystroke, the buttons of a click.
+// Relative moves and typed text match any such report since the device merges
+// them. Commands never matched by the end of the run count as dropped.
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tusb.h"
+
+#include "command_frame.h"
+#include "pico_hid.h"
+#include "sim.h"
+
+#define BENCH_SETTLE_MS 50
+#define BENCH_MAX_MS 3600000
+#define BENCH_HISTOGRAM_BUCKETS 10 // <=256us, <=512us ... <=65536us, more
+#define BENCH_HISTOGRAM_MIN_US 256
+
+#define EP_KEYBOARD 0x81
+#define EP_MOUSE 0x82
+#define EP_MOUSE_REL 0x83
+
+// Effect a report must show to complete a command
+typedef enum
+{
+    MATCH_NONE,        // not measured (settings, stats, ...)
+    MATCH_ANY,         // any report on the endpoint
+    MATCH_POSITION,    // absolute mouse at x, y
+    MATCH_BUTTONS,     // mouse buttons equal to arg
+    MATCH_BUTTONS_SET, // mouse buttons include arg
+    MATCH_KEY_DOWN,    // key arg pressed
+    MATCH_KEY_UP       // key arg released
+} match_t;
+
+typedef struct
+{
+    uint8_t name;     // index into names[]
+    uint8_t ep;
+    uint8_t match;    // match_t
+    int16_t arg[2];
+    uint32_t end;     // stream offset after the last byte
+    uint64_t arrival_us;
+    uint64_t done_us; // 0 = not delivered
+    bool superseded;  // a later command on the endpoint was delivered first
+} command_t;
+
+typedef struct
+{
+    uint8_t *data; // bytes of the whole stream, repeats included
+    uint32_t len;
+    uint32_t pos;
+    command_t *cmd;
+    uint32_t count;
+    uint32_t next; // next command to send
+    uint32_t sent_end;
+    uint64_t start_us;
+    uint64_t interval_us; // between command starts, 0 = back to back
+} stream_t;
+
+static stream_t stream;
+
+static char const *names[64];
+static uint8_t name_count;
+
+// Arm-time snapshot of the UART bytes the firmware had seen, per IN endpoint
+static uint32_t seen_at_arm[16];
+
+// First command per endpoint that may still be pending
+static uint32_t first_pending[16];
+
+//--------------------------------------------------------------------+
+// Stream
+//--------------------------------------------------------------------+
+static uint8_t name_index(char const *name, size_t len)
+{
+    for (uint8_t i = 0; i < name_count; i++)
+    {
+        if (strlen(names[i]) == len && strncmp(names[i], name, len) == 0)
+        {
+            return i;
+        }
+    }
+
+    if (name_count == TU_ARRAY_SIZE(names))
+    {
+        return (uint8_t)(name_count - 1);
+    }
+
+    char *copy = malloc(len + 1);
+    memcpy(copy, name, len);
+    copy[len] = 0;
+    names[name_count] = copy;
+    return name_count++;
+}
+
+static void classify_text(command_t *c, char const *line)
+{
+    char const *comma = strchr(line, ',');
+    size_t const name_len = comma ? (size_t)(comma - line) : strlen(line);
+    int a = 0, b = 0;
+
+    c->name = name_index(line, name_len);
+    c->match = MATCH_NONE;
+
+    if (comma)
+    {
+        sscanf(comma + 1, "%d,%d", &a, &b);
+    }
+    c->arg[0] = (int16_t)a;
+    c->arg[1] = (int16_t)b;
+
+    if (strncmp(line, "mouse_rel_", 10) == 0)
+    {
+        c->ep = EP_MOUSE_REL;
+        c->match = MATCH_ANY;
+    }
+    else if (strncmp(line, "mouse_move,", 11) == 0)
+    {
+        c->ep = EP_MOUSE;
+        c->match = MATCH_POSITION;
+    }
+    else if (strncmp(line, "mouse_click_", 12) == 0 || strncmp(line, "mouse_press_", 12) == 0)
+    {
+        c->ep = EP_MOUSE;
+        c->match = line[6] == 'c' ? MATCH_BUTTONS_SET : MATCH_BUTTONS;
+        c->arg[0] = strstr(line, "right") ? MOUSE_BUTTON_RIGHT : MOUSE_BUTTON_LEFT;
+    }
+    else if (strcmp(line, "mouse_release") == 0)
+    {
+        c->ep = EP_MOUSE;
+        c->match = MATCH_BUTTONS;
+        c->arg[0] = 0;
+    }
+    else if (strncmp(line, "mouse_path,", 11) == 0)
+    {
+        c->ep = EP_MOUSE;
+        c->match = MATCH_ANY;
+    }
+    else if (strncmp(line, "keyboard_keystroke,", 19) == 0 || strncmp(line, "keyboard_press,", 15) == 0)
+    {
+        c->ep = EP_KEYBOARD;
+        c->match = MATCH_KEY_DOWN;
+    }
+    else if (strncmp(line, "keyboard_release,", 17) == 0)
+    {
+        c->ep = EP_KEYBOARD;
+        c->match = MATCH_KEY_UP;
+    }
+    else if (strncmp(line, "type,", 5) == 0 || strcmp(line, "keyboard_release") == 0)
+    {
+        c->ep = EP_KEYBOARD;
+        c->match = MATCH_ANY;
+    }
+}
+
+static void classify_frame(command_t *c, uint8_t const *frame, uint32_t len)
+{
+    static char const *const op_names[] = {
+        [FRAME_OP_MOUSE_MOVE] = "frame_mouse_move",
+        [FRAME_OP_MOUSE_CLICK] = "frame_mouse_click",
+        [FRAME_OP_MOUSE_PRESS] = "frame_mouse_press",
+        [FRAME_OP_MOUSE_RELEASE] = "frame_mouse_release",
+        [FRAME_OP_MOUSE_REL_MOVE] = "frame_mouse_rel_move",
+        [FRAME_OP_MOUSE_REL_CLICK] = "frame_mouse_rel_click",
+        [FRAME_OP_MOUSE_REL_PRESS] = "frame_mouse_rel_press",
+        [FRAME_OP_MOUSE_REL_RELEASE] = "frame_mouse_rel_release",
+        [FRAME_OP_MOUSE_PATH] = "frame_mouse_path",
+        [FRAME_OP_MOUSE_REL_PATH] = "frame_mouse_rel_path",
+        [FRAME_OP_KEYBOARD_KEYSTROKE] = "frame_keyboard_keystroke",
+        [FRAME_OP_KEYBOARD_PRESS] = "frame_keyboard_press",
+        [FRAME_OP_KEYBOARD_RELEASE] = "frame_keyboard_release",
+        [FRAME_OP_KEYBOARD_TYPE] = "frame_keyboard_type",
+    };
+
+    uint8_t const op = len > 1 ? frame[1] : 0;
+    uint8_t const *p = frame + 3;
+    uint8_t const plen = len > 2 ? frame[2] : 0;
+    char const *name = op < TU_ARRAY_SIZE(op_names) && op_names[op] ? op_names[op] : "frame_other";
+
+    c->name = name_index(name, strlen(name));
+    c->match = MATCH_NONE;
+    if (len < 4u + plen)
+    {
+        return;
+    }
+
+    switch (op)
+    {
+    case FRAME_OP_MOUSE_MOVE:
+        c->ep = EP_MOUSE;
+        c->match = MATCH_POSITION;
+        c->arg[0] = (int16_t)tu_unaligned_read16(p);
+        c->arg[1] = (int16_t)tu_unaligned_read16(p + 2);
+        break;
+
+    case FRAME_OP_MOUSE_CLICK:
+    case FRAME_OP_MOUSE_PRESS:
+        c->ep = EP_MOUSE;
+        c->match = op == FRAME_OP_MOUSE_CLICK ? MATCH_BUTTONS_SET : MATCH_BUTTONS;
+        c->arg[0] = plen ? p[0] : 0;
+        break;
+
+    case FRAME_OP_MOUSE_RELEASE:
+        c->ep = EP_MOUSE;
+        c->match = MATCH_BUTTONS;
+        c->arg[0] = 0;
+        break;
+
+    case FRAME_OP_MOUSE_PATH:
+        c->ep = EP_MOUSE;
+        c->match = MATCH_ANY;
+        break;
+
+    case FRAME_OP_MOUSE_REL_MOVE:
+    case FRAME_OP_MOUSE_REL_CLICK:
+    case FRAME_OP_MOUSE_REL_PRESS:
+    case FRAME_OP_MOUSE_REL_RELEASE:
+    case FRAME_OP_MOUSE_REL_PATH:
+        c->ep = EP_MOUSE_REL;
+        c->match = MATCH_ANY;
+        break;
+
+    case FRAME_OP_KEYBOARD_KEYSTROKE:
+    case FRAME_OP_KEYBOARD_PRESS:
+    case FRAME_OP_KEYBOARD_RELEASE:
+        c->ep = EP_KEYBOARD;
+        c->match = op == FRAME_OP_KEYBOARD_RELEASE ? MATCH_KEY_UP : MATCH_KEY_DOWN;
+        c->arg[0] = plen ? p[0] : 0;
+        if (op == FRAME_OP_KEYBOARD_RELEASE && plen == 0)
+        {
+            c->match = MATCH_ANY; // release all
+        }
+        break;
+
+    case FRAME_OP_KEYBOARD_TYPE:
+        c->ep = EP_KEYBOARD;
+        c->match = MATCH_ANY;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void stream_append(uint8_t const *bytes, uint32_t len)
+{
+    stream.data = realloc(stream.data, stream.len + len);
+    memcpy(stream.data + stream.len, bytes, len);
+    stream.len += len;
+}
+
+static void stream_load(FILE *f, uint32_t repeat)
+{
+    char line[512];
+    uint32_t const first = stream.count;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 0 || line[0] == '#')
+        {
+            continue;
+        }
+
+        stream.cmd = realloc(stream.cmd, (stream.count + 1) * sizeof(command_t));
+        command_t *c = &stream.cmd[stream.count++];
+        memset(c, 0, sizeof(*c));
+
+        if (strncmp(line, "frame ", 6) == 0)
+        {
+            uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+            uint32_t n = 0;
+            char *s = line + 6;
+            char *end;
+
+            for (unsigned long v = strtoul(s, &end, 16); end != s && n < sizeof(frame); v = strtoul(s, &end, 16))
+            {
+                frame[n++] = (uint8_t)v;
+                s = end;
+            }
+            classify_frame(c, frame, n);
+            stream_append(frame, n);
+        }
+        else
+        {
+            classify_text(c, line);
+            stream_append((uint8_t const *)line, (uint32_t)strlen(line));
+            stream_append((uint8_t const *)"\n", 1);
+        }
+        c->end = stream.len;
+    }
+
+    // Repeats reuse the parsed commands with shifted offsets
+    uint32_t const count = stream.count - first;
+    uint32_t const bytes = stream.len;
+    stream.data = realloc(stream.data, (size_t)bytes * repeat);
+    for (uint32_t r = 1; r < repeat; r++)
+    {
+        memcpy(stream.data + stream.len, stream.data, bytes);
+        stream.len += bytes;
+        stream.cmd = realloc(stream.cmd, (stream.count + count) * sizeof(command_t));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            command_t c = stream.cmd[first + i];
+            c.end += r * bytes;
+            stream.cmd[stream.count++] = c;
+        }
+    }
+}
+
+// UART source: commands start at the configured rate, bytes within a
+// command follow back to back at the line rate
+static int stream_source(uint64_t time_us, void *ctx)
+{
+    (void)ctx;
+
+    if (stream.pos >= stream.len)
+    {
+        return SIM_UART_EOF;
+    }
+
+    if (stream.pos == 0)
+    {
+        stream.start_us = time_us;
+    }
+
+    // First byte of the next command waits for its slot
+    if (stream.pos == stream.sent_end && stream.interval_us &&
+        time_us < stream.start_us + stream.next * stream.interval_us)
+    {
+        return SIM_UART_IDLE;
+    }
+
+    uint8_t const c = stream.data[stream.pos++];
+
+    if (stream.next < stream.count && stream.pos == stream.cmd[stream.next].end)
+    {
+        stream.cmd[stream.next].arrival_us = time_us;
+        stream.sent_end = stream.pos;
+        stream.next++;
+    }
+    return c;
+}
+
+//--------------------------------------------------------------------+
+// Matching
+//--------------------------------------------------------------------+
+static bool key_down(uint8_t const *data, uint16_t len, uint8_t key)
+{
+    if (key >= HID_KEY_CONTROL_LEFT && key <= HID_KEY_GUI_RIGHT)
+    {
+        return len && (data[0] & TU_BIT(key - HID_KEY_CONTROL_LEFT));
+    }
+
+    if (len == sizeof(hid_keyboard_report_t))
+    {
+        // Boot protocol: key array
+        for (uint8_t i = 2; i < len; i++)
+        {
+            if (data[i] == key)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // NKRO bitmap after modifier and reserved byte
+    uint16_t const byte = (uint16_t)(2 + key / 8);
+    return byte < len && (data[byte] & TU_BIT(key & 7));
+}
+
+static bool matches(command_t const *c, uint8_t const *data, uint16_t len)
+{
+    switch (c->match)
+    {
+    case MATCH_ANY:
+        return true;
+
+    case MATCH_POSITION:
+        return len >= 5 && (int16_t)tu_unaligned_read16(data + 1) == c->arg[0] &&
+               (int16_t)tu_unaligned_read16(data + 3) == c->arg[1];
+
+    case MATCH_BUTTONS:
+        return len && data[0] == c->arg[0];
+
+    case MATCH_BUTTONS_SET:
+        return len && (data[0] & c->arg[0]) == c->arg[0];
+
+    case MATCH_KEY_DOWN:
+        return key_down(data, len, (uint8_t)c->arg[0]);
+
+    case MATCH_KEY_UP:
+        return !key_down(data, len, (uint8_t)c->arg[0]);
+
+    default:
+        return false;
+    }
+}
+
+static void on_armed(uint8_t ep_addr)
+{
+    seen_at_arm[tu_edpt_number(ep_addr)] = sim_uart_rx_seen();
+}
+
+static void on_report(uint64_t time_us, uint8_t ep_addr, uint8_t const *data, uint16_t len)
+{
+    uint8_t const n = tu_edpt_number(ep_addr);
+    uint32_t const seen = seen_at_arm[n];
+    uint32_t unmatched = stream.count; // oldest command still waiting on this endpoint
+
+    for (uint32_t i = first_pending[n]; i < stream.count && stream.cmd[i].end <= seen; i++)
+    {
+        command_t *c = &stream.cmd[i];
+
+        if (c->ep != ep_addr || c->match == MATCH_NONE || c->done_us || c->superseded)
+        {
+            continue;
+        }
+
+        if (!matches(c, data, len))
+        {
+            unmatched = tu_min32(unmatched, i);
+            continue;
+        }
+
+        // Whatever the device did not show before a later command on the
+        // same endpoint was overwritten by it
+        c->done_us = time_us;
+        for (uint32_t j = unmatched; j < i; j++)
+        {
+            command_t *d = &stream.cmd[j];
+            d->superseded = d->ep == ep_addr && d->match != MATCH_NONE && !d->done_us;
+        }
+        unmatched = stream.count;
+    }
+
+    // Skip over what is settled, commands of other endpoints included
+    while (first_pending[n] < stream.count && first_pending[n] < unmatched && stream.cmd[first_pending[n]].end <= seen)
+    {
+        first_pending[n]++;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Results
+//--------------------------------------------------------------------+
+static int compare_u32(void const *a, void const *b)
+{
+    uint32_t const x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted values
+static uint32_t percentile(uint32_t const *v, uint32_t n, uint32_t p)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)p * n + 99) / 100);
+    return v[rank ? rank - 1 : 0];
+}
+
+static void print_results(FILE *out, char const *stream_name, uint32_t rate, uint32_t loop_us, bool configured)
+{
+    uint32_t *latency = malloc((stream.count + 1) * sizeof(uint32_t));
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"revision\": \"%s\",\n", PICO_HID_REVISION);
+    fprintf(out, "  \"stream\": \"%s\",\n", stream_name);
+    fprintf(out, "  \"rate\": %lu,\n", (unsigned long)rate);
+    fprintf(out, "  \"loop_us\": %lu,\n", (unsigned long)loop_us);
+    fprintf(out, "  \"poll_interval_ms\": %u,\n", HID_POLL_INTERVAL_MS);
+    fprintf(out, "  \"configured\": %s,\n", configured ? "true" : "false");
+    fprintf(out, "  \"sim_ms\": %llu,\n", (unsigned long long)(sim_time_us / 1000));
+    fprintf(out, "  \"uart_bytes\": %lu,\n", (unsigned long)sim_uart_rx_bytes());
+    fprintf(out, "  \"commands\": {");
+
+    for (uint8_t name = 0; name < name_count; name++)
+    {
+        uint32_t count = 0, delivered = 0, unmeasured = 0;
+        uint32_t histogram[BENCH_HISTOGRAM_BUCKETS] = {0};
+
+        for (uint32_t i = 0; i < stream.count; i++)
+        {
+            command_t const *c = &stream.cmd[i];
+            if (c->name != name)
+            {
+                continue;
+            }
+
+            count++;
+            if (c->match == MATCH_NONE)
+            {
+                unmeasured++;
+            }
+            else if (c->done_us)
+            {
+                uint32_t const us = (uint32_t)(c->done_us - c->arrival_us);
+                uint8_t b = 0;
+                while (b < BENCH_HISTOGRAM_BUCKETS - 1 && us > ((uint32_t)BENCH_HISTOGRAM_MIN_US << b))
+                {
+                    b++;
+                }
+                histogram[b]++;
+                latency[delivered++] = us;
+            }
+        }
+
+        qsort(latency, delivered, sizeof(uint32_t), compare_u32);
+
+        fprintf(out, "%s\n    \"%s\": {\"count\": %lu, \"delivered\": %lu, \"dropped\": %lu, \"unmeasured\": %lu, ",
+                name ? "," : "", names[name], (unsigned long)count, (unsigned long)delivered,
+                (unsigned long)(count - delivered - unmeasured), (unsigned long)unmeasured);
+        fprintf(out, "\"p50_us\": %lu, \"p99_us\": %lu, \"max_us\": %lu, \"histogram_us\": {",
+                (unsigned long)percentile(latency, delivered, 50), (unsigned long)percentile(latency, delivered, 99),
+                (unsigned long)(delivered ? latency[delivered - 1] : 0));
+        for (uint8_t b = 0; b < BENCH_HISTOGRAM_BUCKETS; b++)
+        {
+            if (b < BENCH_HISTOGRAM_BUCKETS - 1)
+            {
+                fprintf(out, "%s\"le_%lu\": %lu", b ? ", " : "", (unsigned long)BENCH_HISTOGRAM_MIN_US << b,
+                        (unsigned long)histogram[b]);
+            }
+            else
+            {
+                fprintf(out, ", \"more\": %lu", (unsigned long)histogram[b]);
+            }
+        }
+        fprintf(out, "}}");
+    }
+
+    fprintf(out, "\n  },\n  \"endpoints\": {");
+    bool first = true;
+    for (uint8_t n = 1; n < 16; n++)
+    {
+        if (sim_usb_stats.reports[n] || sim_usb_stats.nak_polls[n])
+        {
+            fprintf(out, "%s\n    \"0x%02x\": {\"reports\": %lu, \"nak_polls\": %lu}", first ? "" : ",", 0x80 | n,
+                    (unsigned long)sim_usb_stats.reports[n], (unsigned long)sim_usb_stats.nak_polls[n]);
+            first = false;
+        }
+    }
+    fprintf(out, "\n  }\n}\n");
+
+    free(latency);
+}
+
+static void usage(char const *name)
+{
+    fprintf(stderr,
+            "usage: %s [--rate N] [--repeat N] [--loop-us N] [--out FILE] stream\n"
+            "  --rate     commands per second, 0 = back to back at the line rate (default 0)\n"
+            "  --repeat   replay the stream N times (default 1)\n"
+            "  --loop-us  virtual time of one main loop pass (default 5)\n"
+            "  --out      write the JSON results here instead of stdout\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option const options[] = {
+        {"rate", required_argument, NULL, 'r'},
+        {"repeat", required_argument, NULL, 'n'},
+        {"loop-us", required_argument, NULL, 'l'},
+        {"out", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    uint32_t rate = 0;
+    uint32_t repeat = 1;
+    uint32_t loop_us = 5;
+    FILE *out = stdout;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            rate = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            repeat = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            loop_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (!out)
+            {
+                perror(optarg);
+                return 2;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[optind], "r");
+    if (!f)
+    {
+        perror(argv[optind]);
+        return 2;
+    }
+    stream_load(f, repeat ? repeat : 1);
+    fclose(f);
+    stream.interval_us = rate ? 1000000u / rate : 0;
+
+    // The firmware's UART echo is not part of the results
+    FILE *devnull = fopen("/dev/null", "w");
+
+    sim_board_init();
+    sim_usb_hooks_t const hooks = {.armed = on_armed, .report = on_report};
+    sim_usb_init(&hooks);
+    sim_uart_init_source(stream_source, NULL, devnull);
+
+    pico_hid_init();
+    bool const configured = sim_run(loop_us, BENCH_SETTLE_MS, BENCH_MAX_MS);
+
+    print_results(out, argv[optind], rate, loop_us, configured);
+    return configured ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// Board support for the host simulation: virtual clock, LED, button and the
+// flash array behind XIP_BASE
+
+#include <string.h>
+
+#include "bsp/board_api.h"
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/sync.h"
+
+#include "pico_hid.h"
+#include "sim.h"
+
+#define SIM_ENUMERATION_TIMEOUT_MS 1000
+
+uint64_t sim_time_us;
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+void sim_board_init(void)
+{
+    sim_time_us = 0;
+    memset(sim_flash, 0xff, sizeof(sim_flash)); // erased
+}
+
+void sim_advance(uint32_t us)
+{
+    uint64_t const end = sim_time_us + us;
+
+    // Frames start on every ms boundary crossed
+    while ((sim_time_us / 1000 + 1) * 1000 <= end)
+    {
+        sim_time_us = (sim_time_us / 1000 + 1) * 1000;
+        sim_usb_frame();
+        sim_uart_service();
+    }
+    sim_time_us = end;
+
+    sim_usb_service();
+    sim_uart_service();
+}
+
+bool sim_run(uint32_t loop_us, uint32_t settle_ms, uint32_t max_ms)
+{
+    uint64_t idle_since_us = sim_time_us;
+    uint64_t const max_us = sim_time_us + (uint64_t)max_ms * 1000;
+
+    while (sim_time_us < max_us)
+    {
+        sim_advance(loop_us ? loop_us : 1);
+        pico_hid_task();
+
+        if (!sim_usb_configured())
+        {
+            if (sim_usb_stats.configured_us == 0 && sim_time_us >= SIM_ENUMERATION_TIMEOUT_MS * 1000ull)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // Done once the input is consumed and nothing moved for settle_ms
+        if (!sim_uart_input_done() || sim_usb_in_busy() || sim_usb_control_busy())
+        {
+            idle_since_us = sim_time_us;
+        }
+        else if (sim_time_us - idle_since_us >= (uint64_t)settle_ms * 1000)
+        {
+            break;
+        }
+    }
+
+    return sim_usb_stats.configured_us != 0;
+}
+
+//--------------------------------------------------------------------+
+// Board API
+//--------------------------------------------------------------------+
+void board_init(void)
+{
+}
+
+void board_led_write(bool state)
+{
+    (void)state;
+}
+
+uint32_t board_button_read(void)
+{
+    return 0;
+}
+
+uint32_t board_millis(void)
+{
+    return (uint32_t)(sim_time_us / 1000);
+}
+
+//--------------------------------------------------------------------+
+// Flash and interrupts
+//--------------------------------------------------------------------+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    memset(sim_flash + flash_offs, 0xff, count);
+}
+
+void flash_range_program(uint32_t flash_offs, uint8_t const *data, size_t count)
+{
+    // Programming only clears bits, like NOR flash
+    for (size_t i = 0; i < count; i++)
+    {
+        sim_flash[flash_offs + i] &= data[i];
+    }
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
@@ -0,0 +1,523 @@
+// Simulated device controller and USB host, modeled on tinyusb's
+// test/fuzz/dcd_fuzz.cc. Instead of fuzzed data the host side enumerates the
+// device like a PC would and then polls every interrupt IN endpoint at its
+// bInterval on a 1 ms frame clock. A transfer armed with dcd_edpt_xfer() is
+// acknowledged at the next poll of its endpoint, just like the hardware
+// answers an IN token with the buffered packet or a NAK.
+
+#include <string.h>
+
+#include "tusb.h"
+#include "device/dcd.h"
+
+#include "sim.h"
+
+#define SIM_RHPORT 0
+#define SIM_DEV_ADDR 1
+#define SIM_ENDPOINTS 16
+#define SIM_CTRL_BUFSIZE 512
+#define SIM_RESET_FRAMES 2 // frames between attach and the bus reset, and between reset and the first request
+
+typedef struct
+{
+    uint8_t *buffer;
+    uint16_t len;
+    bool busy;     // transfer armed, waiting for the host
+    bool opened;   // opened by dcd_edpt_open()
+    uint8_t type;  // tusb_xfer_type_t
+    uint8_t interval;
+} sim_ep_t;
+
+typedef enum
+{
+    HOST_DETACHED,
+    HOST_ATTACHED, // waiting for the bus reset
+    HOST_RESET,    // waiting to start enumeration
+    HOST_ENUMERATING,
+    HOST_CONFIGURED
+} host_state_t;
+
+// Standard requests the host sends after a bus reset, in order
+typedef enum
+{
+    ENUM_GET_DEVICE,
+    ENUM_SET_ADDRESS,
+    ENUM_GET_CONFIG_HEADER,
+    ENUM_GET_CONFIG,
+    ENUM_SET_CONFIG,
+    ENUM_DONE
+} enum_step_t;
+
+typedef struct
+{
+    bool active;
+    tusb_control_request_t request;
+    uint8_t data[SIM_CTRL_BUFSIZE]; // IN data received, or OUT data to send
+    uint16_t len;                   // bytes received / sent so far
+    bool stalled;
+} sim_ctrl_t;
+
+static struct
+{
+    bool interrupts_enabled;
+    bool sof_enabled;
+    bool connected;
+    bool suspended; // bus idle: no SOFs, no polls, the host's frame count runs on
+    uint8_t address;
+    host_state_t host;
+    enum_step_t step;
+    uint32_t state_frame; // frame the host state was entered
+    sim_ep_t ep[SIM_ENDPOINTS][2];
+    sim_ctrl_t ctrl;
+    uint16_t config_len;
+} sim;
+
+sim_usb_stats_t sim_usb_stats;
+static sim_usb_hooks_t hooks;
+
+//--------------------------------------------------------------------+
+// Host side
+//--------------------------------------------------------------------+
+static void host_set_state(host_state_t state)
+{
+    sim.host = state;
+    sim.state_frame = sim_usb_stats.frames;
+}
+
+static void host_detach(void)
+{
+    memset(sim.ep, 0, sizeof(sim.ep));
+    memset(&sim.ctrl, 0, sizeof(sim.ctrl));
+    sim.address = 0;
+    sim.suspended = false;
+    host_set_state(HOST_DETACHED);
+}
+
+static void ctrl_start(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength)
+{
+    sim_ctrl_t *c = &sim.ctrl;
+
+    memset(c, 0, sizeof(*c));
+    c->active = true;
+    c->request.bmRequestType = bmRequestType;
+    c->request.bRequest = bRequest;
+    c->request.wValue = wValue;
+    c->request.wIndex = wIndex;
+    c->request.wLength = wLength;
+
+    dcd_event_setup_received(SIM_RHPORT, (uint8_t const *)&c->request, true);
+}
+
+// Next standard request of the enumeration, once the previous one is done
+static void host_enumerate(void)
+{
+    switch (sim.step)
+    {
+    case ENUM_GET_DEVICE:
+        ctrl_start(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, sizeof(tusb_desc_device_t));
+        break;
+
+    case ENUM_SET_ADDRESS:
+        ctrl_start(0x00, TUSB_REQ_SET_ADDRESS, SIM_DEV_ADDR, 0, 0);
+        break;
+
+    case ENUM_GET_CONFIG_HEADER:
+        ctrl_start(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0, sizeof(tusb_desc_configuration_t));
+        break;
+
+    case ENUM_GET_CONFIG:
+        ctrl_start(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0, sim.config_len);
+        break;
+
+    case ENUM_SET_CONFIG:
+        ctrl_start(0x00, TUSB_REQ_SET_CONFIGURATION, 1, 0, 0);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// A control request finished its status stage (or stalled)
+static void host_ctrl_done(void)
+{
+    sim_ctrl_t *c = &sim.ctrl;
+
+    c->active = false;
+    if (c->stalled)
+    {
+        sim_usb_stats.control_stalls++;
+    }
+
+    if (sim.host != HOST_ENUMERATING)
+    {
+        return;
+    }
+
+    if (c->stalled)
+    {
+        // A real host would retry or give up, the simulation just stops here
+        host_set_state(HOST_RESET);
+        sim.step = ENUM_DONE;
+        return;
+    }
+
+    if (sim.step == ENUM_GET_CONFIG_HEADER)
+    {
+        tusb_desc_configuration_t const *desc = (tusb_desc_configuration_t const *)c->data;
+        sim.config_len = tu_min16(tu_le16toh(desc->wTotalLength), SIM_CTRL_BUFSIZE);
+    }
+
+    sim.step++;
+    if (sim.step == ENUM_DONE)
+    {
+        host_set_state(HOST_CONFIGURED);
+        sim_usb_stats.configured_us = sim_time_us;
+    }
+}
+
+void sim_usb_init(sim_usb_hooks_t const *h)
+{
+    memset(&sim, 0, sizeof(sim));
+    memset(&sim_usb_stats, 0, sizeof(sim_usb_stats));
+    memset(&hooks, 0, sizeof(hooks));
+    if (h)
+    {
+        hooks = *h;
+    }
+}
+
+void sim_usb_replug(void)
+{
+    uint32_t const frames = sim_usb_stats.frames;
+
+    memset(&sim_usb_stats, 0, sizeof(sim_usb_stats));
+    sim_usb_stats.frames = frames;
+
+    host_detach();
+    dcd_event_bus_signal(SIM_RHPORT, DCD_EVENT_UNPLUGGED, true);
+    if (sim.connected)
+    {
+        host_set_state(HOST_ATTACHED);
+    }
+}
+
+void sim_usb_suspend(bool suspend)
+{
+    if (sim.host != HOST_CONFIGURED || suspend == sim.suspended)
+    {
+        return;
+    }
+
+    sim.suspended = suspend;
+    dcd_event_bus_signal(SIM_RHPORT, suspend ? DCD_EVENT_SUSPEND : DCD_EVENT_RESUME, true);
+}
+
+void sim_usb_service(void)
+{
+    sim_ctrl_t *c = &sim.ctrl;
+
+    if (sim.host == HOST_ENUMERATING && !c->active)
+    {
+        host_enumerate();
+        return;
+    }
+
+    if (!c->active)
+    {
+        return;
+    }
+
+    bool const dir_in = c->request.bmRequestType_bit.direction == TUSB_DIR_IN;
+    sim_ep_t *in = &sim.ep[0][TUSB_DIR_IN];
+    sim_ep_t *out = &sim.ep[0][TUSB_DIR_OUT];
+
+    // One stage per pass: data packets, then the status stage in the other direction
+    if (in->busy)
+    {
+        uint16_t const len = in->len;
+        in->busy = false;
+
+        if (dir_in && len)
+        {
+            uint16_t const n = tu_min16(len, (uint16_t)(SIM_CTRL_BUFSIZE - c->len));
+            memcpy(c->data + c->len, in->buffer, n);
+            c->len = (uint16_t)(c->len + n);
+        }
+        dcd_event_xfer_complete(SIM_RHPORT, tu_edpt_addr(0, TUSB_DIR_IN), len, XFER_RESULT_SUCCESS, true);
+
+        if (!dir_in)
+        {
+            host_ctrl_done();
+        }
+    }
+    else if (out->busy)
+    {
+        uint16_t len = 0;
+        out->busy = false;
+
+        if (!dir_in)
+        {
+            // OUT data stage, packets up to the buffer the stack gave us
+            len = tu_min16(out->len, (uint16_t)(c->request.wLength - c->len));
+            memcpy(out->buffer, c->data + c->len, len);
+            c->len = (uint16_t)(c->len + len);
+        }
+        dcd_event_xfer_complete(SIM_RHPORT, tu_edpt_addr(0, TUSB_DIR_OUT), len, XFER_RESULT_SUCCESS, true);
+
+        if (dir_in)
+        {
+            host_ctrl_done();
+        }
+    }
+}
+
+void sim_usb_frame(void)
+{
+    uint32_t const frame = ++sim_usb_stats.frames;
+
+    if (!sim.connected || !sim.interrupts_enabled)
+    {
+        return;
+    }
+
+    switch (sim.host)
+    {
+    case HOST_ATTACHED:
+        if (frame - sim.state_frame >= SIM_RESET_FRAMES)
+        {
+            dcd_event_bus_reset(SIM_RHPORT, TUSB_SPEED_FULL, true);
+            host_set_state(HOST_RESET);
+            sim.step = ENUM_GET_DEVICE;
+        }
+        return;
+
+    case HOST_RESET:
+        if (sim.step == ENUM_GET_DEVICE && frame - sim.state_frame >= SIM_RESET_FRAMES)
+        {
+            host_set_state(HOST_ENUMERATING);
+        }
+        return;
+
+    case HOST_CONFIGURED:
+        if (sim.suspended)
+        {
+            return;
+        }
+        break;
+
+    default:
+        return;
+    }
+
+    if (sim.sof_enabled)
+    {
+        dcd_event_sof(SIM_RHPORT, frame & 0x7ff, true);
+    }
+
+    // IN tokens for the interrupt endpoints due in this frame
+    for (uint8_t n = 1; n < SIM_ENDPOINTS; n++)
+    {
+        sim_ep_t *ep = &sim.ep[n][TUSB_DIR_IN];
+
+        if (!ep->opened || ep->type != TUSB_XFER_INTERRUPT || frame % ep->interval)
+        {
+            continue;
+        }
+
+        if (!ep->busy)
+        {
+            sim_usb_stats.nak_polls[n]++;
+            continue;
+        }
+
+        ep->busy = false;
+        sim_usb_stats.reports[n]++;
+        if (hooks.report)
+        {
+            hooks.report(sim_time_us, tu_edpt_addr(n, TUSB_DIR_IN), ep->buffer, ep->len);
+        }
+        dcd_event_xfer_complete(SIM_RHPORT, tu_edpt_addr(n, TUSB_DIR_IN), ep->len, XFER_RESULT_SUCCESS, true);
+    }
+}
+
+bool sim_usb_configured(void)
+{
+    return sim.host == HOST_CONFIGURED;
+}
+
+bool sim_usb_in_busy(void)
+{
+    for (uint8_t n = 1; n < SIM_ENDPOINTS; n++)
+    {
+        if (sim.ep[n][TUSB_DIR_IN].busy)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sim_usb_control(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength,
+                     void const *data)
+{
+    if (sim.host != HOST_CONFIGURED || sim.ctrl.active || wLength > SIM_CTRL_BUFSIZE)
+    {
+        return false;
+    }
+
+    ctrl_start(bmRequestType, bRequest, wValue, wIndex, wLength);
+    if (data && !(bmRequestType & TUSB_DIR_IN_MASK))
+    {
+        memcpy(sim.ctrl.data, data, wLength);
+    }
+    return true;
+}
+
+bool sim_usb_control_busy(void)
+{
+    return sim.ctrl.active;
+}
+
+//--------------------------------------------------------------------+
+// Controller API
+//--------------------------------------------------------------------+
+void dcd_init(uint8_t rhport)
+{
+    (void)rhport;
+
+    // The RP2040 port enables the pull-up in dcd_init()
+    host_detach();
+    dcd_connect(rhport);
+}
+
+void dcd_int_handler(uint8_t rhport)
+{
+    // Events are raised by sim_usb_service()/sim_usb_frame() instead
+    (void)rhport;
+}
+
+void dcd_int_enable(uint8_t rhport)
+{
+    (void)rhport;
+    sim.interrupts_enabled = true;
+}
+
+void dcd_int_disable(uint8_t rhport)
+{
+    (void)rhport;
+    sim.interrupts_enabled = false;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr)
+{
+    sim.address = dev_addr;
+
+    // Respond with status
+    dcd_edpt_xfer(rhport, tu_edpt_addr(0, TUSB_DIR_IN), NULL, 0);
+}
+
+void dcd_remote_wakeup(uint8_t rhport)
+{
+    (void)rhport;
+}
+
+void dcd_connect(uint8_t rhport)
+{
+    (void)rhport;
+
+    if (!sim.connected)
+    {
+        sim.connected = true;
+        host_set_state(HOST_ATTACHED);
+    }
+}
+
+void dcd_disconnect(uint8_t rhport)
+{
+    if (sim.connected)
+    {
+        sim.connected = false;
+        host_detach();
+        dcd_event_bus_signal(rhport, DCD_EVENT_UNPLUGGED, true);
+    }
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+    (void)rhport;
+    sim.sof_enabled = en;
+}
+
+//--------------------------------------------------------------------+
+// Endpoint API
+//--------------------------------------------------------------------+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_ep)
+{
+    (void)rhport;
+
+    uint8_t const n = tu_edpt_number(desc_ep->bEndpointAddress);
+    TU_VERIFY(n < SIM_ENDPOINTS);
+
+    sim_ep_t *ep = &sim.ep[n][tu_edpt_dir(desc_ep->bEndpointAddress)];
+    memset(ep, 0, sizeof(*ep));
+    ep->opened = true;
+    ep->type = desc_ep->bmAttributes.xfer;
+    ep->interval = desc_ep->bInterval ? desc_ep->bInterval : 1;
+    return true;
+}
+
+void dcd_edpt_close_all(uint8_t rhport)
+{
+    (void)rhport;
+
+    for (uint8_t n = 1; n < SIM_ENDPOINTS; n++)
+    {
+        memset(sim.ep[n], 0, sizeof(sim.ep[n]));
+    }
+}
+
+void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+    memset(&sim.ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], 0, sizeof(sim_ep_t));
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
+{
+    (void)rhport;
+
+    uint8_t const n = tu_edpt_number(ep_addr);
+    TU_VERIFY(n < SIM_ENDPOINTS);
+
+    sim_ep_t *ep = &sim.ep[n][tu_edpt_dir(ep_addr)];
+    ep->buffer = buffer;
+    ep->len = total_bytes;
+    ep->busy = true;
+
+    if (n && tu_edpt_dir(ep_addr) == TUSB_DIR_IN && hooks.armed)
+    {
+        hooks.armed(ep_addr);
+    }
+    return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+
+    // A stalled control endpoint ends the request
+    if (tu_edpt_number(ep_addr) == 0 && sim.ctrl.active)
+    {
+        sim.ep[0][TUSB_DIR_IN].busy = false;
+        sim.ep[0][TUSB_DIR_OUT].busy = false;
+        sim.ctrl.stalled = true;
+        host_ctrl_done();
+    }
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+    (void)ep_addr;
+}
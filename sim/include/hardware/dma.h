@@ -0,0 +1,58 @@
+#ifndef _SIM_HARDWARE_DMA_H_
+#define _SIM_HARDWARE_DMA_H_
+
+// Host stand-in for the pico-sdk DMA API, enough for a UART RX channel
+// writing into a ring buffer
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    enum dma_channel_transfer_size
+    {
+        DMA_SIZE_8 = 0,
+        DMA_SIZE_16 = 1,
+        DMA_SIZE_32 = 2
+    };
+
+    typedef struct
+    {
+        uint8_t size;
+        bool read_increment;
+        bool write_increment;
+        bool ring_write;
+        uint8_t ring_size_bits; // 0 = no wrapping
+        unsigned dreq;
+    } dma_channel_config;
+
+    typedef struct
+    {
+        volatile uint32_t read_addr;
+        volatile uint32_t write_addr;
+        volatile uint32_t transfer_count;
+        volatile uint32_t ctrl_trig;
+    } dma_channel_hw_t;
+
+    int dma_claim_unused_channel(bool required);
+    dma_channel_config dma_channel_get_default_config(unsigned channel);
+
+    void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+    void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+    void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+    void channel_config_set_ring(dma_channel_config *c, bool write, unsigned size_bits);
+    void channel_config_set_dreq(dma_channel_config *c, unsigned dreq);
+
+    void dma_channel_configure(unsigned channel, dma_channel_config const *config, volatile void *write_addr,
+                               volatile void const *read_addr, unsigned transfer_count, bool trigger);
+    dma_channel_hw_t *dma_channel_hw_addr(unsigned channel);
+    void dma_channel_set_trans_count(unsigned channel, uint32_t trans_count, bool trigger);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_HARDWARE_DMA_H_ */
@@ -0,0 +1,28 @@
+#ifndef _SIM_HARDWARE_FLASH_H_
+#define _SIM_HARDWARE_FLASH_H_
+
+// Host stand-in for the pico-sdk flash API, backed by an array mapped at XIP_BASE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void flash_range_erase(uint32_t flash_offs, size_t count);
+    void flash_range_program(uint32_t flash_offs, uint8_t const *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_HARDWARE_FLASH_H_ */
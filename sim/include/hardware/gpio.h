@@ -0,0 +1,20 @@
+#ifndef _SIM_HARDWARE_GPIO_H_
+#define _SIM_HARDWARE_GPIO_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    enum gpio_function
+    {
+        GPIO_FUNC_UART = 2
+    };
+
+    void gpio_set_function(unsigned gpio, enum gpio_function fn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_HARDWARE_GPIO_H_ */
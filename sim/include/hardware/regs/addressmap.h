@@ -0,0 +1,11 @@
+#ifndef _SIM_HARDWARE_REGS_ADDRESSMAP_H_
+#define _SIM_HARDWARE_REGS_ADDRESSMAP_H_
+
+#include <stdint.h>
+
+// Flash contents live in an array on the host, XIP reads go there
+extern uint8_t sim_flash[];
+
+#define XIP_BASE ((uintptr_t)sim_flash)
+
+#endif /* _SIM_HARDWARE_REGS_ADDRESSMAP_H_ */
@@ -0,0 +1,55 @@
+#ifndef _SIM_HARDWARE_UART_H_
+#define _SIM_HARDWARE_UART_H_
+
+// Host stand-in for the pico-sdk UART API. Received bytes come from the
+// simulated line (sim/uart_sim.c) through the DMA model, transmitted bytes go
+// to the simulation's UART output.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        volatile uint32_t dr;
+    } uart_hw_t;
+
+    typedef struct uart_inst uart_inst_t;
+
+    extern uart_hw_t sim_uart0_hw;
+
+#define uart0 ((uart_inst_t *)&sim_uart0_hw)
+
+    typedef enum
+    {
+        UART_PARITY_NONE,
+        UART_PARITY_EVEN,
+        UART_PARITY_ODD
+    } uart_parity_t;
+
+    unsigned uart_init(uart_inst_t *uart, unsigned baudrate);
+    unsigned uart_set_baudrate(uart_inst_t *uart, unsigned baudrate);
+    void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+    void uart_set_format(uart_inst_t *uart, unsigned data_bits, unsigned stop_bits, uart_parity_t parity);
+    void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+
+    bool uart_is_writable(uart_inst_t *uart);
+    void uart_putc(uart_inst_t *uart, char c);
+    void uart_putc_raw(uart_inst_t *uart, char c);
+    void uart_puts(uart_inst_t *uart, char const *s);
+    void uart_write_blocking(uart_inst_t *uart, uint8_t const *src, size_t len);
+    void uart_tx_wait_blocking(uart_inst_t *uart);
+
+    unsigned uart_get_dreq(uart_inst_t *uart, bool is_tx);
+    uart_hw_t *uart_get_hw(uart_inst_t *uart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_HARDWARE_UART_H_ */
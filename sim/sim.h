@@ -0,0 +1,125 @@
+#ifndef _SIM_H_
+#define _SIM_H_
+
+// Host simulation of the pico_hid board: a simulated USB host and device
+// controller (dcd_sim.c), the UART RX line and DMA (uart_sim.c) and the
+// board clock, LED and flash (board_sim.c). sim_main.c runs the firmware
+// main loop against them on a virtual clock.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    //--------------------------------------------------------------------+
+    // Clock
+    //--------------------------------------------------------------------+
+
+    // Virtual time since power up. Only sim_advance() moves it
+    extern uint64_t sim_time_us;
+
+    // Move the clock forward, run the USB frames and UART bytes that fall due
+    void sim_advance(uint32_t us);
+
+    // Run the firmware main loop, one pass per loop_us of virtual time, until
+    // the UART input is consumed and the endpoints stayed idle for settle_ms,
+    // or for max_ms at most. Return false if the device never got configured
+    bool sim_run(uint32_t loop_us, uint32_t settle_ms, uint32_t max_ms);
+
+    //--------------------------------------------------------------------+
+    // USB host and device controller
+    //--------------------------------------------------------------------+
+
+    // Observers of the interrupt IN traffic, either may be NULL
+    typedef struct
+    {
+        // The firmware armed an IN transfer
+        void (*armed)(uint8_t ep_addr);
+
+        // The host received an IN report
+        void (*report)(uint64_t time_us, uint8_t ep_addr, uint8_t const *data, uint16_t len);
+    } sim_usb_hooks_t;
+
+    typedef struct
+    {
+        uint32_t frames;          // 1 ms frames since power up
+        uint32_t reports[16];     // IN transfers completed per endpoint number
+        uint32_t nak_polls[16];   // polls with no transfer armed while configured
+        uint32_t control_stalls;  // control requests the device stalled
+        uint64_t configured_us;   // time SET_CONFIGURATION completed, 0 = never
+    } sim_usb_stats_t;
+
+    extern sim_usb_stats_t sim_usb_stats;
+
+    void sim_usb_init(sim_usb_hooks_t const *hooks);
+
+    // Unplug the cable and plug it back in: the stack sees a disconnect and the
+    // host resets and enumerates the device again, as after power up
+    void sim_usb_replug(void);
+
+    // Suspend the configured device's bus or resume it. While suspended the
+    // host sends no SOFs and polls nothing, its frame count keeps running
+    void sim_usb_suspend(bool suspend);
+
+    // Advance control transfers, called on every main loop pass
+    void sim_usb_service(void);
+
+    // Start of a 1 ms frame: the host polls interrupt endpoints due in this frame
+    void sim_usb_frame(void);
+
+    bool sim_usb_configured(void);
+
+    // True while an IN transfer is armed on an interrupt endpoint
+    bool sim_usb_in_busy(void);
+
+    // Issue a control request once enumeration is done, data is copied for
+    // OUT requests. Return false if another request is still in progress
+    bool sim_usb_control(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength,
+                         void const *data);
+
+    // True while a control request is in progress
+    bool sim_usb_control_busy(void);
+
+    //--------------------------------------------------------------------+
+    // UART
+    //--------------------------------------------------------------------+
+
+#define SIM_UART_EOF (-1)  // no more input
+#define SIM_UART_IDLE (-2) // line idle for now, ask again later
+
+    // Next byte on the line, SIM_UART_IDLE or SIM_UART_EOF. time_us is the
+    // time the byte would finish arriving
+    typedef int (*sim_uart_source_t)(uint64_t time_us, void *ctx);
+
+    // Bytes from `in` are received at the baud rate the firmware selected,
+    // starting once the device is configured. Firmware output goes to `out`
+    void sim_uart_init(FILE *in, FILE *out);
+
+    // Same with the bytes coming from `source`, which can hold the line idle
+    void sim_uart_init_source(sim_uart_source_t source, void *ctx, FILE *out);
+
+    // Receive the bytes due by now, called from sim_advance()
+    void sim_uart_service(void);
+
+    // True once the whole input was received
+    bool sim_uart_input_done(void);
+
+    uint32_t sim_uart_rx_bytes(void);
+
+    // Bytes the firmware has picked up from the DMA ring so far
+    uint32_t sim_uart_rx_seen(void);
+
+    //--------------------------------------------------------------------+
+    // Board
+    //--------------------------------------------------------------------+
+    void sim_board_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SIM_H_ */
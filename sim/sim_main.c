@@ -0,0 +1,149 @@
+// Runs the pico_hid firmware on the host: the firmware main loop against the
+// simulated USB host, UART and clock in this directory.
+//
+//   pico_hid_sim [options] [input]
+//
+// `input` is a file or pipe ("-" for stdin) with the bytes sent over the
+// UART, text commands and/or binary frames. It is received at the baud rate
+// once the host has configured the device. The simulation stops when the
+// input is consumed and every endpoint stayed idle for --settle-ms.
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico_hid.h"
+#include "sim.h"
+
+#define SIM_DEFAULT_LOOP_US 5       // cost of one main loop pass on the RP2040
+#define SIM_DEFAULT_SETTLE_MS 20    // idle time after the input before stopping
+#define SIM_DEFAULT_MAX_MS 600000   // hard limit of the virtual run time
+
+static FILE *reports_file;
+
+static void log_report(uint64_t time_us, uint8_t ep_addr, uint8_t const *data, uint16_t len)
+{
+    if (!reports_file)
+    {
+        return;
+    }
+
+    fprintf(reports_file, "%llu 0x%02x", (unsigned long long)time_us, ep_addr);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        fprintf(reports_file, " %02x", data[i]);
+    }
+    fputc('\n', reports_file);
+}
+
+static void usage(char const *name)
+{
+    fprintf(stderr,
+            "usage: %s [--loop-us N] [--settle-ms N] [--max-ms N] [--uart-out FILE] [--reports FILE] [input]\n"
+            "  input          bytes received on the UART, '-' for stdin\n"
+            "  --loop-us      virtual time of one main loop pass (default %u)\n"
+            "  --settle-ms    idle time after the input before stopping (default %u)\n"
+            "  --max-ms       stop after this much virtual time (default %u)\n"
+            "  --uart-out     firmware UART output, default stdout\n"
+            "  --reports      log every IN report as '<time_us> <ep> <bytes...>'\n",
+            name, SIM_DEFAULT_LOOP_US, SIM_DEFAULT_SETTLE_MS, SIM_DEFAULT_MAX_MS);
+}
+
+static FILE *open_file(char const *path, char const *mode, FILE *dash)
+{
+    if (strcmp(path, "-") == 0)
+    {
+        return dash;
+    }
+
+    FILE *f = fopen(path, mode);
+    if (!f)
+    {
+        perror(path);
+        exit(2);
+    }
+    return f;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option const options[] = {
+        {"loop-us", required_argument, NULL, 'l'},
+        {"settle-ms", required_argument, NULL, 's'},
+        {"max-ms", required_argument, NULL, 'm'},
+        {"uart-out", required_argument, NULL, 'o'},
+        {"reports", required_argument, NULL, 'r'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    uint32_t loop_us = SIM_DEFAULT_LOOP_US;
+    uint32_t settle_ms = SIM_DEFAULT_SETTLE_MS;
+    uint32_t max_ms = SIM_DEFAULT_MAX_MS;
+    FILE *uart_out = stdout;
+    FILE *input = NULL;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            loop_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            settle_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            max_ms = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            uart_out = open_file(optarg, "w", stdout);
+            break;
+        case 'r':
+            reports_file = open_file(optarg, "w", stdout);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    if (optind < argc)
+    {
+        input = open_file(argv[optind], "rb", stdin);
+    }
+
+    sim_board_init();
+    sim_usb_hooks_t const hooks = {.armed = NULL, .report = log_report};
+    sim_usb_init(&hooks);
+    sim_uart_init(input, uart_out);
+
+    pico_hid_init();
+
+    bool const configured = sim_run(loop_us, settle_ms, max_ms);
+
+    fflush(uart_out);
+    if (reports_file)
+    {
+        fflush(reports_file);
+    }
+
+    fprintf(stderr, "sim: %llu ms, configured at %llu us, %lu UART bytes in, %lu control stalls\n",
+            (unsigned long long)(sim_time_us / 1000), (unsigned long long)sim_usb_stats.configured_us,
+            (unsigned long)sim_uart_rx_bytes(), (unsigned long)sim_usb_stats.control_stalls);
+    for (uint8_t n = 1; n < 16; n++)
+    {
+        if (sim_usb_stats.reports[n] || sim_usb_stats.nak_polls[n])
+        {
+            fprintf(stderr, "sim: ep 0x%02x %lu reports, %lu NAKed polls\n", 0x80 | n,
+                    (unsigned long)sim_usb_stats.reports[n], (unsigned long)sim_usb_stats.nak_polls[n]);
+        }
+    }
+
+    if (!configured)
+    {
+        fprintf(stderr, "sim: device was never configured\n");
+        return 1;
+    }
+    return 0;
+}
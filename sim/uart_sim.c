@@ -0,0 +1,344 @@
+// Simulated UART0 and the DMA channel draining it. Input bytes are read
+// from a file or pipe and arrive one per character time (10 bits at the baud
+// rate the firmware set), written by the DMA model into the ring buffer the
+// firmware configured. Transmitted bytes go straight to the output file.
+
+#include <string.h>
+
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#include "sim.h"
+
+#define SIM_DMA_CHANNELS 12
+#define SIM_UART_BITS_PER_CHAR 10 // start + 8 data + stop
+
+uart_hw_t sim_uart0_hw;
+
+static struct
+{
+    sim_uart_source_t source;
+    void *ctx;
+    FILE *out;
+    unsigned baudrate;
+    bool started;      // input starts once the device is configured
+    bool done;         // end of input reached
+    uint64_t next_us;  // arrival time of the next byte
+    uint32_t rx_bytes; // bytes received
+    uint32_t rx_seen;  // bytes received when the firmware last read the DMA transfer count
+    uint32_t lost;     // bytes received without an active DMA channel
+} uart;
+
+typedef struct
+{
+    bool claimed;
+    bool busy;
+    dma_channel_config config;
+    uint8_t *write_addr;
+} sim_dma_t;
+
+static sim_dma_t dma[SIM_DMA_CHANNELS];
+static dma_channel_hw_t dma_hw[SIM_DMA_CHANNELS];
+
+//--------------------------------------------------------------------+
+// Simulation side
+//--------------------------------------------------------------------+
+static int file_source(uint64_t time_us, void *ctx)
+{
+    (void)time_us;
+    int const c = fgetc((FILE *)ctx);
+    return c == EOF ? SIM_UART_EOF : c;
+}
+
+void sim_uart_init_source(sim_uart_source_t source, void *ctx, FILE *out)
+{
+    memset(&uart, 0, sizeof(uart));
+    memset(dma, 0, sizeof(dma));
+    memset(dma_hw, 0, sizeof(dma_hw));
+    uart.source = source;
+    uart.ctx = ctx;
+    uart.out = out;
+    uart.baudrate = 115200;
+    uart.done = (source == NULL);
+}
+
+void sim_uart_init(FILE *in, FILE *out)
+{
+    sim_uart_init_source(in ? file_source : NULL, in, out);
+}
+
+// The RX DREQ hands the byte to the first channel paced by it
+static void dma_receive(uint8_t c)
+{
+    for (unsigned ch = 0; ch < SIM_DMA_CHANNELS; ch++)
+    {
+        sim_dma_t *d = &dma[ch];
+
+        if (!d->busy || d->config.dreq != uart_get_dreq(uart0, false))
+        {
+            continue;
+        }
+
+        *d->write_addr = c;
+
+        uintptr_t addr = (uintptr_t)d->write_addr;
+        if (d->config.write_increment)
+        {
+            uintptr_t const mask = d->config.ring_write && d->config.ring_size_bits
+                                       ? ((uintptr_t)1 << d->config.ring_size_bits) - 1
+                                       : ~(uintptr_t)0;
+            addr = (addr & ~mask) | ((addr + 1) & mask);
+        }
+        d->write_addr = (uint8_t *)addr;
+
+        if (--dma_hw[ch].transfer_count == 0)
+        {
+            d->busy = false;
+        }
+        return;
+    }
+
+    uart.lost++;
+}
+
+void sim_uart_service(void)
+{
+    if (uart.done)
+    {
+        return;
+    }
+
+    if (!uart.started)
+    {
+        if (!sim_usb_configured())
+        {
+            return;
+        }
+        uart.started = true;
+        uart.next_us = sim_time_us;
+    }
+
+    uint64_t char_us = (1000000ull * SIM_UART_BITS_PER_CHAR + uart.baudrate / 2) / uart.baudrate;
+    char_us = char_us ? char_us : 1;
+
+    while (uart.next_us + char_us <= sim_time_us)
+    {
+        int const c = uart.source(uart.next_us + char_us, uart.ctx);
+        if (c == SIM_UART_EOF)
+        {
+            uart.done = true;
+            return;
+        }
+
+        if (c == SIM_UART_IDLE)
+        {
+            // The next start bit can come any time
+            uart.next_us = sim_time_us - char_us + 1;
+            return;
+        }
+
+        dma_receive((uint8_t)c);
+        uart.rx_bytes++;
+        uart.next_us += char_us;
+    }
+}
+
+bool sim_uart_input_done(void)
+{
+    return uart.done;
+}
+
+uint32_t sim_uart_rx_bytes(void)
+{
+    return uart.rx_bytes;
+}
+
+uint32_t sim_uart_rx_seen(void)
+{
+    return uart.rx_seen;
+}
+
+//--------------------------------------------------------------------+
+// UART API
+//--------------------------------------------------------------------+
+unsigned uart_init(uart_inst_t *u, unsigned baudrate)
+{
+    return uart_set_baudrate(u, baudrate);
+}
+
+unsigned uart_set_baudrate(uart_inst_t *u, unsigned baudrate)
+{
+    (void)u;
+    uart.baudrate = baudrate ? baudrate : 1;
+    return uart.baudrate;
+}
+
+void uart_set_hw_flow(uart_inst_t *u, bool cts, bool rts)
+{
+    (void)u;
+    (void)cts;
+    (void)rts;
+}
+
+void uart_set_format(uart_inst_t *u, unsigned data_bits, unsigned stop_bits, uart_parity_t parity)
+{
+    (void)u;
+    (void)data_bits;
+    (void)stop_bits;
+    (void)parity;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *u, bool enabled)
+{
+    (void)u;
+    (void)enabled;
+}
+
+bool uart_is_writable(uart_inst_t *u)
+{
+    (void)u;
+    return true;
+}
+
+void uart_putc_raw(uart_inst_t *u, char c)
+{
+    (void)u;
+    if (uart.out)
+    {
+        fputc(c, uart.out);
+    }
+}
+
+void uart_putc(uart_inst_t *u, char c)
+{
+    uart_putc_raw(u, c);
+}
+
+void uart_puts(uart_inst_t *u, char const *s)
+{
+    while (*s)
+    {
+        uart_putc(u, *s++);
+    }
+}
+
+void uart_write_blocking(uart_inst_t *u, uint8_t const *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uart_putc_raw(u, (char)src[i]);
+    }
+}
+
+void uart_tx_wait_blocking(uart_inst_t *u)
+{
+    (void)u;
+    if (uart.out)
+    {
+        fflush(uart.out);
+    }
+}
+
+unsigned uart_get_dreq(uart_inst_t *u, bool is_tx)
+{
+    (void)u;
+    return is_tx ? 20 : 21; // DREQ_UART0_TX, DREQ_UART0_RX
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *u)
+{
+    return (uart_hw_t *)u;
+}
+
+void gpio_set_function(unsigned gpio, enum gpio_function fn)
+{
+    (void)gpio;
+    (void)fn;
+}
+
+//--------------------------------------------------------------------+
+// DMA API
+//--------------------------------------------------------------------+
+int dma_claim_unused_channel(bool required)
+{
+    (void)required;
+
+    for (unsigned ch = 0; ch < SIM_DMA_CHANNELS; ch++)
+    {
+        if (!dma[ch].claimed)
+        {
+            dma[ch].claimed = true;
+            return (int)ch;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned channel)
+{
+    (void)channel;
+
+    dma_channel_config c = {
+        .size = DMA_SIZE_32,
+        .read_increment = true,
+        .write_increment = false,
+        .ring_write = false,
+        .ring_size_bits = 0,
+        .dreq = 0x3f, // permanent request
+    };
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->size = (uint8_t)size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    c->write_increment = incr;
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, unsigned size_bits)
+{
+    c->ring_write = write;
+    c->ring_size_bits = (uint8_t)size_bits;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, unsigned dreq)
+{
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(unsigned channel, dma_channel_config const *config, volatile void *write_addr,
+                           volatile void const *read_addr, unsigned transfer_count, bool trigger)
+{
+    (void)read_addr; // always the UART data register in this firmware
+
+    dma[channel].config = *config;
+    dma[channel].write_addr = (uint8_t *)write_addr;
+    dma[channel].busy = trigger && transfer_count;
+    dma_hw[channel].transfer_count = transfer_count;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(unsigned channel)
+{
+    // The firmware polls the transfer count to pick up received bytes
+    uart.rx_seen = uart.rx_bytes;
+    return &dma_hw[channel];
+}
+
+void dma_channel_set_trans_count(unsigned channel, uint32_t trans_count, bool trigger)
+{
+    dma_hw[channel].transfer_count = trans_count;
+    if (trigger)
+    {
+        dma[channel].busy = trans_count != 0;
+    }
+}
@@ -0,0 +1,141 @@
+// Microbenchmark of the text command dispatcher: times command_table_dispatch()
+// on one line of every firmware command (PICO_HID_COMMANDS, with handlers that
+// do nothing) next to the strcmp cascade and sscanf parsing it replaced.
+//
+//   bench_command_dispatch [iterations]
+//
+// prints one JSON object with the mean time per line in nanoseconds for each
+// command; the table's numbers should not depend on the command's position.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "command_table.h"
+#include "commands.h"
+
+#define BENCH_ITERATIONS 1000000ul
+
+static volatile uint32_t sink;
+
+#define COMMAND_HANDLER(name, min_args, max_args)          \
+    static bool cmd_##name(command_args_t const *args)     \
+    {                                                      \
+        sink += (uint32_t)args->count;                     \
+        return true;                                       \
+    }
+PICO_HID_COMMANDS(COMMAND_HANDLER)
+
+#define COMMAND_ENTRY(name, min_args, max_args) {#name, cmd_##name, min_args, max_args},
+static const command_t commands[] = {PICO_HID_COMMANDS(COMMAND_ENTRY)};
+
+// One typical line per command, in PICO_HID_COMMANDS order
+static char const *const lines[] = {
+    "mouse_move,100,200",
+    "mouse_rel_move,-5,7",
+    "mouse_click_left",
+    "mouse_click_right",
+    "mouse_press_left",
+    "mouse_press_right",
+    "mouse_release",
+    "mouse_path,0,0,800,600,300,3,400,0",
+    "mouse_rel_click_left",
+    "mouse_rel_click_right",
+    "mouse_rel_press_left",
+    "mouse_rel_press_right",
+    "mouse_rel_release",
+    "mouse_rel_path,200,100,300,1",
+    "keyboard_keystroke,4",
+    "keyboard_press,4",
+    "keyboard_release,4",
+    "type,Hello, World!",
+    "stats",
+    "led",
+    "poll_interval,1,2",
+    "queue_policy,0,2",
+    "ack,0",
+    "baud,115200",
+    "baud_save",
+    "frame",
+};
+
+TU_VERIFY_STATIC(TU_ARRAY_SIZE(lines) == TU_ARRAY_SIZE(commands), "one line per command");
+
+// The previous dispatcher: compare names in the order of process_command()
+// until one matches, then sscanf the arguments
+static void cascade_dispatch(char const *line)
+{
+    static char const *const order[] = {
+        "mouse_click_left", "mouse_click_right", "mouse_press_left", "mouse_press_right", "mouse_release",
+        "mouse_move,", "mouse_path,", "mouse_rel_click_left", "mouse_rel_click_right", "mouse_rel_press_left",
+        "mouse_rel_press_right", "mouse_rel_release", "mouse_rel_move,", "mouse_rel_path,", "keyboard_keystroke,",
+        "keyboard_press,", "keyboard_release,", "type,", "keyboard_release", "stats", "led", "poll_interval",
+        "poll_interval,", "queue_policy,",
+    };
+
+    for (size_t i = 0; i < TU_ARRAY_SIZE(order); i++)
+    {
+        size_t const len = strlen(order[i]);
+        bool const prefix = order[i][len - 1] == ',';
+        if (prefix ? strncmp(line, order[i], len) == 0 : strcmp(line, order[i]) == 0)
+        {
+            int16_t v[10];
+            sink += (uint32_t)sscanf(line + len, "%hd,%hd,%hd,%hd,%hd,%hd,%hd,%hd,%hd,%hd", &v[0], &v[1], &v[2],
+                                     &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9]);
+            return;
+        }
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long const iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+    if (iterations == 0)
+    {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    command_table_t table;
+    command_table_init(&table, commands, TU_ARRAY_SIZE(commands), PICO_HID_COMMAND_SEED);
+
+    printf("{\"iterations\": %lu, \"perfect\": %s, \"seed\": %lu, \"commands\": [", iterations,
+           table.perfect ? "true" : "false", (unsigned long)table.seed);
+
+    for (size_t i = 0; i < TU_ARRAY_SIZE(lines); i++)
+    {
+        if (!command_table_dispatch(&table, lines[i]))
+        {
+            fprintf(stderr, "\"%s\" not dispatched\n", lines[i]);
+            return 1;
+        }
+
+        uint64_t start = now_ns();
+        for (unsigned long n = 0; n < iterations; n++)
+        {
+            command_table_dispatch(&table, lines[i]);
+        }
+        double const table_ns = (double)(now_ns() - start) / (double)iterations;
+
+        start = now_ns();
+        for (unsigned long n = 0; n < iterations; n++)
+        {
+            cascade_dispatch(lines[i]);
+        }
+        double const cascade_ns = (double)(now_ns() - start) / (double)iterations;
+
+        printf("%s\n  {\"command\": \"%s\", \"table_ns\": %.1f, \"cascade_ns\": %.1f}", i ? "," : "",
+               commands[i].name, table_ns, cascade_ns);
+    }
+    printf("\n]}\n");
+    return 0;
+}
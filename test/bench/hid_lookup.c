@@ -0,0 +1,223 @@
+// Microbenchmark of the HID class driver's per-transfer dispatch: opens
+// CFG_TUD_HID interfaces (set at build time, see test/CMakeLists.txt) and
+// times hidd_xfer_cb() and hidd_control_xfer_cb() on the last one, the worst
+// case of a linear search. The usbd functions the driver calls are stubs.
+//
+//   bench_hid_lookup_<n> [iterations]
+//
+// prints one JSON object with the mean time per call in nanoseconds; the
+// numbers should not grow with the instance count.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+
+#define BENCH_ITERATIONS 10000000ul
+
+// interface + HID + IN and OUT endpoint descriptor of every instance
+#define BENCH_ITF_LEN (TUD_HID_INOUT_DESC_LEN)
+
+static uint8_t const report_desc[] = {TUD_HID_REPORT_DESC_GENERIC_INOUT(8)};
+static uint8_t config_desc[CFG_TUD_HID][BENCH_ITF_LEN];
+
+//--------------------------------------------------------------------+
+// usbd stubs
+//--------------------------------------------------------------------+
+bool tud_mounted(void)
+{
+    return true;
+}
+
+bool tud_suspended(void)
+{
+    return false;
+}
+
+bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const *p_desc, uint8_t ep_count, uint8_t xfer_type,
+                         uint8_t *ep_out, uint8_t *ep_in)
+{
+    (void)rhport;
+    (void)xfer_type;
+
+    for (uint8_t i = 0; i < ep_count; i++)
+    {
+        tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *)p_desc;
+        if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN)
+        {
+            *ep_in = desc_ep->bEndpointAddress;
+        }
+        else
+        {
+            *ep_out = desc_ep->bEndpointAddress;
+        }
+        p_desc = tu_desc_next(p_desc);
+    }
+    return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
+{
+    (void)rhport;
+    (void)ep_addr;
+    (void)buffer;
+    (void)total_bytes;
+    return true;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+    (void)ep_addr;
+    return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+    (void)ep_addr;
+    return true;
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
+{
+    (void)rhport;
+    (void)ep_addr;
+    return false;
+}
+
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en)
+{
+    (void)rhport;
+    (void)consumer;
+    (void)en;
+}
+
+void usbd_defer_func(osal_task_func_t func, void *param, bool in_isr)
+{
+    (void)in_isr;
+    func(param);
+}
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer, uint16_t len)
+{
+    (void)rhport;
+    (void)request;
+    (void)buffer;
+    (void)len;
+    return true;
+}
+
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const *request)
+{
+    (void)rhport;
+    (void)request;
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// HID callbacks
+//--------------------------------------------------------------------+
+uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
+{
+    (void)instance;
+    return report_desc;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer,
+                               uint16_t reqlen)
+{
+    (void)instance;
+    (void)report_id;
+    (void)report_type;
+    (void)buffer;
+    (void)reqlen;
+    return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer,
+                           uint16_t bufsize)
+{
+    (void)instance;
+    (void)report_id;
+    (void)report_type;
+    (void)buffer;
+    (void)bufsize;
+}
+
+//--------------------------------------------------------------------+
+// Benchmark
+//--------------------------------------------------------------------+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double time_xfer(uint8_t ep_addr, unsigned long iterations)
+{
+    uint64_t const start = now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        hidd_xfer_cb(0, ep_addr, XFER_RESULT_SUCCESS, 8);
+    }
+    return (double)(now_ns() - start) / (double)iterations;
+}
+
+static double time_control(uint8_t itf_num, unsigned long iterations)
+{
+    tusb_control_request_t const request = {
+        .bmRequestType_bit = {.recipient = TUSB_REQ_RCPT_INTERFACE,
+                              .type = TUSB_REQ_TYPE_CLASS,
+                              .direction = TUSB_DIR_IN},
+        .bRequest = HID_REQ_CONTROL_GET_IDLE,
+        .wValue = 0,
+        .wIndex = itf_num,
+        .wLength = 1,
+    };
+
+    uint64_t const start = now_ns();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        hidd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request);
+    }
+    return (double)(now_ns() - start) / (double)iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long const iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+    if (iterations == 0)
+    {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    hidd_init();
+    for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+    {
+        uint8_t const desc[] = {TUD_HID_INOUT_DESCRIPTOR(i, 0, HID_ITF_PROTOCOL_NONE, sizeof(report_desc),
+                                                         (uint8_t)(0x01 + i), (uint8_t)(0x81 + i), 8, 1)};
+        memcpy(config_desc[i], desc, sizeof(desc));
+
+        if (hidd_open(0, (tusb_desc_interface_t const *)config_desc[i], sizeof(config_desc[i])) != sizeof(desc))
+        {
+            fprintf(stderr, "hidd_open failed on interface %u\n", i);
+            return 1;
+        }
+    }
+
+    uint8_t const last = CFG_TUD_HID - 1;
+    double const xfer_in_ns = time_xfer((uint8_t)(0x81 + last), iterations);
+    double const xfer_out_ns = time_xfer((uint8_t)(0x01 + last), iterations);
+    double const control_ns = time_control(last, iterations);
+
+    printf("{\"instances\": %u, \"iterations\": %lu, \"xfer_in_ns\": %.2f, \"xfer_out_ns\": %.2f, "
+           "\"control_ns\": %.2f}\n",
+           CFG_TUD_HID, iterations, xfer_in_ns, xfer_out_ns, control_ns);
+    return 0;
+}
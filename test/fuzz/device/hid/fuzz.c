@@ -0,0 +1,206 @@
+// libFuzzer target for the firmware's command channel and the HID class
+// driver: the whole firmware runs on the host simulation (sim/) with the
+// UART stream and the host's HID class requests taken from the fuzz input.
+//
+// Input format, bytes go to the UART unless escaped with 0xFF:
+//
+//   FF FF                                  UART byte 0xFF
+//   FF 00 <ms>                             keep the UART idle for <ms> ms
+//   FF 01 <bRequest> <wValue:2> <itf> <len> [data]
+//                                          HID class request to interface
+//                                          <itf>: GET_REPORT, GET_IDLE,
+//                                          GET_PROTOCOL (bRequest < 0x08, IN)
+//                                          or SET_REPORT, SET_IDLE,
+//                                          SET_PROTOCOL (OUT, <len> data bytes)
+//   FF 02 <setup:8> [data]                 any other control request
+//   FF <other>                             ignored
+//
+// The USB host side is the simulated DCD rather than tinyusb's dcd_fuzz: it
+// completes the data and status stages of control transfers, so SET_REPORT
+// payloads actually reach tud_hid_set_report_cb().
+
+#include <string.h>
+
+#include "tusb.h"
+
+#include "hardware/flash.h"
+
+#include "pico_hid.h"
+#include "sim.h"
+
+#define FUZZ_LOOP_US 50     // virtual time of one main loop pass
+#define FUZZ_SETTLE_MS 5    // idle time after the input before stopping
+#define FUZZ_MAX_MS 2000    // keeps long type/path commands from dominating a run
+#define FUZZ_ENUMERATE_MS 200
+
+#define FUZZ_ESCAPE 0xFF
+
+enum
+{
+    FUZZ_OP_IDLE = 0x00,
+    FUZZ_OP_HID_REQUEST = 0x01,
+    FUZZ_OP_CONTROL = 0x02,
+};
+
+static struct
+{
+    uint8_t const *data;
+    size_t size;
+    size_t pos;
+    uint64_t idle_until_us;
+} input;
+
+static bool initialized;
+
+// UART source: bytes up to the next escape, the line stays idle while the
+// escape is handled by the main loop below
+static int fuzz_uart_source(uint64_t time_us, void *ctx)
+{
+    (void)ctx;
+
+    if (input.pos >= input.size)
+    {
+        return SIM_UART_EOF;
+    }
+
+    if (time_us < input.idle_until_us)
+    {
+        return SIM_UART_IDLE;
+    }
+
+    if (input.data[input.pos] != FUZZ_ESCAPE)
+    {
+        return input.data[input.pos++];
+    }
+
+    if (input.pos + 1 < input.size && input.data[input.pos + 1] == FUZZ_ESCAPE)
+    {
+        input.pos += 2;
+        return FUZZ_ESCAPE;
+    }
+    return SIM_UART_IDLE;
+}
+
+// Start the control request or idle period at input.pos, if it is one and
+// the previous control request is done
+static void fuzz_escape(void)
+{
+    uint8_t const *p = input.data + input.pos;
+    size_t const left = input.size - input.pos;
+
+    if (left == 0 || p[0] != FUZZ_ESCAPE || (left >= 2 && p[1] == FUZZ_ESCAPE) || sim_usb_control_busy())
+    {
+        return;
+    }
+
+    if (left == 1)
+    {
+        input.pos = input.size; // truncated escape
+        return;
+    }
+
+    switch (p[1])
+    {
+    case FUZZ_OP_IDLE:
+        if (left >= 3)
+        {
+            input.idle_until_us = sim_time_us + (uint64_t)p[2] * 1000;
+        }
+        input.pos += tu_min32((uint32_t)left, 3);
+        break;
+
+    case FUZZ_OP_HID_REQUEST:
+        if (left >= 7)
+        {
+            bool const out = p[2] & 0x08;
+            uint16_t const len = p[6];
+            size_t const n = out ? tu_min32((uint32_t)(left - 7), len) : 0;
+            uint8_t data[UINT8_MAX];
+
+            memset(data, 0, sizeof(data));
+            memcpy(data, p + 7, n);
+            sim_usb_control(out ? 0x21 : 0xA1, p[2], tu_unaligned_read16(p + 3), p[5], len, data);
+            input.pos += 7 + n;
+        }
+        else
+        {
+            input.pos = input.size;
+        }
+        break;
+
+    case FUZZ_OP_CONTROL:
+        if (left >= 10)
+        {
+            tusb_control_request_t request;
+            memcpy(&request, p + 2, sizeof(request));
+
+            bool const out = !(request.bmRequestType & TUSB_DIR_IN_MASK);
+            uint16_t const len = tu_le16toh(request.wLength);
+            size_t const n = out ? tu_min32((uint32_t)(left - 10), len) : 0;
+            static uint8_t data[UINT16_MAX];
+
+            memcpy(data, p + 10, n);
+            memset(data + n, 0, len - n);
+            sim_usb_control(request.bmRequestType, request.bRequest, tu_le16toh(request.wValue),
+                            tu_le16toh(request.wIndex), len, data);
+            input.pos += 10 + n;
+        }
+        else
+        {
+            input.pos = input.size;
+        }
+        break;
+
+    default:
+        input.pos += 2;
+        break;
+    }
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size)
+{
+    memset(&input, 0, sizeof(input));
+    input.data = data;
+    input.size = size;
+
+    // The stack is brought up once per process, later inputs start from a
+    // replug with fresh settings and firmware state
+    flash_range_erase(0, PICO_FLASH_SIZE_BYTES);
+    sim_uart_init_source(fuzz_uart_source, NULL, NULL);
+    if (!initialized)
+    {
+        sim_board_init();
+        sim_usb_init(NULL);
+        pico_hid_init();
+        initialized = true;
+    }
+    else
+    {
+        pico_hid_init();
+        sim_usb_replug();
+    }
+
+    uint64_t const deadline_us = sim_time_us + FUZZ_ENUMERATE_MS * 1000ull;
+    while (!sim_usb_configured() && sim_time_us < deadline_us)
+    {
+        sim_advance(FUZZ_LOOP_US);
+        pico_hid_task();
+    }
+
+    if (!sim_usb_configured())
+    {
+        return 0;
+    }
+
+    // Escapes are handled between main loop passes, UART bytes as they arrive
+    uint64_t const end_us = sim_time_us + FUZZ_MAX_MS * 1000ull;
+    while (input.pos < input.size && sim_time_us < end_us)
+    {
+        sim_advance(FUZZ_LOOP_US);
+        pico_hid_task();
+        fuzz_escape();
+    }
+
+    sim_run(FUZZ_LOOP_US, FUZZ_SETTLE_MS, FUZZ_MAX_MS);
+    return 0;
+}
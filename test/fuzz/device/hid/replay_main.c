@@ -0,0 +1,35 @@
+// Runs the fuzz target once per file given on the command line, for builds
+// without libFuzzer: the seed corpus doubles as a regression test and
+// crashing inputs can be reproduced under any compiler and debugger.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size);
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f)
+        {
+            perror(argv[i]);
+            return 2;
+        }
+
+        fseek(f, 0, SEEK_END);
+        long const size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        uint8_t *data = malloc(size > 0 ? (size_t)size : 1);
+        size_t const n = fread(data, 1, (size_t)(size > 0 ? size : 0), f);
+        fclose(f);
+
+        printf("%s: %lu bytes\n", argv[i], (unsigned long)n);
+        LLVMFuzzerTestOneInput(data, n);
+        free(data);
+    }
+    return 0;
+}
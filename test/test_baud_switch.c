@@ -0,0 +1,75 @@
+#include "unity.h"
+
+#include "baud_switch.h"
+
+static baud_switch_t baud;
+
+void setUp(void)
+{
+    baud_switch_init(&baud, 115200);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_rates_out_of_range_are_rejected(void)
+{
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_INVALID, baud_switch_request(&baud, 0));
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_INVALID, baud_switch_request(&baud, BAUD_SWITCH_MIN - 1));
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_INVALID, baud_switch_request(&baud, BAUD_SWITCH_MAX + 1));
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_IDLE, baud.state);
+    TEST_ASSERT_FALSE(baud_switch_start(&baud, 0));
+}
+
+void test_switch_then_commit_on_probe(void)
+{
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_ACCEPTED, baud_switch_request(&baud, 3000000));
+    TEST_ASSERT_EQUAL(115200, baud.rate);
+
+    TEST_ASSERT_TRUE(baud_switch_start(&baud, 100));
+    TEST_ASSERT_EQUAL(3000000, baud.pending);
+    TEST_ASSERT_FALSE(baud_switch_start(&baud, 101)); // only once
+
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_COMMITTED, baud_switch_request(&baud, 3000000));
+    TEST_ASSERT_EQUAL(3000000, baud.rate);
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_IDLE, baud.state);
+    TEST_ASSERT_FALSE(baud_switch_timeout(&baud, 100 + BAUD_SWITCH_TIMEOUT_MS));
+}
+
+void test_revert_without_probe(void)
+{
+    baud_switch_request(&baud, 921600);
+    baud_switch_start(&baud, 5000);
+
+    TEST_ASSERT_FALSE(baud_switch_timeout(&baud, 5000 + BAUD_SWITCH_TIMEOUT_MS - 1));
+    TEST_ASSERT_TRUE(baud_switch_timeout(&baud, 5000 + BAUD_SWITCH_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL(115200, baud.rate);
+    TEST_ASSERT_EQUAL(115200, baud.pending);
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_IDLE, baud.state);
+}
+
+void test_wrong_probe_does_not_commit(void)
+{
+    baud_switch_request(&baud, 921600);
+
+    // Nothing changes until the reply is out
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_INVALID, baud_switch_request(&baud, 921600));
+
+    baud_switch_start(&baud, 0);
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_INVALID, baud_switch_request(&baud, 460800));
+    TEST_ASSERT_EQUAL(BAUD_SWITCH_PENDING, baud.state);
+    TEST_ASSERT_TRUE(baud_switch_timeout(&baud, BAUD_SWITCH_TIMEOUT_MS));
+}
+
+void test_timeout_across_millis_wrap(void)
+{
+    baud_switch_request(&baud, 921600);
+    baud_switch_start(&baud, UINT32_MAX - 10);
+
+    TEST_ASSERT_FALSE(baud_switch_timeout(&baud, 10));
+    TEST_ASSERT_TRUE(baud_switch_timeout(&baud, BAUD_SWITCH_TIMEOUT_MS));
+}
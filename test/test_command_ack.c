@@ -0,0 +1,86 @@
+#include <string.h>
+#include "unity.h"
+
+#include "command_ack.h"
+
+static command_ack_t ack;
+
+void setUp(void)
+{
+    command_ack_init(&ack);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_parse_seq_prefix(void)
+{
+    uint8_t seq = 0;
+    char const *command = NULL;
+
+    TEST_ASSERT_TRUE(command_ack_parse_seq("17:mouse_move,1,2", &seq, &command));
+    TEST_ASSERT_EQUAL(17, seq);
+    TEST_ASSERT_EQUAL_STRING("mouse_move,1,2", command);
+
+    TEST_ASSERT_TRUE(command_ack_parse_seq("255:stats", &seq, &command));
+    TEST_ASSERT_EQUAL(255, seq);
+    TEST_ASSERT_EQUAL_STRING("stats", command);
+}
+
+void test_parse_seq_rejects_lines_without_prefix(void)
+{
+    uint8_t seq = 9;
+    char const *command = "unchanged";
+
+    TEST_ASSERT_FALSE(command_ack_parse_seq("mouse_move,1,2", &seq, &command));
+    TEST_ASSERT_FALSE(command_ack_parse_seq(":stats", &seq, &command));
+    TEST_ASSERT_FALSE(command_ack_parse_seq("12stats", &seq, &command));
+    TEST_ASSERT_FALSE(command_ack_parse_seq("256:stats", &seq, &command));
+    TEST_ASSERT_FALSE(command_ack_parse_seq("0001:stats", &seq, &command));
+    TEST_ASSERT_EQUAL(9, seq);
+    TEST_ASSERT_EQUAL_STRING("unchanged", command);
+}
+
+void test_credits_are_the_smaller_limit(void)
+{
+    TEST_ASSERT_EQUAL(16, command_ack_credits(16, 512, 1024));
+    TEST_ASSERT_EQUAL(3, command_ack_credits(3, 512, 1024));
+    TEST_ASSERT_EQUAL(2, command_ack_credits(16, 512, 2 * COMMAND_ACK_CREDIT_BYTES + 10));
+    TEST_ASSERT_EQUAL(0, command_ack_credits(16, 512, COMMAND_ACK_CREDIT_BYTES - 1));
+    TEST_ASSERT_EQUAL(UINT8_MAX, command_ack_credits(1000, UINT16_MAX, UINT16_MAX));
+}
+
+// Text waiting in the typer limits how much more the host may send to type
+void test_credits_limited_by_typer_space(void)
+{
+    TEST_ASSERT_EQUAL(3, command_ack_credits(16, 3 * COMMAND_ACK_CREDIT_CHARS + 5, 1024));
+    TEST_ASSERT_EQUAL(0, command_ack_credits(16, COMMAND_ACK_CREDIT_CHARS - 1, 1024));
+}
+
+void test_no_reply_while_disabled(void)
+{
+    char buf[COMMAND_ACK_REPLY_SIZE];
+
+    TEST_ASSERT_FALSE(command_ack_reply(&ack, true, 1, 16, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    TEST_ASSERT_EQUAL(0, ack.acked);
+}
+
+void test_ack_and_nak_lines(void)
+{
+    char buf[COMMAND_ACK_REPLY_SIZE];
+    ack.enabled = true;
+
+    TEST_ASSERT_TRUE(command_ack_reply(&ack, true, 7, 16, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("ack,7,16\n", buf);
+
+    TEST_ASSERT_TRUE(command_ack_reply(&ack, false, 255, 255, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("nak,255,255\n", buf);
+
+    TEST_ASSERT_EQUAL(1, ack.acked);
+    TEST_ASSERT_EQUAL(1, ack.nacked);
+}
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "unity.h"
+
+#include "command_frame.h"
+
+static command_frame_parser_t parser;
+
+void setUp(void)
+{
+    command_frame_reset(&parser);
+}
+
+void tearDown(void)
+{
+}
+
+static command_frame_result_t feed(uint8_t const *data, uint16_t len)
+{
+    command_frame_result_t result = COMMAND_FRAME_PENDING;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        result = command_frame_parse(&parser, data[i]);
+    }
+    return result;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_crc8_check_value(void)
+{
+    // CRC-8/SMBUS check value for "123456789"
+    TEST_ASSERT_EQUAL_HEX8(0xF4, command_frame_crc8(0, "123456789", 9));
+}
+
+void test_encode_mouse_move(void)
+{
+    uint8_t const payload[4] = {0x34, 0x12, 0xFE, 0xFF}; // x = 0x1234, y = -2
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+
+    uint16_t len = command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, sizeof(payload), frame, sizeof(frame));
+
+    TEST_ASSERT_EQUAL(8, len);
+    TEST_ASSERT_EQUAL_HEX8(START_CHARACTER, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(FRAME_OP_MOUSE_MOVE, frame[1]);
+    TEST_ASSERT_EQUAL(4, frame[2]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, frame + 3, 4);
+    TEST_ASSERT_EQUAL_HEX8(command_frame_crc8(0, frame + 1, 6), frame[7]);
+}
+
+void test_encode_too_small(void)
+{
+    uint8_t frame[6];
+    uint8_t const payload[4] = {0};
+
+    TEST_ASSERT_EQUAL(0, command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, 4, frame, sizeof(frame)));
+}
+
+void test_roundtrip(void)
+{
+    uint8_t const payload[4] = {1, 2, 3, 4};
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t len = command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, sizeof(payload), frame, sizeof(frame));
+
+    for (uint16_t i = 0; i < len - 1; i++)
+    {
+        TEST_ASSERT_EQUAL(COMMAND_FRAME_PENDING, command_frame_parse(&parser, frame[i]));
+        TEST_ASSERT_TRUE(command_frame_busy(&parser));
+    }
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_COMPLETE, command_frame_parse(&parser, frame[len - 1]));
+    TEST_ASSERT_FALSE(command_frame_busy(&parser));
+
+    TEST_ASSERT_EQUAL_HEX8(FRAME_OP_MOUSE_MOVE, parser.opcode);
+    TEST_ASSERT_EQUAL(4, parser.len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, parser.payload, 4);
+}
+
+void test_empty_payload(void)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t len = command_frame_encode(FRAME_OP_MOUSE_RELEASE, NULL, 0, frame, sizeof(frame));
+
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_OVERHEAD, len);
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_COMPLETE, feed(frame, len));
+    TEST_ASSERT_EQUAL(0, parser.len);
+}
+
+void test_bad_crc(void)
+{
+    uint8_t const payload[1] = {0x04};
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t len = command_frame_encode(FRAME_OP_KEYBOARD_PRESS, payload, 1, frame, sizeof(frame));
+
+    frame[len - 1] ^= 0xFF;
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_ERROR, feed(frame, len));
+    TEST_ASSERT_FALSE(command_frame_busy(&parser));
+}
+
+void test_oversized_length(void)
+{
+    uint8_t const frame[] = {START_CHARACTER, FRAME_OP_MOUSE_MOVE, COMMAND_FRAME_MAX_PAYLOAD + 1};
+
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_ERROR, feed(frame, sizeof(frame)));
+    TEST_ASSERT_FALSE(command_frame_busy(&parser));
+}
+
+void test_ignore_noise_before_start(void)
+{
+    uint8_t stream[64] = "noise\r\n";
+    uint16_t pos = (uint16_t)strlen((char *)stream);
+    uint8_t const payload[1] = {0x04};
+
+    pos += command_frame_encode(FRAME_OP_KEYBOARD_PRESS, payload, 1, stream + pos, (uint16_t)(sizeof(stream) - pos));
+
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_COMPLETE, feed(stream, pos));
+    TEST_ASSERT_EQUAL_HEX8(FRAME_OP_KEYBOARD_PRESS, parser.opcode);
+    TEST_ASSERT_EQUAL_HEX8(0x04, parser.payload[0]);
+}
+
+void test_truncated_frame_expires(void)
+{
+    uint8_t const payload[4] = {5, 0, 6, 0};
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, 4, frame, sizeof(frame));
+
+    // One payload byte lost on the line
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_PENDING, feed(frame, 4));
+    TEST_ASSERT_FALSE(command_frame_expire(&parser, COMMAND_FRAME_TIMEOUT_MS - 1));
+    TEST_ASSERT_TRUE(command_frame_busy(&parser));
+
+    TEST_ASSERT_TRUE(command_frame_expire(&parser, COMMAND_FRAME_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(command_frame_busy(&parser));
+    TEST_ASSERT_FALSE(command_frame_expire(&parser, COMMAND_FRAME_TIMEOUT_MS));
+
+    // Text that follows is not taken for the rest of the frame, the next frame parses
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_PENDING, feed((uint8_t const *)"stats\n", 6));
+    TEST_ASSERT_FALSE(command_frame_busy(&parser));
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_COMPLETE, feed(frame, len));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, parser.payload, 4);
+}
+
+void test_resync_after_error(void)
+{
+    uint8_t const payload[4] = {5, 0, 6, 0};
+    uint8_t stream[2 * COMMAND_FRAME_MAX_SIZE];
+    uint16_t len = command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, 4, stream, sizeof(stream));
+
+    stream[3] ^= 0x01; // corrupt payload of the first frame
+    uint16_t total = len + command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, 4, stream + len, (uint16_t)(sizeof(stream) - len));
+
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_ERROR, feed(stream, len));
+    TEST_ASSERT_EQUAL(COMMAND_FRAME_COMPLETE, feed(stream + len, (uint16_t)(total - len)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(payload, parser.payload, 4);
+}
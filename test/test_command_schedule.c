@@ -0,0 +1,162 @@
+#include <string.h>
+#include "unity.h"
+
+#include "command_schedule.h"
+
+static command_schedule_t schedule;
+
+void setUp(void)
+{
+    command_schedule_init(&schedule);
+}
+
+void tearDown(void)
+{
+}
+
+static void add_text(uint32_t now, uint32_t frame, char const *text)
+{
+    TEST_ASSERT_TRUE(command_schedule_add(&schedule, now, frame, COMMAND_SCHEDULE_TEXT, text, (uint8_t)strlen(text)));
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_parse_absolute_and_relative(void)
+{
+    uint32_t frame = 0;
+    char const *command = NULL;
+
+    TEST_ASSERT_TRUE(command_schedule_parse("@123456:mouse_move,1,2", 100, &frame, &command));
+    TEST_ASSERT_EQUAL_UINT32(123456, frame);
+    TEST_ASSERT_EQUAL_STRING("mouse_move,1,2", command);
+
+    TEST_ASSERT_TRUE(command_schedule_parse("+5:mouse_release", 100, &frame, &command));
+    TEST_ASSERT_EQUAL_UINT32(105, frame);
+    TEST_ASSERT_EQUAL_STRING("mouse_release", command);
+
+    TEST_ASSERT_TRUE(command_schedule_parse("@4294967295:led", 0, &frame, &command));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, frame);
+}
+
+void test_parse_rejects_other_lines(void)
+{
+    uint32_t frame = 7;
+    char const *command = "unchanged";
+
+    TEST_ASSERT_FALSE(command_schedule_parse("mouse_release", 0, &frame, &command));
+    TEST_ASSERT_FALSE(command_schedule_parse("@:mouse_release", 0, &frame, &command));
+    TEST_ASSERT_FALSE(command_schedule_parse("+12mouse_release", 0, &frame, &command));
+    TEST_ASSERT_FALSE(command_schedule_parse("@12345678901:led", 0, &frame, &command));
+    TEST_ASSERT_EQUAL_UINT32(7, frame);
+    TEST_ASSERT_EQUAL_STRING("unchanged", command);
+}
+
+void test_released_in_frame_order_on_their_frame(void)
+{
+    command_schedule_item_t item;
+
+    add_text(100, 110, "c");
+    add_text(100, 105, "a");
+    add_text(100, 105, "b"); // same frame, after a
+    add_text(100, 120, "d");
+
+    TEST_ASSERT_FALSE(command_schedule_pop(&schedule, 104, &item));
+
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 105, &item));
+    TEST_ASSERT_EQUAL_STRING("a", (char const *)item.data);
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 105, &item));
+    TEST_ASSERT_EQUAL_STRING("b", (char const *)item.data);
+    TEST_ASSERT_FALSE(command_schedule_pop(&schedule, 105, &item));
+
+    // A frame missed in between releases everything up to now
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 130, &item));
+    TEST_ASSERT_EQUAL_STRING("c", (char const *)item.data);
+    TEST_ASSERT_EQUAL_UINT32(110, item.frame);
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 130, &item));
+    TEST_ASSERT_EQUAL_STRING("d", (char const *)item.data);
+
+    TEST_ASSERT_EQUAL(0, schedule.count);
+    TEST_ASSERT_EQUAL(4, schedule.scheduled);
+    TEST_ASSERT_EQUAL(4, schedule.released);
+    TEST_ASSERT_EQUAL(0, schedule.late);
+}
+
+void test_frame_payload_kept(void)
+{
+    uint8_t const payload[] = {0x10, 0x00, 0x20, 0x00};
+    command_schedule_item_t item;
+
+    TEST_ASSERT_TRUE(command_schedule_add(&schedule, 0, 1, 0x01, payload, sizeof(payload)));
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 1, &item));
+    TEST_ASSERT_EQUAL(0x01, item.opcode);
+    TEST_ASSERT_EQUAL(sizeof(payload), item.len);
+    TEST_ASSERT_EQUAL_MEMORY(payload, item.data, sizeof(payload));
+}
+
+void test_late_commands_go_out_next_frame(void)
+{
+    command_schedule_item_t item;
+
+    add_text(200, 150, "late");
+    add_text(200, 200, "now");
+    TEST_ASSERT_EQUAL(2, schedule.late);
+
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 201, &item));
+    TEST_ASSERT_EQUAL_STRING("late", (char const *)item.data);
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 201, &item));
+    TEST_ASSERT_EQUAL_STRING("now", (char const *)item.data);
+}
+
+void test_rejects_full_long_and_far_ahead(void)
+{
+    char long_text[COMMAND_SCHEDULE_DATA_SIZE + 2];
+    memset(long_text, 'x', sizeof(long_text) - 1);
+    long_text[sizeof(long_text) - 1] = 0;
+
+    TEST_ASSERT_FALSE(command_schedule_add(&schedule, 0, 1, COMMAND_SCHEDULE_TEXT, long_text,
+                                           (uint8_t)strlen(long_text)));
+    TEST_ASSERT_FALSE(
+        command_schedule_add(&schedule, 0, COMMAND_SCHEDULE_MAX_AHEAD + 1, COMMAND_SCHEDULE_TEXT, "x", 1));
+
+    for (uint8_t i = 0; i < COMMAND_SCHEDULE_DEPTH; i++)
+    {
+        add_text(0, 10, "x");
+    }
+    TEST_ASSERT_FALSE(command_schedule_add(&schedule, 0, 10, COMMAND_SCHEDULE_TEXT, "x", 1));
+    TEST_ASSERT_EQUAL(3, schedule.rejected);
+
+    command_schedule_clear(&schedule);
+    TEST_ASSERT_EQUAL(0, schedule.count);
+    TEST_ASSERT_EQUAL(3, schedule.rejected);
+}
+
+void test_order_across_frame_counter_wrap(void)
+{
+    command_schedule_item_t item;
+
+    add_text(UINT32_MAX - 5, 3, "after");
+    add_text(UINT32_MAX - 5, UINT32_MAX - 1, "before");
+
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, UINT32_MAX, &item));
+    TEST_ASSERT_EQUAL_STRING("before", (char const *)item.data);
+    TEST_ASSERT_FALSE(command_schedule_pop(&schedule, 2, &item));
+    TEST_ASSERT_TRUE(command_schedule_pop(&schedule, 3, &item));
+    TEST_ASSERT_EQUAL_STRING("after", (char const *)item.data);
+}
+
+void test_frames_between_follow_bus_numbers(void)
+{
+    TEST_ASSERT_EQUAL(1, command_schedule_frames_between(10, 11, 1));
+    TEST_ASSERT_EQUAL(3, command_schedule_frames_between(2046, 1, 0));
+    TEST_ASSERT_EQUAL(100, command_schedule_frames_between(0, 100, 104)); // CPU clock a little off
+}
+
+// After a suspend longer than the 11-bit frame number wraps, the CPU clock
+// says how many wraps were missed, the bus numbers give the exact rest
+void test_frames_between_add_missed_wraps(void)
+{
+    TEST_ASSERT_EQUAL(5000, command_schedule_frames_between(0, 5000 & 0x7FF, 5003));
+    TEST_ASSERT_EQUAL(5000, command_schedule_frames_between(0, 5000 & 0x7FF, 4990));
+    TEST_ASSERT_EQUAL(2047 + 2048, command_schedule_frames_between(1, 0, 4100));
+}
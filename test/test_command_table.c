@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "tusb.h"
+#include "command_table.h"
+#include "commands.h"
+
+#define SEED_SEARCH_TRIES 1000000ul
+
+static command_table_t table;
+static char const *called;
+static command_args_t called_args;
+static bool accept; // what every handler returns
+
+// Every command of the firmware records its call
+#define COMMAND_HANDLER(name, min_args, max_args)          \
+    static bool cmd_##name(command_args_t const *args)     \
+    {                                                      \
+        called = #name;                                    \
+        called_args = *args;                               \
+        return accept;                                     \
+    }
+PICO_HID_COMMANDS(COMMAND_HANDLER)
+
+#define COMMAND_ENTRY(name, min_args, max_args) {#name, cmd_##name, min_args, max_args},
+static const command_t commands[] = {PICO_HID_COMMANDS(COMMAND_ENTRY)};
+
+void setUp(void)
+{
+    command_table_init(&table, commands, TU_ARRAY_SIZE(commands), PICO_HID_COMMAND_SEED);
+    called = NULL;
+    accept = true;
+    memset(&called_args, 0, sizeof(called_args));
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+// Fails when a command was added or renamed: the message has the seed to pin,
+// or says that no seed can separate the names
+void test_firmware_commands_hash_perfectly(void)
+{
+    if (!table.perfect)
+    {
+        char message[96];
+        uint32_t seed;
+
+        if (command_table_find_seed(commands, TU_ARRAY_SIZE(commands), SEED_SEARCH_TRIES, &seed))
+        {
+            snprintf(message, sizeof(message), "names collide, set PICO_HID_COMMAND_SEED to %lu", (unsigned long)seed);
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "no seed below %lu separates the names, grow COMMAND_TABLE_SLOTS",
+                     (unsigned long)SEED_SEARCH_TRIES);
+        }
+        TEST_FAIL_MESSAGE(message);
+    }
+
+    for (uint8_t i = 0; i < TU_ARRAY_SIZE(commands); i++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&commands[i], command_table_find(&table, commands[i].name, strlen(commands[i].name)));
+    }
+}
+
+void test_unknown_and_prefix_names_rejected(void)
+{
+    TEST_ASSERT_NULL(command_table_find(&table, "mouse", 5));
+    TEST_ASSERT_NULL(command_table_find(&table, "mouse_moves", 11));
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "nope"));
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, ""));
+    TEST_ASSERT_NULL(called);
+}
+
+void test_integer_arguments(void)
+{
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "mouse_move,100,-200"));
+    TEST_ASSERT_EQUAL_STRING("mouse_move", called);
+    TEST_ASSERT_EQUAL(2, called_args.count);
+    TEST_ASSERT_EQUAL(100, called_args.v[0]);
+    TEST_ASSERT_EQUAL(-200, called_args.v[1]);
+}
+
+void test_argument_count_checked(void)
+{
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "mouse_move,1"));
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "mouse_move"));
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "mouse_move,x,1"));
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "mouse_click_left,1"));
+    TEST_ASSERT_NULL(called);
+
+    // Extra arguments are ignored, like sscanf did
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "mouse_move,1,2,3"));
+    TEST_ASSERT_EQUAL(2, called_args.count);
+}
+
+void test_optional_arguments(void)
+{
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "keyboard_release"));
+    TEST_ASSERT_EQUAL(0, called_args.count);
+
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "keyboard_release,4"));
+    TEST_ASSERT_EQUAL(1, called_args.count);
+    TEST_ASSERT_EQUAL(4, called_args.v[0]);
+
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "keyboard_release,"));
+}
+
+void test_text_argument_keeps_commas(void)
+{
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "type,Hello, World!"));
+    TEST_ASSERT_EQUAL_STRING("type", called);
+    TEST_ASSERT_EQUAL_STRING("Hello, World!", called_args.text);
+    TEST_ASSERT_EQUAL(13, called_args.text_len);
+
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "type"));
+}
+
+void test_optional_text_argument(void)
+{
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "baud"));
+    TEST_ASSERT_EQUAL_STRING("baud", called);
+    TEST_ASSERT_NULL(called_args.text);
+
+    TEST_ASSERT_TRUE(command_table_dispatch(&table, "baud,3000000"));
+    TEST_ASSERT_EQUAL_STRING("3000000", called_args.text);
+}
+
+// A handler rejecting its values fails the dispatch, so the command is nak'd
+void test_handler_rejection_returned(void)
+{
+    accept = false;
+    TEST_ASSERT_FALSE(command_table_dispatch(&table, "queue_policy,9,9"));
+    TEST_ASSERT_EQUAL_STRING("queue_policy", called);
+}
+
+void test_parse_u32(void)
+{
+    uint32_t value = 7;
+
+    TEST_ASSERT_TRUE(command_parse_u32("3000000", &value));
+    TEST_ASSERT_EQUAL_UINT32(3000000, value);
+    TEST_ASSERT_TRUE(command_parse_u32("4294967295", &value));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, value);
+
+    value = 7;
+    TEST_ASSERT_FALSE(command_parse_u32("", &value));
+    TEST_ASSERT_FALSE(command_parse_u32("4294967296", &value));
+    TEST_ASSERT_FALSE(command_parse_u32("-1", &value));
+    TEST_ASSERT_FALSE(command_parse_u32("115200,1", &value));
+    TEST_ASSERT_EQUAL_UINT32(7, value);
+}
+
+void test_parse_ints(void)
+{
+    int16_t v[4];
+
+    TEST_ASSERT_EQUAL(3, command_parse_ints(" 1, -2,+3", v, 4));
+    TEST_ASSERT_EQUAL(1, v[0]);
+    TEST_ASSERT_EQUAL(-2, v[1]);
+    TEST_ASSERT_EQUAL(3, v[2]);
+
+    // Stops at the first value that does not parse, trailing text is ignored
+    TEST_ASSERT_EQUAL(2, command_parse_ints("5,6abc,7", v, 4));
+    TEST_ASSERT_EQUAL(0, command_parse_ints("-", v, 4));
+    TEST_ASSERT_EQUAL(2, command_parse_ints("1,2,3", v, 2));
+
+    // Wraps to int16 like %hd
+    TEST_ASSERT_EQUAL(1, command_parse_ints("99999", v, 4));
+    TEST_ASSERT_EQUAL((int16_t)99999, v[0]);
+    TEST_ASSERT_EQUAL(1, command_parse_ints("-32768", v, 4));
+    TEST_ASSERT_EQUAL(-32768, v[0]);
+}
+
+void test_colliding_names_still_found(void)
+{
+    // More names than slots can take without probing for any seed
+    static command_t many[COMMAND_TABLE_SLOTS - 1];
+    static char names[COMMAND_TABLE_SLOTS - 1][4];
+    command_table_t t;
+
+    for (uint8_t i = 0; i < TU_ARRAY_SIZE(many); i++)
+    {
+        names[i][0] = 'c';
+        names[i][1] = (char)('0' + i / 10);
+        names[i][2] = (char)('0' + i % 10);
+        names[i][3] = 0;
+        many[i].name = names[i];
+        many[i].handler = cmd_led;
+    }
+
+    uint32_t seed;
+    TEST_ASSERT_FALSE(command_table_find_seed(many, TU_ARRAY_SIZE(many), 1000, &seed));
+
+    command_table_init(&t, many, TU_ARRAY_SIZE(many), 0);
+    TEST_ASSERT_FALSE(t.perfect);
+    for (uint8_t i = 0; i < TU_ARRAY_SIZE(many); i++)
+    {
+        TEST_ASSERT_EQUAL_PTR(&many[i], command_table_find(&t, names[i], 3));
+    }
+    TEST_ASSERT_NULL(command_table_find(&t, "zzz", 3));
+}
+
+void test_seed_search(void)
+{
+    uint32_t seed;
+
+    TEST_ASSERT_TRUE(command_table_find_seed(commands, TU_ARRAY_SIZE(commands), SEED_SEARCH_TRIES, &seed));
+
+    command_table_t t;
+    command_table_init(&t, commands, TU_ARRAY_SIZE(commands), seed);
+    TEST_ASSERT_TRUE(t.perfect);
+}
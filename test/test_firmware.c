@@ -0,0 +1,469 @@
+// Whole firmware tests: main.c, the descriptors and the USB stack run on the
+// host simulation (sim/) with the UART input given by each test, the
+// firmware's UART output and the IN reports the host received are checked.
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "tusb.h"
+
+#include "hardware/flash.h"
+
+#include "command_ack.h"
+#include "command_frame.h"
+#include "mouse_path.h"
+#include "nkro.h"
+#include "pico_hid.h"
+#include "settings.h"
+#include "sim.h"
+
+#define LOOP_US 50       // virtual time of one main loop pass
+#define ENUMERATE_MS 200
+
+#define EP_KEYBOARD 0x81
+#define EP_MOUSE 0x82
+#define EP_MOUSE_REL 0x83
+
+#define ITF_KEYBOARD 0
+#define ITF_MOUSE_REL 2
+
+#define MAX_REPORTS 256
+
+static struct
+{
+    uint8_t data[1024];
+    size_t len;
+    size_t pos;
+} uart_in;
+
+static char uart_out[8192];
+static FILE *uart_out_file;
+
+static struct
+{
+    uint8_t ep;
+    uint8_t len;
+    uint8_t data[CFG_TUD_HID_EP_BUFSIZE];
+} reports[MAX_REPORTS];
+static uint16_t report_count;
+
+static bool initialized;
+
+//--------------------------------------------------------------------+
+// Harness
+//--------------------------------------------------------------------+
+// The line stays idle between the tests' writes instead of ending
+static int uart_source(uint64_t time_us, void *ctx)
+{
+    (void)time_us;
+    (void)ctx;
+    return uart_in.pos < uart_in.len ? uart_in.data[uart_in.pos++] : SIM_UART_IDLE;
+}
+
+static void log_report(uint64_t time_us, uint8_t ep_addr, uint8_t const *data, uint16_t len)
+{
+    (void)time_us;
+    if (report_count < MAX_REPORTS)
+    {
+        reports[report_count].ep = ep_addr;
+        reports[report_count].len = (uint8_t)tu_min16(len, sizeof(reports[0].data));
+        memcpy(reports[report_count].data, data, reports[report_count].len);
+        report_count++;
+    }
+}
+
+static void run_ms(uint32_t ms)
+{
+    uint64_t const end_us = sim_time_us + ms * 1000ull;
+    while (sim_time_us < end_us)
+    {
+        sim_advance(LOOP_US);
+        pico_hid_task();
+    }
+}
+
+static void uart_send_bytes(void const *data, size_t len)
+{
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(uart_in.data) - uart_in.len, len);
+    memcpy(uart_in.data + uart_in.len, data, len);
+    uart_in.len += len;
+}
+
+static void uart_send(char const *text)
+{
+    uart_send_bytes(text, strlen(text));
+}
+
+static void uart_send_frame(uint8_t opcode, void const *payload, uint8_t len)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uart_send_bytes(frame, command_frame_encode(opcode, payload, len, frame, sizeof(frame)));
+}
+
+// Frame with the sequence number as first payload byte, answered in acknowledge mode
+static void uart_send_sequenced(uint8_t opcode, uint8_t seq, void const *payload, uint8_t len)
+{
+    uint8_t buf[COMMAND_FRAME_MAX_PAYLOAD];
+    TEST_ASSERT_LESS_THAN(sizeof(buf), len);
+    buf[0] = seq;
+    memcpy(buf + 1, payload, len);
+    uart_send_frame(opcode | FRAME_OP_SEQ, buf, (uint8_t)(len + 1u));
+}
+
+static char const *uart_output(void)
+{
+    fflush(uart_out_file);
+    return uart_out;
+}
+
+static uint16_t reports_on(uint8_t ep)
+{
+    uint16_t n = 0;
+    for (uint16_t i = 0; i < report_count; i++)
+    {
+        n += reports[i].ep == ep;
+    }
+    return n;
+}
+
+// Last report the host received on ep
+static uint8_t const *last_report(uint8_t ep)
+{
+    for (uint16_t i = report_count; i-- > 0;)
+    {
+        if (reports[i].ep == ep)
+        {
+            return reports[i].data;
+        }
+    }
+    TEST_FAIL_MESSAGE("no report on the endpoint");
+    return NULL;
+}
+
+// Class request without a data stage, run to completion
+static void control_request(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex)
+{
+    TEST_ASSERT_TRUE(sim_usb_control(bmRequestType, bRequest, wValue, wIndex, 0, NULL));
+    while (sim_usb_control_busy())
+    {
+        run_ms(1);
+    }
+}
+
+// Every test starts from a replug with erased settings and fresh firmware state
+void setUp(void)
+{
+    memset(&uart_in, 0, sizeof(uart_in));
+    memset(uart_out, 0, sizeof(uart_out));
+    uart_out_file = fmemopen(uart_out, sizeof(uart_out), "w");
+    report_count = 0;
+
+    flash_range_erase(0, PICO_FLASH_SIZE_BYTES);
+    sim_uart_init_source(uart_source, NULL, uart_out_file);
+    if (!initialized)
+    {
+        sim_usb_hooks_t const hooks = {.armed = NULL, .report = log_report};
+        sim_board_init();
+        sim_usb_init(&hooks);
+        pico_hid_init();
+        initialized = true;
+    }
+    else
+    {
+        pico_hid_init();
+        sim_usb_replug();
+    }
+
+    for (uint32_t ms = 0; ms < ENUMERATE_MS && !sim_usb_configured(); ms++)
+    {
+        run_ms(1);
+    }
+    TEST_ASSERT_TRUE(sim_usb_configured());
+    report_count = 0;
+}
+
+void tearDown(void)
+{
+    fclose(uart_out_file);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_text_and_frame_commands(void)
+{
+    int16_t const xy[2] = {300, 400};
+
+    uart_send("mouse_move,100,200\n");
+    run_ms(10);
+    TEST_ASSERT_EQUAL(1, reports_on(EP_MOUSE));
+    TEST_ASSERT_EQUAL(100, (int16_t)tu_unaligned_read16(last_report(EP_MOUSE) + 1));
+    TEST_ASSERT_EQUAL(200, (int16_t)tu_unaligned_read16(last_report(EP_MOUSE) + 3));
+
+    uart_send_frame(FRAME_OP_MOUSE_MOVE, xy, sizeof(xy));
+    run_ms(10);
+    TEST_ASSERT_EQUAL(2, reports_on(EP_MOUSE));
+    TEST_ASSERT_EQUAL(300, (int16_t)tu_unaligned_read16(last_report(EP_MOUSE) + 1));
+}
+
+// A frame that lost its last bytes on the line is dropped after the line
+// went idle, the text command after it still runs
+void test_truncated_frame_does_not_swallow_text(void)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    int16_t const xy[2] = {100, 200};
+    uint16_t const len = command_frame_encode(FRAME_OP_MOUSE_MOVE, xy, sizeof(xy), frame, sizeof(frame));
+
+    uart_send_bytes(frame, len - 2u);
+    run_ms(COMMAND_FRAME_TIMEOUT_MS + 5);
+    uart_send("mouse_move,300,400\n");
+    run_ms(10);
+
+    TEST_ASSERT_EQUAL(1, reports_on(EP_MOUSE));
+    TEST_ASSERT_EQUAL(300, (int16_t)tu_unaligned_read16(last_report(EP_MOUSE) + 1));
+    TEST_ASSERT_EQUAL(400, (int16_t)tu_unaligned_read16(last_report(EP_MOUSE) + 3));
+}
+
+// Keys above 0x7F (international, LANG) get their bit in the NKRO report
+void test_keyboard_press_above_0x7f(void)
+{
+    uart_send("keyboard_press,135\n"); // International1
+    run_ms(10);
+
+    TEST_ASSERT_EQUAL(1, reports_on(EP_KEYBOARD));
+    TEST_ASSERT_EQUAL_HEX8(0x80, last_report(EP_KEYBOARD)[offsetof(nkro_report_t, keys) + (135 >> 3)]);
+}
+
+// SET_IDLE repeats the keyboard's last report, but not the relative mouse's:
+// its report is motion, sending it again would move the pointer again
+void test_set_idle_does_not_repeat_relative_motion(void)
+{
+    control_request(0x21, HID_REQ_CONTROL_SET_IDLE, 1 << 8, ITF_MOUSE_REL); // 4 ms
+    control_request(0x21, HID_REQ_CONTROL_SET_IDLE, 1 << 8, ITF_KEYBOARD);
+    TEST_ASSERT_EQUAL(0, sim_usb_stats.control_stalls);
+
+    uart_send("mouse_rel_move,5,-5\n");
+    uart_send("keyboard_press,4\n");
+    run_ms(100);
+
+    TEST_ASSERT_EQUAL(1, reports_on(EP_MOUSE_REL));
+    TEST_ASSERT_GREATER_THAN(10, reports_on(EP_KEYBOARD));
+}
+
+// A burst of keystrokes fills the keyboard queue: from then on the device
+// grants no credits and every keystroke that lost a report to the COALESCE
+// slot is answered with nak, the acked ones all reach the host
+void test_keystroke_burst_credits(void)
+{
+    uint8_t const on = 1;
+    uint8_t const key = 4;
+    unsigned acks = 0;
+    unsigned naks = 0;
+
+    uart_send_sequenced(FRAME_OP_ACK_MODE, 0, &on, 1);
+    for (uint8_t seq = 1; seq <= 40; seq++)
+    {
+        uart_send_sequenced(FRAME_OP_KEYBOARD_KEYSTROKE, seq, &key, 1);
+    }
+    run_ms(200);
+
+    char const *line = uart_output();
+    unsigned seq, credits;
+    char verb[4];
+    while ((line = strpbrk(line, "an")) != NULL)
+    {
+        if (sscanf(line, "%3[acknk],%u,%u", verb, &seq, &credits) == 3)
+        {
+            if (strcmp(verb, "nak") == 0)
+            {
+                TEST_ASSERT_EQUAL_MESSAGE(0, credits, "credits while the queue overflows");
+                naks++;
+            }
+            else if (seq > 0)
+            {
+                TEST_ASSERT_EQUAL_MESSAGE(0, naks, "ack after the queue overflowed");
+                acks++;
+            }
+        }
+        line = strchr(line, '\n');
+        if (line == NULL)
+        {
+            break;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(40, acks + naks);
+    TEST_ASSERT_GREATER_THAN(0, naks);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * acks, reports_on(EP_KEYBOARD));
+}
+
+// Commands whose values the firmware rejects are answered with nak, the
+// same commands with valid values with ack
+void test_text_command_rejections_nak(void)
+{
+    uart_send("0:ack,1\n");
+    uart_send("1:baud,fast\n");               // not a number
+    uart_send("2:baud,5\n");                  // rate out of range
+    uart_send("3:poll_interval,1\n");         // interface without interval
+    uart_send("4:poll_interval,9,1\n");       // no such interface
+    uart_send("5:queue_policy,0,7\n");        // no such policy
+    uart_send("6:queue_policy,9,0\n");        // no such queue
+    uart_send("7:mouse_path,0,0,1,1,10,99\n"); // no such easing
+    uart_send("8:queue_policy,0,1\n");
+    uart_send("9:poll_interval\n");
+    run_ms(20);
+
+    char const *out = uart_output();
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,1,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,2,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,3,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,4,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,5,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,6,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "nak,7,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "ack,8,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "ack,9,"));
+}
+
+// A path frame with an unknown easing starts nothing and is answered with nak
+void test_mouse_path_frame_rejection_nak(void)
+{
+    uint8_t const on = 1;
+    uint8_t path[11] = {0};
+
+    path[8] = 100;                      // duration_ms
+    path[10] = MOUSE_PATH_EASING_COUNT; // easing
+    uart_send_sequenced(FRAME_OP_ACK_MODE, 0, &on, 1);
+    uart_send_sequenced(FRAME_OP_MOUSE_PATH, 1, path, sizeof(path));
+    path[10] = 0;
+    uart_send_sequenced(FRAME_OP_MOUSE_PATH, 2, path, sizeof(path));
+    run_ms(20);
+
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), "nak,1,"));
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), "ack,2,"));
+}
+
+// baud_save writes flash without detaching: the rate is not in the
+// descriptors. The sim does not model the CPU stall of the erase, this only
+// checks the device never leaves the bus
+void test_baud_save_does_not_detach(void)
+{
+    uart_send("baud_save\n");
+    for (uint32_t ms = 0; ms < 50; ms++)
+    {
+        run_ms(1);
+        TEST_ASSERT_TRUE(sim_usb_configured());
+    }
+
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), ",saved\n"));
+    settings.baud_rate = 0;
+    settings_load();
+    TEST_ASSERT_EQUAL(115200, settings.baud_rate); // the build default it runs at
+}
+
+// A main loop pass longer than the USB event queue is deep in frames, e.g.
+// printing stats, loses no bus events: frames are only counted, not queued
+void test_stalled_loop_keeps_control_requests(void)
+{
+    uart_send("+20:mouse_move,1,2\n"); // keeps the frame clock running
+    run_ms(5);
+
+    // No pico_hid_task() for 30 ms, the host sends a request in between
+    sim_advance(20 * 1000);
+    TEST_ASSERT_TRUE(sim_usb_control(0x21, HID_REQ_CONTROL_SET_IDLE, 0, ITF_KEYBOARD, 0, NULL));
+    sim_advance(10 * 1000);
+    for (uint32_t ms = 0; ms < 20 && sim_usb_control_busy(); ms++)
+    {
+        run_ms(1);
+    }
+    TEST_ASSERT_FALSE(sim_usb_control_busy());
+    TEST_ASSERT_EQUAL(0, sim_usb_stats.control_stalls);
+
+    // The frame clock kept counting, the command it held back ran
+    run_ms(5);
+    TEST_ASSERT_EQUAL(1, reports_on(EP_MOUSE));
+}
+
+// A scheduled command runs from the main loop on its frame, not before
+void test_scheduled_command_runs_on_its_frame(void)
+{
+    uart_send("+10:mouse_move,1,2\n");
+    run_ms(5);
+    TEST_ASSERT_EQUAL(0, reports_on(EP_MOUSE));
+
+    run_ms(10);
+    TEST_ASSERT_EQUAL(1, reports_on(EP_MOUSE));
+}
+
+// Text waiting in the typer shrinks the credits, so a host pipelining long
+// type commands within them cannot overrun it
+void test_type_text_limits_credits(void)
+{
+    char line[256];
+    unsigned credits = 0;
+
+    uart_send("0:ack,1\n");
+    for (unsigned seq = 1; seq <= 2; seq++)
+    {
+        int const len = snprintf(line, sizeof(line), "%u:type,", seq);
+        memset(line + len, 'x', 200);
+        strcpy(line + len + 200, "\n");
+        uart_send(line);
+    }
+    run_ms(40);
+
+    // 400 characters queued, at most one typed per ms since: the report
+    // queues alone would grant 16
+    char const *reply = strstr(uart_output(), "ack,2,");
+    TEST_ASSERT_NOT_NULL(reply);
+    TEST_ASSERT_EQUAL(1, sscanf(reply, "ack,2,%u", &credits));
+    TEST_ASSERT_LESS_OR_EQUAL((512 - 400 + 40) / COMMAND_ACK_CREDIT_CHARS, credits);
+}
+
+// A scheduled command is acked when queued; rejected when it runs, it counts
+// as failed instead of getting a nak pinned on a later command
+void test_scheduled_failure_counted(void)
+{
+    uart_send("0:ack,1\n");
+    uart_send("1:+5:queue_policy,9,9\n");
+    run_ms(20);
+    uart_send("2:mouse_move,1,2\n");
+    uart_send("stats\n");
+    run_ms(20);
+
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), "ack,1,"));
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), "ack,2,"));
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), ",released=1,"));
+    TEST_ASSERT_NOT_NULL(strstr(uart_output(), ",failed=1\n"));
+}
+
+static uint32_t device_frame(void)
+{
+    char const *line;
+    unsigned frame = 0;
+
+    uart_send("frame\n");
+    run_ms(5);
+    line = strrchr(uart_output(), 'f');
+    TEST_ASSERT_NOT_NULL(line);
+    TEST_ASSERT_EQUAL(1, sscanf(line, "frame,%u", &frame));
+    return frame;
+}
+
+// A suspend longer than the bus frame number's 2048 frames leaves the frame
+// clock in step with the host's
+void test_frame_clock_counts_long_suspend(void)
+{
+    uint32_t const device_before = device_frame();
+    uint32_t const host_before = sim_usb_stats.frames;
+
+    sim_usb_suspend(true);
+    run_ms(5000);
+    sim_usb_suspend(false);
+    run_ms(5);
+
+    uint32_t const device_after = device_frame();
+    uint32_t const host_after = sim_usb_stats.frames;
+    TEST_ASSERT_UINT32_WITHIN(1, host_after - host_before, device_after - device_before);
+}
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "hid_reports.h"
+
+// Simulation of command-to-report latency on the keyboard interface.
+//
+// The host polls the IN endpoint every bInterval. A report is on the wire at
+// the first poll after its transfer was armed; the endpoint is then free and
+// the transfer complete callback runs. Commands arrive at pseudo random times
+// and each one types a distinct key, so its press report can be found in the
+// delivered stream.
+//
+// "polled" is the former hid_task(): state is sampled on a 10 ms software
+// tick and only sent if the endpoint is idle at that moment.
+// "event" is hid_reports.c: a state change is sent at once or from the
+// complete callback.
+
+#define STEP_US 10
+#define POLLED_TICK_US 10000
+#define POLL_PHASE_US 370 // host frames are not aligned with the firmware tick
+#define NUM_COMMANDS 500
+
+typedef enum
+{
+    MODE_POLLED,
+    MODE_EVENT
+} sim_mode_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_t;
+
+static report_queue_item_t queue_buf[CFG_TUD_HID][4];
+static report_queue_t queue[CFG_TUD_HID];
+static mouse_accum_t mouse_rel;
+static uint8_t typer_buf[256];
+static typer_t typer;
+
+//--------------------------------------------------------------------+
+// Fake HID endpoint
+//--------------------------------------------------------------------+
+static bool ep_armed[CFG_TUD_HID];
+static uint8_t ep_report[CFG_TUD_HID_EP_BUFSIZE];
+static uint32_t delivered;
+
+bool tud_hid_n_ready(uint8_t instance)
+{
+    return !ep_armed[instance];
+}
+
+static uint8_t ep_buf[CFG_TUD_HID][CFG_TUD_HID_EP_BUFSIZE];
+
+void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len)
+{
+    (void)report_id;
+    (void)len;
+
+    return ep_armed[instance] ? NULL : ep_buf[instance];
+}
+
+bool tud_hid_n_report_commit(uint8_t instance, uint16_t len)
+{
+    ep_armed[instance] = true;
+    if (instance == 0)
+    {
+        memcpy(ep_report, ep_buf[instance], tu_min16(len, sizeof(ep_report)));
+    }
+    return true;
+}
+
+void tud_hid_n_report_cancel(uint8_t instance)
+{
+    (void)instance;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+{
+    uint8_t *buf = tud_hid_n_report_stage(instance, report_id, len);
+    if (!buf)
+    {
+        return false;
+    }
+
+    memcpy(buf, report, len);
+    return tud_hid_n_report_commit(instance, len);
+}
+
+bool tud_suspended(void)
+{
+    return false;
+}
+
+bool tud_remote_wakeup(void)
+{
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Former hid_task() keyboard path
+//--------------------------------------------------------------------+
+static uint8_t polled_keystroke;
+static uint8_t polled_prev_keycode[6];
+
+static void polled_hid_task(void)
+{
+    if (tud_hid_n_ready(0))
+    {
+        uint8_t keycode[6] = {0};
+        keycode[0] = polled_keystroke;
+        polled_keystroke = 0;
+
+        if (memcmp(keycode, polled_prev_keycode, 6) != 0)
+        {
+            hid_keyboard_report_t report = {0};
+            memcpy(report.keycode, keycode, 6);
+            tud_hid_n_report(0, 0, &report, sizeof(report));
+            memcpy(polled_prev_keycode, keycode, 6);
+        }
+    }
+}
+
+//--------------------------------------------------------------------+
+// Simulation
+//--------------------------------------------------------------------+
+
+// The former path sent the 6 byte keycode array, hid_reports.c the NKRO bitmap
+static bool report_has_key(sim_mode_t mode, uint8_t code)
+{
+    if (mode == MODE_POLLED)
+    {
+        return ((hid_keyboard_report_t const *)ep_report)->keycode[0] == code;
+    }
+
+    return ((nkro_report_t const *)ep_report)->keys[code >> 3] & TU_BIT(code & 7);
+}
+
+static uint32_t lcg_state;
+
+static uint32_t lcg_next(void)
+{
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return lcg_state >> 8;
+}
+
+static latency_t run(sim_mode_t mode, uint32_t interval_us)
+{
+    latency_t lat = {0};
+    uint32_t next_cmd_us = 1000;
+    uint32_t cmd_us = 0;
+    uint8_t pending_code = 0; // key typed by the last command, until it shows up on the wire
+    uint32_t issued = 0;
+
+    lcg_state = 12345;
+    delivered = 0;
+    memset(ep_armed, 0, sizeof(ep_armed));
+    memset(polled_prev_keycode, 0, sizeof(polled_prev_keycode));
+    polled_keystroke = 0;
+    for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+    {
+        report_queue_init(&queue[i], i, queue_buf[i], 4, REPORT_QUEUE_COALESCE);
+    }
+    mouse_accum_init(&mouse_rel, 2);
+    typer_init(&typer, typer_buf, sizeof(typer_buf));
+    hid_reports_init(&queue[0], &queue[1], &mouse_rel, &typer);
+
+    for (uint32_t t = 0; issued < NUM_COMMANDS || pending_code || ep_armed[0]; t += STEP_US)
+    {
+        // Command parsed by the main loop
+        if (issued < NUM_COMMANDS && t >= next_cmd_us)
+        {
+            uint8_t const code = (uint8_t)(HID_KEY_A + issued % 26);
+
+            if (mode == MODE_EVENT)
+            {
+                keyboard_keystroke(code);
+            }
+            else
+            {
+                polled_keystroke = code;
+            }
+
+            cmd_us = t;
+            pending_code = code;
+            issued++;
+            // 50..70 ms apart so the polled path never overwrites a keystroke
+            next_cmd_us = t + 50000 + (lcg_next() % 2000) * STEP_US;
+        }
+
+        if (mode == MODE_POLLED && t % POLLED_TICK_US == 0)
+        {
+            polled_hid_task();
+        }
+
+        // IN token from the host
+        if (t % interval_us == POLL_PHASE_US % interval_us && ep_armed[0])
+        {
+            ep_armed[0] = false;
+            delivered++;
+
+            if (pending_code && report_has_key(mode, pending_code))
+            {
+                uint32_t const us = t - cmd_us;
+                lat.count++;
+                lat.sum_us += us;
+                lat.max_us = tu_max32(lat.max_us, us);
+                pending_code = 0;
+            }
+
+            if (mode == MODE_EVENT)
+            {
+                report_queue_complete(&queue[0]);
+            }
+        }
+
+        TEST_ASSERT_TRUE_MESSAGE(t < 3600000000u, "simulation did not finish");
+    }
+
+    return lat;
+}
+
+static void report(char const *name, uint32_t interval_us, latency_t const *lat)
+{
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s bInterval=%lu us: mean=%lu us max=%lu us", name, (unsigned long)interval_us,
+             (unsigned long)(lat->sum_us / lat->count), (unsigned long)lat->max_us);
+    TEST_MESSAGE(msg);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_polled_latency_dominated_by_tick(void)
+{
+    latency_t const lat = run(MODE_POLLED, 1000);
+    report("polled", 1000, &lat);
+
+    TEST_ASSERT_EQUAL(NUM_COMMANDS, lat.count);
+    // waits for the 10 ms tick even though the host polls every 1 ms
+    TEST_ASSERT_GREATER_THAN(POLLED_TICK_US - STEP_US, lat.max_us);
+    TEST_ASSERT_GREATER_THAN(POLLED_TICK_US / 3, lat.sum_us / lat.count);
+}
+
+void test_event_latency_bounded_by_interval_1ms(void)
+{
+    latency_t const lat = run(MODE_EVENT, 1000);
+    report("event", 1000, &lat);
+
+    TEST_ASSERT_EQUAL(NUM_COMMANDS, lat.count);
+    TEST_ASSERT_LESS_OR_EQUAL(1000, lat.max_us);
+    // press and release of every keystroke reached the host
+    TEST_ASSERT_EQUAL(2 * NUM_COMMANDS, delivered);
+}
+
+void test_event_latency_bounded_by_interval_10ms(void)
+{
+    latency_t const polled = run(MODE_POLLED, 10000);
+    report("polled", 10000, &polled);
+    latency_t const event = run(MODE_EVENT, 10000);
+    report("event", 10000, &event);
+
+    TEST_ASSERT_EQUAL(NUM_COMMANDS, event.count);
+    TEST_ASSERT_LESS_OR_EQUAL(10000, event.max_us);
+    TEST_ASSERT_LESS_THAN(polled.sum_us / polled.count, event.sum_us / event.count);
+}
+
+void test_event_faster_than_polled(void)
+{
+    latency_t const polled = run(MODE_POLLED, 1000);
+    latency_t const event = run(MODE_EVENT, 1000);
+
+    // mean latency drops by the average tick wait, about 5 ms
+    TEST_ASSERT_LESS_THAN(polled.sum_us / polled.count - 3000, event.sum_us / event.count);
+}
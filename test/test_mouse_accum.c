@@ -0,0 +1,260 @@
+#include <string.h>
+#include "unity.h"
+
+#include "mouse_accum.h"
+
+static mouse_accum_t accum;
+
+//--------------------------------------------------------------------+
+// Fake HID endpoint
+//--------------------------------------------------------------------+
+static bool ep_busy;
+static hid_mouse_report_t sent[64];
+static uint16_t sent_count;
+static mouse_boot_report_t sent_boot[64]; // reports sent in boot protocol
+static uint16_t sent_boot_count;
+
+bool tud_hid_n_ready(uint8_t instance)
+{
+    (void)instance;
+    return !ep_busy;
+}
+
+static union
+{
+    hid_mouse_report_t report;
+    mouse_boot_report_t boot;
+} ep_buf;
+
+void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len)
+{
+    (void)instance;
+    (void)report_id;
+
+    uint16_t const expected = accum.protocol == HID_PROTOCOL_BOOT ? sizeof(mouse_boot_report_t) : sizeof(hid_mouse_report_t);
+    TEST_ASSERT_EQUAL(expected, len);
+    return ep_busy ? NULL : &ep_buf;
+}
+
+bool tud_hid_n_report_commit(uint8_t instance, uint16_t len)
+{
+    (void)instance;
+
+    ep_busy = true;
+    if (len == sizeof(mouse_boot_report_t))
+    {
+        sent_boot[sent_boot_count++] = ep_buf.boot;
+    }
+    else
+    {
+        TEST_ASSERT_EQUAL(sizeof(hid_mouse_report_t), len);
+        sent[sent_count++] = ep_buf.report;
+    }
+    return true;
+}
+
+// Host polled the endpoint
+static void ep_complete(void)
+{
+    ep_busy = false;
+    mouse_accum_complete(&accum);
+}
+
+static void drain(void)
+{
+    while (ep_busy)
+    {
+        ep_complete();
+    }
+}
+
+void setUp(void)
+{
+    ep_busy = false;
+    sent_count = 0;
+    memset(sent, 0, sizeof(sent));
+    sent_boot_count = 0;
+    memset(sent_boot, 0, sizeof(sent_boot));
+    mouse_accum_init(&accum, 2);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_move_sent_immediately_when_idle(void)
+{
+    mouse_accum_move(&accum, 10, -5);
+
+    TEST_ASSERT_EQUAL(1, sent_count);
+    TEST_ASSERT_EQUAL(10, sent[0].x);
+    TEST_ASSERT_EQUAL(-5, sent[0].y);
+    TEST_ASSERT_EQUAL(0, sent[0].buttons);
+    TEST_ASSERT_FALSE(mouse_accum_pending(&accum));
+}
+
+void test_moves_summed_while_busy(void)
+{
+    mouse_accum_move(&accum, 1, 1);
+    for (int i = 0; i < 10; i++)
+    {
+        mouse_accum_move(&accum, 3, -2);
+    }
+    TEST_ASSERT_EQUAL(1, sent_count);
+    TEST_ASSERT_EQUAL(9, accum.merged); // the first one started a new sum
+
+    drain();
+
+    // one report carries everything that arrived while busy
+    TEST_ASSERT_EQUAL(2, sent_count);
+    TEST_ASSERT_EQUAL(30, sent[1].x);
+    TEST_ASSERT_EQUAL(-20, sent[1].y);
+}
+
+void test_no_empty_reports(void)
+{
+    mouse_accum_move(&accum, 5, 5);
+    drain();
+    TEST_ASSERT_EQUAL(1, sent_count);
+
+    // nothing pending: completions and zero moves do not produce reports
+    ep_complete();
+    mouse_accum_move(&accum, 0, 0);
+    mouse_accum_buttons(&accum, 0);
+    TEST_ASSERT_EQUAL(1, sent_count);
+}
+
+void test_oversized_delta_split(void)
+{
+    ep_busy = true;
+    for (int i = 0; i < 5; i++)
+    {
+        mouse_accum_move(&accum, 30000, -30000);
+    }
+    drain();
+
+    // 150000 does not fit int16: 32767 * 4 + 18932
+    TEST_ASSERT_EQUAL(5, sent_count);
+    int32_t sum_x = 0, sum_y = 0;
+    for (int i = 0; i < sent_count; i++)
+    {
+        TEST_ASSERT_TRUE(sent[i].x <= MOUSE_ACCUM_MAX_DELTA);
+        TEST_ASSERT_TRUE(sent[i].y >= -MOUSE_ACCUM_MAX_DELTA);
+        sum_x += sent[i].x;
+        sum_y += sent[i].y;
+    }
+    TEST_ASSERT_EQUAL(150000, sum_x);
+    TEST_ASSERT_EQUAL(-150000, sum_y);
+    TEST_ASSERT_EQUAL(4, accum.splits);
+}
+
+void test_click_while_busy_not_lost(void)
+{
+    mouse_accum_move(&accum, 1, 0);
+    mouse_accum_buttons(&accum, MOUSE_BUTTON_LEFT);
+    mouse_accum_buttons(&accum, 0);
+    drain();
+
+    TEST_ASSERT_EQUAL(3, sent_count);
+    TEST_ASSERT_EQUAL(0, sent[0].buttons);
+    TEST_ASSERT_EQUAL(MOUSE_BUTTON_LEFT, sent[1].buttons);
+    TEST_ASSERT_EQUAL(0, sent[2].buttons);
+}
+
+void test_motion_stays_on_its_side_of_a_button_change(void)
+{
+    mouse_accum_move(&accum, 1, 1); // in flight
+
+    mouse_accum_move(&accum, 10, 0);                 // before the press
+    mouse_accum_buttons(&accum, MOUSE_BUTTON_LEFT);  // drag starts
+    mouse_accum_move(&accum, 0, 20);                 // dragging
+    mouse_accum_move(&accum, 0, 5);
+    mouse_accum_buttons(&accum, 0);
+    drain();
+
+    TEST_ASSERT_EQUAL(4, sent_count);
+    TEST_ASSERT_EQUAL(0, sent[1].buttons);
+    TEST_ASSERT_EQUAL(10, sent[1].x);
+    TEST_ASSERT_EQUAL(0, sent[1].y);
+    TEST_ASSERT_EQUAL(MOUSE_BUTTON_LEFT, sent[2].buttons);
+    TEST_ASSERT_EQUAL(0, sent[2].x);
+    TEST_ASSERT_EQUAL(25, sent[2].y);
+    TEST_ASSERT_EQUAL(0, sent[3].buttons);
+    TEST_ASSERT_EQUAL(0, sent[3].y);
+}
+
+void test_button_changes_overflow(void)
+{
+    ep_busy = true;
+    for (int i = 0; i < MOUSE_ACCUM_SEGMENTS + 3; i++)
+    {
+        mouse_accum_buttons(&accum, (i & 1) ? 0 : MOUSE_BUTTON_LEFT);
+    }
+    TEST_ASSERT_EQUAL(3, accum.dropped);
+
+    drain();
+
+    // the final state always reaches the host
+    TEST_ASSERT_EQUAL(MOUSE_BUTTON_LEFT, sent[sent_count - 1].buttons);
+}
+
+void test_clear_drops_pending(void)
+{
+    ep_busy = true;
+    mouse_accum_move(&accum, 7, 7);
+    mouse_accum_buttons(&accum, MOUSE_BUTTON_RIGHT);
+    TEST_ASSERT_TRUE(mouse_accum_pending(&accum));
+
+    mouse_accum_clear(&accum);
+    TEST_ASSERT_FALSE(mouse_accum_pending(&accum));
+
+    drain();
+    TEST_ASSERT_EQUAL(0, sent_count);
+}
+
+void test_boot_protocol_splits_at_int8(void)
+{
+    mouse_accum_set_protocol(&accum, HID_PROTOCOL_BOOT);
+    drain();
+    sent_boot_count = 0;
+
+    ep_busy = true;
+    mouse_accum_move(&accum, 300, -200);
+    drain();
+
+    TEST_ASSERT_EQUAL(0, sent_count);
+    TEST_ASSERT_EQUAL(3, sent_boot_count);
+    int32_t sum_x = 0, sum_y = 0;
+    for (int i = 0; i < sent_boot_count; i++)
+    {
+        sum_x += sent_boot[i].x;
+        sum_y += sent_boot[i].y;
+    }
+    TEST_ASSERT_EQUAL(300, sum_x);
+    TEST_ASSERT_EQUAL(-200, sum_y);
+}
+
+void test_protocol_switch_reports_buttons_again(void)
+{
+    mouse_accum_buttons(&accum, MOUSE_BUTTON_LEFT);
+    drain();
+    TEST_ASSERT_EQUAL(1, sent_count);
+
+    mouse_accum_set_protocol(&accum, HID_PROTOCOL_BOOT);
+    drain();
+    TEST_ASSERT_EQUAL(1, sent_boot_count);
+    TEST_ASSERT_EQUAL_HEX8(MOUSE_BUTTON_LEFT, sent_boot[0].buttons);
+
+    // Same protocol again changes nothing
+    mouse_accum_set_protocol(&accum, HID_PROTOCOL_BOOT);
+    drain();
+    TEST_ASSERT_EQUAL(1, sent_boot_count);
+
+    mouse_accum_set_protocol(&accum, HID_PROTOCOL_REPORT);
+    drain();
+    TEST_ASSERT_EQUAL(2, sent_count);
+    TEST_ASSERT_EQUAL_HEX8(MOUSE_BUTTON_LEFT, sent[1].buttons);
+}
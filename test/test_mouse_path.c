@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include "unity.h"
+
+#include "mouse_path.h"
+
+static mouse_path_t path;
+
+static mouse_point_t const origin = {0, 0};
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Sample the path at 1 ms steps starting at t0, return the number of samples
+static uint16_t sample_all(uint32_t t0, mouse_point_t *out, uint16_t max)
+{
+    uint16_t n = 0;
+    for (uint32_t t = t0 + 1; n < max && mouse_path_next(&path, t, &out[n]); t++)
+    {
+        n++;
+    }
+    return n;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_linear_sequence(void)
+{
+    mouse_point_t const start = {100, -100};
+    mouse_point_t const end = {200, 300};
+    mouse_point_t s[8];
+
+    TEST_ASSERT_TRUE(mouse_path_start(&path, start, end, NULL, 0, MOUSE_PATH_LINEAR, 4, 1000));
+    TEST_ASSERT_EQUAL(4, sample_all(1000, s, 8));
+
+    int16_t const x[4] = {125, 150, 175, 200};
+    int16_t const y[4] = {0, 100, 200, 300};
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(x[i], s[i].x);
+        TEST_ASSERT_EQUAL_INT16(y[i], s[i].y);
+    }
+    TEST_ASSERT_FALSE(mouse_path_active(&path));
+}
+
+void test_full_range_no_overflow(void)
+{
+    mouse_point_t const start = {-32768, 32767};
+    mouse_point_t const end = {32767, -32768};
+    mouse_point_t s[16];
+
+    TEST_ASSERT_TRUE(mouse_path_start(&path, start, end, NULL, 0, MOUSE_PATH_LINEAR, 16, 0));
+    TEST_ASSERT_EQUAL(16, sample_all(0, s, 16));
+
+    for (int i = 1; i < 16; i++)
+    {
+        TEST_ASSERT_TRUE(s[i].x > s[i - 1].x);
+        TEST_ASSERT_TRUE(s[i].y < s[i - 1].y);
+    }
+    TEST_ASSERT_EQUAL_INT16(end.x, s[15].x);
+    TEST_ASSERT_EQUAL_INT16(end.y, s[15].y);
+}
+
+void test_easing_profiles(void)
+{
+    mouse_point_t const end = {1000, 0};
+    mouse_point_t s[10];
+
+    // ease in: first step short, last step long
+    mouse_path_start(&path, origin, end, NULL, 0, MOUSE_PATH_EASE_IN, 10, 0);
+    TEST_ASSERT_EQUAL(10, sample_all(0, s, 10));
+    TEST_ASSERT_EQUAL_INT16(10, s[0].x); // 0.1^2
+    TEST_ASSERT_EQUAL_INT16(1000, s[9].x);
+    TEST_ASSERT_TRUE(s[9].x - s[8].x > s[1].x - s[0].x);
+
+    // ease out mirrors it
+    mouse_path_start(&path, origin, end, NULL, 0, MOUSE_PATH_EASE_OUT, 10, 0);
+    sample_all(0, s, 10);
+    TEST_ASSERT_EQUAL_INT16(190, s[0].x); // 1-0.9^2
+    TEST_ASSERT_EQUAL_INT16(990, s[8].x);
+
+    // ease in-out: symmetric around the middle
+    mouse_path_start(&path, origin, end, NULL, 0, MOUSE_PATH_EASE_IN_OUT, 10, 0);
+    sample_all(0, s, 10);
+    TEST_ASSERT_EQUAL_INT16(500, s[4].x);
+    TEST_ASSERT_INT16_WITHIN(1, 1000 - s[1].x, s[7].x);
+    TEST_ASSERT_INT16_WITHIN(1, 28, s[0].x); // 3*0.1^2 - 2*0.1^3
+}
+
+void test_quadratic_bezier(void)
+{
+    mouse_point_t const end = {400, 0};
+    mouse_point_t const control = {200, 400};
+    mouse_point_t s[4];
+
+    TEST_ASSERT_TRUE(mouse_path_start(&path, origin, end, &control, 1, MOUSE_PATH_LINEAR, 4, 0));
+    TEST_ASSERT_EQUAL(4, sample_all(0, s, 4));
+
+    // B(t) = 2ut*C + t^2*E
+    TEST_ASSERT_EQUAL_INT16(100, s[0].x);
+    TEST_ASSERT_EQUAL_INT16(150, s[0].y);
+    TEST_ASSERT_EQUAL_INT16(200, s[1].x);
+    TEST_ASSERT_EQUAL_INT16(200, s[1].y);
+    TEST_ASSERT_EQUAL_INT16(300, s[2].x);
+    TEST_ASSERT_EQUAL_INT16(150, s[2].y);
+    TEST_ASSERT_EQUAL_INT16(400, s[3].x);
+    TEST_ASSERT_EQUAL_INT16(0, s[3].y);
+}
+
+void test_cubic_bezier_matches_reference(void)
+{
+    mouse_point_t const start = {-500, 250};
+    mouse_point_t const end = {1500, -750};
+    mouse_point_t const controls[2] = {{0, 2000}, {1200, -3000}};
+    mouse_point_t s[100];
+
+    TEST_ASSERT_TRUE(mouse_path_start(&path, start, end, controls, 2, MOUSE_PATH_LINEAR, 100, 0));
+    TEST_ASSERT_EQUAL(100, sample_all(0, s, 100));
+
+    for (int i = 0; i < 100; i++)
+    {
+        double const t = (i + 1) / 100.0, u = 1 - t;
+        double const w[4] = {u * u * u, 3 * u * u * t, 3 * u * t * t, t * t * t};
+        double const x = w[0] * start.x + w[1] * controls[0].x + w[2] * controls[1].x + w[3] * end.x;
+        double const y = w[0] * start.y + w[1] * controls[0].y + w[2] * controls[1].y + w[3] * end.y;
+
+        // Q15 weights: within a pixel or two of the exact curve
+        TEST_ASSERT_INT16_WITHIN(2, (int16_t)(x < 0 ? x - 0.5 : x + 0.5), s[i].x);
+        TEST_ASSERT_INT16_WITHIN(2, (int16_t)(y < 0 ? y - 0.5 : y + 0.5), s[i].y);
+    }
+    TEST_ASSERT_EQUAL_INT16(end.x, s[99].x);
+    TEST_ASSERT_EQUAL_INT16(end.y, s[99].y);
+}
+
+void test_late_sample_ends_path(void)
+{
+    mouse_point_t const end = {10, 20};
+    mouse_point_t p;
+
+    // a caller that falls behind still lands on the end point, with a wrapping clock
+    mouse_path_start(&path, origin, end, NULL, 0, MOUSE_PATH_EASE_IN_OUT, 50, UINT32_MAX - 5);
+    TEST_ASSERT_TRUE(mouse_path_next(&path, 100, &p));
+    TEST_ASSERT_EQUAL_INT16(10, p.x);
+    TEST_ASSERT_EQUAL_INT16(20, p.y);
+    TEST_ASSERT_FALSE(mouse_path_next(&path, 101, &p));
+}
+
+void test_invalid_parameters(void)
+{
+    mouse_point_t const controls[3] = {{0, 0}, {0, 0}, {0, 0}};
+
+    TEST_ASSERT_FALSE(mouse_path_start(&path, origin, origin, controls, 3, MOUSE_PATH_LINEAR, 10, 0));
+    TEST_ASSERT_FALSE(mouse_path_start(&path, origin, origin, NULL, 0, MOUSE_PATH_EASING_COUNT, 10, 0));
+}
+
+void test_zero_duration_jumps_to_end(void)
+{
+    mouse_point_t const end = {7, 8};
+    mouse_point_t p;
+
+    mouse_path_start(&path, origin, end, NULL, 0, MOUSE_PATH_LINEAR, 0, 0);
+    TEST_ASSERT_TRUE(mouse_path_next(&path, 0, &p));
+    TEST_ASSERT_EQUAL_INT16(7, p.x);
+    TEST_ASSERT_FALSE(mouse_path_active(&path));
+}
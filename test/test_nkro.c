@@ -0,0 +1,145 @@
+#include <string.h>
+#include "unity.h"
+
+#include "nkro.h"
+
+static nkro_state_t state;
+
+void setUp(void)
+{
+    nkro_clear(&state);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_press_release_bit(void)
+{
+    TEST_ASSERT_TRUE(nkro_press(&state, HID_KEY_A));
+    TEST_ASSERT_TRUE(nkro_is_pressed(&state, HID_KEY_A));
+    TEST_ASSERT_FALSE(nkro_is_pressed(&state, HID_KEY_B));
+
+    nkro_report_t report;
+    nkro_report(&state, &report);
+    TEST_ASSERT_EQUAL_HEX8(TU_BIT(HID_KEY_A & 7), report.keys[HID_KEY_A >> 3]);
+
+    TEST_ASSERT_TRUE(nkro_release(&state, HID_KEY_A));
+    TEST_ASSERT_FALSE(nkro_is_pressed(&state, HID_KEY_A));
+
+    nkro_state_t empty;
+    nkro_clear(&empty);
+    TEST_ASSERT_TRUE(nkro_equal(&empty, &state));
+}
+
+void test_more_than_six_keys(void)
+{
+    // every letter at once, nothing is ignored
+    for (uint8_t k = HID_KEY_A; k <= HID_KEY_Z; k++)
+    {
+        TEST_ASSERT_TRUE(nkro_press(&state, k));
+    }
+
+    for (uint8_t k = HID_KEY_A; k <= HID_KEY_Z; k++)
+    {
+        TEST_ASSERT_TRUE(nkro_is_pressed(&state, k));
+    }
+
+    // releasing from the middle leaves the others alone
+    nkro_release(&state, HID_KEY_M);
+    TEST_ASSERT_FALSE(nkro_is_pressed(&state, HID_KEY_M));
+    TEST_ASSERT_TRUE(nkro_is_pressed(&state, HID_KEY_L));
+    TEST_ASSERT_TRUE(nkro_is_pressed(&state, HID_KEY_N));
+}
+
+void test_modifiers_go_to_modifier_byte(void)
+{
+    nkro_press(&state, HID_KEY_SHIFT_LEFT);
+    nkro_press(&state, HID_KEY_GUI_RIGHT);
+
+    nkro_report_t report;
+    nkro_report(&state, &report);
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_LEFTSHIFT | KEYBOARD_MODIFIER_RIGHTGUI, report.modifier);
+
+    uint8_t const zero[NKRO_BITMAP_SIZE] = {0};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(zero, report.keys, NKRO_BITMAP_SIZE);
+
+    nkro_release(&state, HID_KEY_SHIFT_LEFT);
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_RIGHTGUI, state.modifier);
+}
+
+void test_out_of_range_rejected(void)
+{
+    TEST_ASSERT_FALSE(nkro_press(&state, HID_KEY_NONE));
+#if NKRO_KEY_COUNT < 256
+    TEST_ASSERT_FALSE(nkro_press(&state, NKRO_KEY_COUNT));
+#endif
+
+    nkro_state_t empty;
+    nkro_clear(&empty);
+    TEST_ASSERT_TRUE(nkro_equal(&empty, &state));
+}
+
+// International and LANG keys sit above 0x7F and still get a bit
+void test_keys_above_0x7f(void)
+{
+    nkro_report_t report;
+    hid_keyboard_report_t boot;
+
+    TEST_ASSERT_TRUE(nkro_press(&state, HID_KEY_KANJI1));
+    TEST_ASSERT_TRUE(nkro_press(&state, HID_KEY_LANG1));
+    TEST_ASSERT_TRUE(nkro_is_pressed(&state, HID_KEY_KANJI1));
+
+    nkro_report(&state, &report);
+    TEST_ASSERT_EQUAL_HEX8(TU_BIT(HID_KEY_KANJI1 & 7), report.keys[HID_KEY_KANJI1 >> 3]);
+    TEST_ASSERT_EQUAL_HEX8(TU_BIT(HID_KEY_LANG1 & 7), report.keys[HID_KEY_LANG1 >> 3]);
+
+    nkro_boot_report(&state, &boot);
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_KANJI1, boot.keycode[0]);
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_LANG1, boot.keycode[1]);
+
+    TEST_ASSERT_TRUE(nkro_release(&state, HID_KEY_KANJI1));
+    TEST_ASSERT_FALSE(nkro_is_pressed(&state, HID_KEY_KANJI1));
+}
+
+void test_boot_report_derived_from_bitmap(void)
+{
+    nkro_press(&state, HID_KEY_CONTROL_LEFT);
+    nkro_press(&state, HID_KEY_C);
+    nkro_press(&state, HID_KEY_A);
+    nkro_press(&state, HID_KEY_ENTER);
+
+    hid_keyboard_report_t boot;
+    nkro_boot_report(&state, &boot);
+
+    uint8_t const expected[6] = {HID_KEY_A, HID_KEY_C, HID_KEY_ENTER, 0, 0, 0};
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_LEFTCTRL, boot.modifier);
+    TEST_ASSERT_EQUAL_HEX8(0, boot.reserved);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, boot.keycode, 6);
+}
+
+void test_boot_report_rollover(void)
+{
+    for (uint8_t k = HID_KEY_1; k <= HID_KEY_7; k++)
+    {
+        nkro_press(&state, k);
+    }
+    nkro_press(&state, HID_KEY_SHIFT_RIGHT);
+
+    hid_keyboard_report_t boot;
+    nkro_boot_report(&state, &boot);
+
+    // more than 6 keys: ErrorRollOver in every slot, modifiers still valid
+    uint8_t const expected[6] = {1, 1, 1, 1, 1, 1};
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_RIGHTSHIFT, boot.modifier);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, boot.keycode, 6);
+
+    // back to 6 keys gives real keycodes again
+    nkro_release(&state, HID_KEY_7);
+    nkro_boot_report(&state, &boot);
+    uint8_t const six[6] = {HID_KEY_1, HID_KEY_2, HID_KEY_3, HID_KEY_4, HID_KEY_5, HID_KEY_6};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(six, boot.keycode, 6);
+}
@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "command_frame.h"
+#include "hid_reports.h"
+
+// Throughput simulation of the whole report pipeline at each polling interval.
+//
+// The UART delivers binary frames back to back at 115200 baud. Every frame
+// goes through the frame parser and the HID actions into the report queue;
+// the host takes one report per bInterval from the IN endpoint. The interface
+// must deliver a report on every poll once input outpaces the host.
+
+#define LINE_RATE_BYTES_PER_SEC (115200 / 10)
+#define BYTE_TIME_NS (1000000000ull / LINE_RATE_BYTES_PER_SEC)
+#define SIM_TIME_US 2000000u
+#define QUEUE_DEPTH 16
+
+enum
+{
+    ITF_KEYBOARD = 0,
+    ITF_MOUSE = 1,
+    ITF_MOUSE_REL = 2
+};
+
+typedef struct
+{
+    uint32_t polls;       // IN tokens after the first report was queued
+    uint32_t delivered;   // reports the host received
+    uint32_t idle_polls;  // polls answered with NAK although reports were waiting
+    uint32_t frames;      // frames received over the UART
+} rate_t;
+
+static report_queue_item_t queue_buf[CFG_TUD_HID][QUEUE_DEPTH];
+static report_queue_t queue[CFG_TUD_HID];
+static mouse_accum_t mouse_rel;
+static uint8_t typer_buf[256];
+static typer_t typer;
+static command_frame_parser_t parser;
+
+//--------------------------------------------------------------------+
+// Fake HID endpoint
+//--------------------------------------------------------------------+
+static bool ep_armed[CFG_TUD_HID];
+
+bool tud_hid_n_ready(uint8_t instance)
+{
+    return !ep_armed[instance];
+}
+
+static uint8_t ep_buf[CFG_TUD_HID][CFG_TUD_HID_EP_BUFSIZE];
+
+void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len)
+{
+    (void)report_id;
+    (void)len;
+
+    return ep_armed[instance] ? NULL : ep_buf[instance];
+}
+
+bool tud_hid_n_report_commit(uint8_t instance, uint16_t len)
+{
+    (void)len;
+
+    ep_armed[instance] = true;
+    return true;
+}
+
+void tud_hid_n_report_cancel(uint8_t instance)
+{
+    (void)instance;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+{
+    uint8_t *buf = tud_hid_n_report_stage(instance, report_id, len);
+    if (!buf)
+    {
+        return false;
+    }
+
+    memcpy(buf, report, len);
+    return tud_hid_n_report_commit(instance, len);
+}
+
+bool tud_suspended(void)
+{
+    return false;
+}
+
+bool tud_remote_wakeup(void)
+{
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Simulation
+//--------------------------------------------------------------------+
+static rate_t run(uint8_t itf, uint8_t interval_ms, uint8_t const *frame, uint16_t frame_len)
+{
+    rate_t rate = {0};
+    uint64_t next_byte_ns = 0;
+    uint16_t frame_index = 0;
+    bool started = false;
+
+    memset(ep_armed, 0, sizeof(ep_armed));
+    command_frame_reset(&parser);
+    report_queue_init(&queue[ITF_KEYBOARD], ITF_KEYBOARD, queue_buf[ITF_KEYBOARD], QUEUE_DEPTH, REPORT_QUEUE_COALESCE);
+    report_queue_init(&queue[ITF_MOUSE], ITF_MOUSE, queue_buf[ITF_MOUSE], QUEUE_DEPTH, REPORT_QUEUE_DROP_OLDEST);
+    mouse_accum_init(&mouse_rel, ITF_MOUSE_REL);
+    typer_init(&typer, typer_buf, sizeof(typer_buf));
+    hid_reports_init(&queue[ITF_KEYBOARD], &queue[ITF_MOUSE], &mouse_rel, &typer);
+
+    for (uint32_t t = 0; t < SIM_TIME_US; t++)
+    {
+        // UART byte received and parsed in the main loop
+        if ((uint64_t)t * 1000 >= next_byte_ns)
+        {
+            next_byte_ns += BYTE_TIME_NS;
+
+            if (command_frame_parse(&parser, frame[frame_index]) == COMMAND_FRAME_COMPLETE)
+            {
+                rate.frames++;
+                if (parser.opcode == FRAME_OP_MOUSE_MOVE)
+                {
+                    mouse_move((int16_t)tu_unaligned_read16(parser.payload),
+                               (int16_t)tu_unaligned_read16(parser.payload + 2));
+                }
+                else if (parser.opcode == FRAME_OP_MOUSE_REL_MOVE)
+                {
+                    mouse_rel_move((int16_t)tu_unaligned_read16(parser.payload),
+                                   (int16_t)tu_unaligned_read16(parser.payload + 2));
+                }
+                else if (parser.opcode == FRAME_OP_KEYBOARD_KEYSTROKE)
+                {
+                    keyboard_keystroke(parser.payload[0]);
+                }
+                else if (parser.opcode == FRAME_OP_KEYBOARD_TYPE)
+                {
+                    keyboard_type((char const *)parser.payload, parser.len);
+                }
+            }
+            frame_index = (uint16_t)((frame_index + 1) % frame_len);
+        }
+
+        // IN token from the host, start of a frame every bInterval ms
+        if (t % (interval_ms * 1000u) == 0)
+        {
+            started = started || ep_armed[itf];
+            if (!started)
+            {
+                continue;
+            }
+
+            rate.polls++;
+            if (ep_armed[itf])
+            {
+                ep_armed[itf] = false;
+                rate.delivered++;
+                if (itf == ITF_MOUSE_REL)
+                {
+                    mouse_accum_complete(&mouse_rel);
+                }
+                else
+                {
+                    report_queue_complete(&queue[itf]);
+                }
+
+                if (itf == ITF_KEYBOARD)
+                {
+                    keyboard_type_task();
+                }
+            }
+            else if (itf == ITF_MOUSE_REL  ? mouse_accum_pending(&mouse_rel)
+                     : itf == ITF_KEYBOARD ? report_queue_count(&queue[itf]) > 0 || typer_busy(&typer)
+                                           : report_queue_count(&queue[itf]) > 0)
+            {
+                rate.idle_polls++;
+            }
+        }
+    }
+
+    return rate;
+}
+
+static void check_rate(char const *name, uint8_t itf, uint8_t interval_ms, uint8_t const *frame, uint16_t frame_len)
+{
+    rate_t const rate = run(itf, interval_ms, frame, frame_len);
+    uint32_t const per_sec = (uint32_t)((uint64_t)rate.delivered * 1000000u / SIM_TIME_US);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%s bInterval=%u ms: %lu frames/s in, %lu reports/s out", name, interval_ms,
+             (unsigned long)((uint64_t)rate.frames * 1000000u / SIM_TIME_US), (unsigned long)per_sec);
+    TEST_MESSAGE(msg);
+
+    // every poll carries a report, none is wasted on an idle endpoint
+    TEST_ASSERT_EQUAL(0, rate.idle_polls);
+    TEST_ASSERT_EQUAL(rate.polls, rate.delivered);
+    TEST_ASSERT_UINT32_WITHIN(1000u / interval_ms / 100 + 1, 1000u / interval_ms, per_sec);
+}
+
+static uint16_t mouse_frame(uint8_t *out)
+{
+    uint8_t const payload[4] = {0x34, 0x12, 0x78, 0x56};
+    return command_frame_encode(FRAME_OP_MOUSE_MOVE, payload, sizeof(payload), out, COMMAND_FRAME_MAX_SIZE);
+}
+
+static uint16_t mouse_rel_frame(uint8_t *out)
+{
+    uint8_t const payload[4] = {0x03, 0x00, 0xfe, 0xff}; // +3, -2
+    return command_frame_encode(FRAME_OP_MOUSE_REL_MOVE, payload, sizeof(payload), out, COMMAND_FRAME_MAX_SIZE);
+}
+
+static uint16_t keystroke_frames(uint8_t *out)
+{
+    // alternate keys so consecutive keystrokes are distinct reports
+    uint8_t const a = HID_KEY_A, b = HID_KEY_B;
+    uint16_t len = command_frame_encode(FRAME_OP_KEYBOARD_KEYSTROKE, &a, 1, out, COMMAND_FRAME_MAX_SIZE);
+    len += command_frame_encode(FRAME_OP_KEYBOARD_KEYSTROKE, &b, 1, out + len, COMMAND_FRAME_MAX_SIZE);
+    return len;
+}
+
+static uint16_t type_frame(uint8_t *out)
+{
+    // distinct neighbours, every character is a single report
+    static char const text[] = "pack my box with five dozen jugs";
+    return command_frame_encode(FRAME_OP_KEYBOARD_TYPE, text, sizeof(text) - 1, out, COMMAND_FRAME_MAX_SIZE);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_mouse_1000_reports_per_second(void)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = mouse_frame(frame);
+
+    check_rate("mouse", ITF_MOUSE, 1, frame, len);
+}
+
+void test_mouse_rel_1000_reports_per_second(void)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = mouse_rel_frame(frame);
+
+    check_rate("mouse_rel", ITF_MOUSE_REL, 1, frame, len);
+}
+
+void test_keyboard_1000_reports_per_second(void)
+{
+    uint8_t frames[2 * COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = keystroke_frames(frames);
+
+    check_rate("keyboard", ITF_KEYBOARD, 1, frames, len);
+}
+
+void test_type_1000_characters_per_second(void)
+{
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = type_frame(frame);
+
+    // the UART carries ~1100 characters/s at 115200 baud, the endpoint types
+    // one per poll and never idles while text is pending
+    check_rate("type", ITF_KEYBOARD, 1, frame, len);
+    TEST_ASSERT_GREATER_OR_EQUAL(500, typer.typed * 1000000ull / SIM_TIME_US);
+}
+
+void test_mouse_all_intervals(void)
+{
+    uint8_t const intervals[] = {1, 2, 4, 8, 10};
+    uint8_t frame[COMMAND_FRAME_MAX_SIZE];
+    uint16_t const len = mouse_frame(frame);
+
+    for (unsigned i = 0; i < sizeof(intervals); i++)
+    {
+        check_rate("mouse", ITF_MOUSE, intervals[i], frame, len);
+    }
+}
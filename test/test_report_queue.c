@@ -0,0 +1,282 @@
+#include <string.h>
+#include "unity.h"
+
+#include "report_queue.h"
+
+#define DEPTH 4
+
+static report_queue_item_t queue_buf[DEPTH];
+static report_queue_t queue;
+
+//--------------------------------------------------------------------+
+// Fake HID endpoint
+//--------------------------------------------------------------------+
+static bool ep_busy;
+static uint8_t sent_log[64];
+static uint16_t sent_count;
+
+bool tud_hid_n_ready(uint8_t instance)
+{
+    (void)instance;
+    return !ep_busy;
+}
+
+static uint8_t ep_buf[CFG_TUD_HID_EP_BUFSIZE];
+
+void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len)
+{
+    (void)instance;
+    (void)report_id;
+    (void)len;
+
+    return ep_busy ? NULL : ep_buf;
+}
+
+bool tud_hid_n_report_commit(uint8_t instance, uint16_t len)
+{
+    (void)instance;
+    (void)len;
+
+    ep_busy = true;
+    sent_log[sent_count++] = ep_buf[0];
+    return true;
+}
+
+void tud_hid_n_report_cancel(uint8_t instance)
+{
+    (void)instance;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+{
+    uint8_t *buf = tud_hid_n_report_stage(instance, report_id, len);
+    if (!buf)
+    {
+        return false;
+    }
+
+    memcpy(buf, report, len);
+    return tud_hid_n_report_commit(instance, len);
+}
+
+// Transfer finished on the bus, as hidd_xfer_cb() would report it
+static void ep_complete(void)
+{
+    ep_busy = false;
+    report_queue_complete(&queue);
+}
+
+static void send(uint8_t value)
+{
+    report_queue_send(&queue, 0, &value, 1);
+}
+
+void setUp(void)
+{
+    ep_busy = false;
+    sent_count = 0;
+    memset(sent_log, 0, sizeof(sent_log));
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_send_immediately_when_idle(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    send(1);
+
+    TEST_ASSERT_EQUAL(1, sent_count);
+    TEST_ASSERT_EQUAL(0, report_queue_count(&queue));
+    TEST_ASSERT_EQUAL(1, queue.sent);
+    TEST_ASSERT_EQUAL(0, queue.queued);
+}
+
+void test_queued_reports_drain_in_order(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    for (uint8_t i = 1; i <= 5; i++)
+    {
+        send(i);
+    }
+    TEST_ASSERT_EQUAL(1, sent_count);
+    TEST_ASSERT_EQUAL(4, report_queue_count(&queue));
+
+    for (int i = 0; i < 4; i++)
+    {
+        ep_complete();
+    }
+
+    uint8_t const expected[] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL(5, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 5);
+    TEST_ASSERT_EQUAL(0, queue.dropped);
+}
+
+void test_drop_newest(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    for (uint8_t i = 1; i <= 7; i++)
+    {
+        send(i);
+    }
+    TEST_ASSERT_EQUAL(2, queue.dropped);
+
+    while (report_queue_count(&queue))
+    {
+        ep_complete();
+    }
+
+    uint8_t const expected[] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL(5, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 5);
+}
+
+void test_drop_oldest(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_OLDEST);
+
+    for (uint8_t i = 1; i <= 7; i++)
+    {
+        send(i);
+    }
+    TEST_ASSERT_EQUAL(2, queue.dropped);
+
+    while (report_queue_count(&queue))
+    {
+        ep_complete();
+    }
+
+    uint8_t const expected[] = {1, 4, 5, 6, 7};
+    TEST_ASSERT_EQUAL(5, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 5);
+}
+
+void test_free_slots(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_COALESCE);
+    TEST_ASSERT_EQUAL(DEPTH, report_queue_free(&queue));
+
+    send(1); // goes straight to the endpoint
+    send(2);
+    TEST_ASSERT_EQUAL(DEPTH - 1, report_queue_free(&queue));
+
+    for (uint8_t i = 3; i <= DEPTH + 1; i++)
+    {
+        send(i);
+    }
+    TEST_ASSERT_EQUAL(0, report_queue_free(&queue));
+
+    // Into the overflow slot: more reports are counted, still no room
+    send(DEPTH + 2);
+    TEST_ASSERT_EQUAL(DEPTH + 1, report_queue_count(&queue));
+    TEST_ASSERT_EQUAL(0, report_queue_free(&queue));
+
+    ep_complete();
+    TEST_ASSERT_EQUAL(0, report_queue_free(&queue));
+    ep_complete();
+    TEST_ASSERT_EQUAL(1, report_queue_free(&queue));
+}
+
+void test_coalesce_keeps_latest(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_COALESCE);
+
+    for (uint8_t i = 1; i <= 8; i++)
+    {
+        send(i);
+    }
+    // 1 in flight, 2..5 queued, 6 and 7 overwritten by 8
+    TEST_ASSERT_EQUAL(0, queue.dropped);
+    TEST_ASSERT_EQUAL(2, queue.coalesced);
+    TEST_ASSERT_EQUAL(5, report_queue_count(&queue));
+    TEST_ASSERT_EQUAL(0, report_queue_free(&queue));
+
+    while (report_queue_count(&queue))
+    {
+        ep_complete();
+    }
+
+    uint8_t const expected[] = {1, 2, 3, 4, 5, 8};
+    TEST_ASSERT_EQUAL(6, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 6);
+}
+
+void test_backlog_flushed_before_new_report(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    send(1);
+    send(2);
+
+    // endpoint went idle without a completion callback (e.g. after bus reset)
+    ep_busy = false;
+    send(3);
+
+    ep_complete();
+
+    uint8_t const expected[] = {1, 2, 3};
+    TEST_ASSERT_EQUAL(3, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 3);
+}
+
+void test_oversized_report_dropped(void)
+{
+    uint8_t big[CFG_TUD_HID_EP_BUFSIZE + 1] = {0};
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    TEST_ASSERT_FALSE(report_queue_send(&queue, 0, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(1, queue.dropped);
+    TEST_ASSERT_EQUAL(0, sent_count);
+}
+
+void test_stage_builds_in_endpoint_buffer_when_idle(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    uint8_t *buf = report_queue_stage(&queue, 0, 1);
+    TEST_ASSERT_EQUAL_PTR(ep_buf, buf);
+
+    *buf = 7;
+    TEST_ASSERT_TRUE(report_queue_commit(&queue, 1));
+    TEST_ASSERT_EQUAL(1, sent_count);
+    TEST_ASSERT_EQUAL(7, sent_log[0]);
+    TEST_ASSERT_EQUAL(1, queue.sent);
+}
+
+void test_stage_queues_when_busy(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+    send(1);
+
+    uint8_t *buf = report_queue_stage(&queue, 0, 1);
+    TEST_ASSERT_NOT_EQUAL(ep_buf, buf);
+
+    *buf = 2;
+    TEST_ASSERT_TRUE(report_queue_commit(&queue, 1));
+    TEST_ASSERT_EQUAL(1, report_queue_count(&queue));
+
+    ep_complete();
+    uint8_t const expected[] = {1, 2};
+    TEST_ASSERT_EQUAL(2, sent_count);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sent_log, 2);
+}
+
+void test_commit_longer_than_staged_is_dropped(void)
+{
+    report_queue_init(&queue, 0, queue_buf, DEPTH, REPORT_QUEUE_DROP_NEWEST);
+
+    TEST_ASSERT_NOT_NULL(report_queue_stage(&queue, 0, 1));
+    TEST_ASSERT_FALSE(report_queue_commit(&queue, 2));
+    TEST_ASSERT_EQUAL(0, sent_count);
+    TEST_ASSERT_EQUAL(1, queue.dropped);
+
+    TEST_ASSERT_NULL(report_queue_stage(&queue, 0, CFG_TUD_HID_EP_BUFSIZE + 1));
+}
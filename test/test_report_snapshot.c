@@ -0,0 +1,96 @@
+#include <string.h>
+#include "unity.h"
+
+#include "report_snapshot.h"
+
+static report_snapshot_t snapshot;
+
+void setUp(void)
+{
+    report_snapshot_init(&snapshot);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_nothing_stored_returns_zero(void)
+{
+    uint8_t buf[8];
+
+    TEST_ASSERT_EQUAL(0, report_snapshot_get(&snapshot, 0, 0, buf, sizeof(buf)));
+}
+
+void test_latest_report_wins(void)
+{
+    uint8_t const first[] = {1, 2, 3};
+    uint8_t const second[] = {4, 5, 6};
+    uint8_t buf[8];
+
+    TEST_ASSERT_TRUE(report_snapshot_store(&snapshot, 1, 0, first, sizeof(first)));
+    TEST_ASSERT_TRUE(report_snapshot_store(&snapshot, 1, 0, second, sizeof(second)));
+
+    TEST_ASSERT_EQUAL(3, report_snapshot_get(&snapshot, 1, 0, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(second, buf, 3);
+    TEST_ASSERT_EQUAL(1, snapshot.count);
+}
+
+void test_instances_and_report_ids_are_separate(void)
+{
+    uint8_t const a = 0xA0, b = 0xB0, c = 0xC0;
+    uint8_t buf[8];
+
+    report_snapshot_store(&snapshot, 0, 0, &a, 1);
+    report_snapshot_store(&snapshot, 1, 0, &b, 1);
+    report_snapshot_store(&snapshot, 1, 2, &c, 1);
+
+    report_snapshot_get(&snapshot, 0, 0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_HEX8(a, buf[0]);
+    report_snapshot_get(&snapshot, 1, 0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_HEX8(b, buf[0]);
+    report_snapshot_get(&snapshot, 1, 2, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_HEX8(c, buf[0]);
+    TEST_ASSERT_EQUAL(0, report_snapshot_get(&snapshot, 0, 2, buf, sizeof(buf)));
+}
+
+void test_get_truncates_to_request_length(void)
+{
+    uint8_t const report[] = {1, 2, 3, 4};
+    uint8_t buf[4] = {0};
+
+    report_snapshot_store(&snapshot, 0, 0, report, sizeof(report));
+
+    TEST_ASSERT_EQUAL(2, report_snapshot_get(&snapshot, 0, 0, buf, 2));
+    TEST_ASSERT_EQUAL_UINT8(0, buf[2]);
+}
+
+void test_full_table_and_long_reports_are_dropped(void)
+{
+    uint8_t const report[CFG_TUD_HID_EP_BUFSIZE + 1] = {0};
+
+    for (uint8_t i = 0; i < REPORT_SNAPSHOT_SLOTS; i++)
+    {
+        TEST_ASSERT_TRUE(report_snapshot_store(&snapshot, i, 0, report, 1));
+    }
+
+    TEST_ASSERT_FALSE(report_snapshot_store(&snapshot, REPORT_SNAPSHOT_SLOTS, 0, report, 1));
+    TEST_ASSERT_FALSE(report_snapshot_store(&snapshot, 0, 0, report, sizeof(report)));
+    TEST_ASSERT_EQUAL(2, snapshot.dropped);
+
+    // existing entries can still be updated
+    TEST_ASSERT_TRUE(report_snapshot_store(&snapshot, 0, 0, report, 1));
+}
+
+void test_clear_forgets_reports(void)
+{
+    uint8_t const report = 1;
+    uint8_t buf[1];
+
+    report_snapshot_store(&snapshot, 0, 0, &report, 1);
+    report_snapshot_clear(&snapshot);
+
+    TEST_ASSERT_EQUAL(0, report_snapshot_get(&snapshot, 0, 0, buf, sizeof(buf)));
+}
@@ -0,0 +1,215 @@
+#include <string.h>
+#include "unity.h"
+
+#include "rx_ring.h"
+
+#define RING_SIZE 256
+
+// 115200 baud 8N1 is 10 bits per byte: one byte every 86.8 us
+#define LINE_RATE_BYTES_PER_SEC (115200 / 10)
+#define BYTE_TIME_NS (1000000000ull / LINE_RATE_BYTES_PER_SEC)
+
+static uint8_t ring_buf[RING_SIZE];
+static rx_ring_t ring;
+
+void setUp(void)
+{
+    rx_ring_init(&ring, ring_buf, RING_SIZE);
+}
+
+void tearDown(void)
+{
+}
+
+// DMA channel writing into ring_buf in ring mode, as set up by uart_rx_dma_init()
+typedef struct
+{
+    uint32_t armed;
+    uint32_t remaining;
+    uint32_t write_addr; // offset into ring_buf, wraps at RING_SIZE like the DMA ring mode
+} dma_model_t;
+
+static void dma_model_start(dma_model_t *dma, uint32_t transfer_count)
+{
+    dma->armed = transfer_count;
+    dma->remaining = transfer_count;
+    dma->write_addr = 0;
+    rx_ring_dma_start(&ring, transfer_count);
+}
+
+// DMA moves n bytes from the UART, stops when the transfer count runs out.
+// Return number of bytes that could not be transferred.
+static uint32_t dma_model_receive(dma_model_t *dma, uint8_t const *data, uint32_t n)
+{
+    uint32_t i;
+    for (i = 0; i < n && dma->remaining; i++)
+    {
+        ring_buf[dma->write_addr] = data[i];
+        dma->write_addr = (dma->write_addr + 1) % RING_SIZE;
+        dma->remaining--;
+    }
+    return n - i;
+}
+
+// Mirror of uart_rx_dma_flush()
+static void dma_model_flush(dma_model_t *dma)
+{
+    if (rx_ring_dma_update(&ring, dma->remaining))
+    {
+        dma->remaining = dma->armed;
+    }
+}
+
+// Simulate the DMA writing bytes at line rate while the main loop flushes
+// and drains the ring every loop_ns, stalling once for stall_ns at stall_at_ns.
+// Return the number of bytes the consumer received; they must come in order
+// until the ring overflows.
+static uint32_t run_line_rate(uint64_t duration_ns, uint64_t loop_ns, uint64_t stall_at_ns, uint64_t stall_ns)
+{
+    dma_model_t dma;
+    uint8_t next_tx = 0;
+    uint8_t next_rx = 0;
+    uint32_t consumed = 0;
+    uint64_t next_loop = loop_ns;
+
+    dma_model_start(&dma, 0xFFFFFFFFu);
+
+    for (uint64_t t = 0; t < duration_ns; t += BYTE_TIME_NS)
+    {
+        dma_model_receive(&dma, &next_tx, 1);
+        next_tx++;
+
+        if (t >= next_loop)
+        {
+            uint8_t chunk[32];
+            uint16_t count;
+
+            dma_model_flush(&dma);
+            while ((count = rx_ring_read(&ring, chunk, sizeof(chunk))) > 0)
+            {
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    if (ring.overflow == 0)
+                    {
+                        TEST_ASSERT_EQUAL_UINT8(next_rx, chunk[i]);
+                    }
+                    next_rx = (uint8_t)(chunk[i] + 1);
+                }
+                consumed += count;
+            }
+
+            next_loop += loop_ns;
+            if (next_loop >= stall_at_ns && next_loop < stall_at_ns + loop_ns)
+            {
+                next_loop += stall_ns;
+            }
+        }
+    }
+
+    dma_model_flush(&dma);
+    return consumed + rx_ring_count(&ring);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_full_line_rate_no_overflow(void)
+{
+    // 1 s of traffic, main loop every 1 ms with a single 20 ms hiccup (ring holds ~22 ms)
+    uint32_t consumed = run_line_rate(1000000000ull, 1000000ull, 500000000ull, 20000000ull);
+
+    TEST_ASSERT_EQUAL(0, ring.overflow);
+    TEST_ASSERT_EQUAL(ring.received, consumed);
+    TEST_ASSERT_UINT32_WITHIN(1, LINE_RATE_BYTES_PER_SEC, ring.received);
+}
+
+void test_full_line_rate_stall_overflows(void)
+{
+    // a 50 ms stall loses whatever does not fit in the ring, and nothing else
+    run_line_rate(1000000000ull, 1000000ull, 500000000ull, 50000000ull);
+
+    uint32_t const arrived = ring.received + ring.overflow;
+    TEST_ASSERT_UINT32_WITHIN(1, LINE_RATE_BYTES_PER_SEC, arrived);
+    TEST_ASSERT_UINT32_WITHIN(16, 50000000ull / BYTE_TIME_NS - RING_SIZE, ring.overflow);
+}
+
+void test_dma_short_command_flushed_immediately(void)
+{
+    dma_model_t dma;
+    dma_model_start(&dma, 0xFFFFFFFFu);
+
+    // a 3 byte command must be readable after a single flush, no watermark involved
+    dma_model_receive(&dma, (uint8_t const *)"a\r\n", 3);
+    dma_model_flush(&dma);
+
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL(3, rx_ring_read(&ring, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_MEMORY("a\r\n", out, 3);
+    TEST_ASSERT_EQUAL(3, ring.received);
+
+    // flushing again without new data is a no-op
+    dma_model_flush(&dma);
+    TEST_ASSERT_EQUAL(0, rx_ring_count(&ring));
+}
+
+void test_dma_wraps_ring_and_rearms(void)
+{
+    dma_model_t dma;
+    uint8_t next_tx = 0, next_rx = 0;
+
+    // small transfer count so the channel is re-armed many times
+    dma_model_start(&dma, 100);
+
+    for (int iter = 0; iter < 1000; iter++)
+    {
+        uint8_t data[37];
+        for (unsigned i = 0; i < sizeof(data); i++)
+        {
+            data[i] = next_tx++;
+        }
+
+        // bytes arriving while the channel is stopped stay in the UART FIFO
+        uint32_t left = dma_model_receive(&dma, data, sizeof(data));
+        dma_model_flush(&dma);
+        TEST_ASSERT_EQUAL(0, dma_model_receive(&dma, data + sizeof(data) - left, left));
+        dma_model_flush(&dma);
+
+        uint8_t out[64];
+        uint16_t count = rx_ring_read(&ring, out, sizeof(out));
+        TEST_ASSERT_EQUAL(sizeof(data), count);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            TEST_ASSERT_EQUAL_UINT8(next_rx++, out[i]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(1000 * 37, ring.received);
+    TEST_ASSERT_EQUAL(0, ring.overflow);
+}
+
+void test_dma_overrun_drops_oldest(void)
+{
+    dma_model_t dma;
+    uint8_t data[RING_SIZE + 40];
+    for (unsigned i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+
+    dma_model_start(&dma, 0xFFFFFFFFu);
+    dma_model_receive(&dma, data, 10);
+    dma_model_flush(&dma);
+
+    // consumer stalls while the DMA laps it
+    dma_model_receive(&dma, data + 10, sizeof(data) - 10);
+    dma_model_flush(&dma);
+
+    TEST_ASSERT_EQUAL(40, ring.overflow);
+    TEST_ASSERT_EQUAL(RING_SIZE, ring.received);
+    TEST_ASSERT_EQUAL(RING_SIZE, rx_ring_count(&ring));
+
+    // the newest RING_SIZE bytes survive, in order
+    uint8_t out[RING_SIZE];
+    TEST_ASSERT_EQUAL(RING_SIZE, rx_ring_read(&ring, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data + 40, out, RING_SIZE);
+}
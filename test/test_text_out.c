@@ -0,0 +1,63 @@
+#include <string.h>
+#include "unity.h"
+
+#include "text_out.h"
+
+static char buf[32];
+static text_out_t out;
+
+void setUp(void)
+{
+    memset(buf, 'x', sizeof(buf));
+    text_out_init(&out, buf, sizeof(buf));
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_init_is_empty(void)
+{
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    TEST_ASSERT_EQUAL(0, out.len);
+}
+
+void test_decimal(void)
+{
+    text_out_u32(&out, 0);
+    text_out_str(&out, " ");
+    text_out_u32(&out, 7);
+    text_out_str(&out, " ");
+    text_out_u32(&out, 1000);
+    text_out_str(&out, " ");
+    text_out_u32(&out, UINT32_MAX);
+
+    TEST_ASSERT_EQUAL_STRING("0 7 1000 4294967295", buf);
+    TEST_ASSERT_EQUAL(strlen(buf), out.len);
+}
+
+void test_fields_build_a_stats_line(void)
+{
+    text_out_field(&out, "queue,", 1);
+    text_out_field(&out, ",sent=", 42);
+    text_out_str(&out, "\n");
+
+    TEST_ASSERT_EQUAL_STRING("queue,1,sent=42\n", buf);
+}
+
+void test_overflow_is_cut_off_and_terminated(void)
+{
+    char small[8];
+    memset(small, 'x', sizeof(small));
+    text_out_init(&out, small, sizeof(small));
+
+    text_out_str(&out, "led,");
+    text_out_u32(&out, 123456);
+    text_out_str(&out, "\n");
+
+    TEST_ASSERT_EQUAL_STRING("led,123", small);
+    TEST_ASSERT_EQUAL(7, out.len);
+}
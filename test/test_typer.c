@@ -0,0 +1,172 @@
+#include <string.h>
+#include "unity.h"
+
+#include "typer.h"
+
+static uint8_t const keycode_to_ascii[128][2] = {HID_KEYCODE_TO_ASCII};
+
+static uint8_t typer_buf[64];
+static typer_t typer;
+
+// Run the typer to the end, return the text the host sees and the number of reports
+static uint16_t type_out(char const *text, char *out, uint16_t out_size)
+{
+    uint8_t modifier, keycode;
+    uint8_t prev_keycode = 0;
+    uint16_t reports = 0;
+    uint16_t n = 0;
+
+    typer_write(&typer, text, (uint16_t)strlen(text));
+
+    while (typer_next(&typer, &modifier, &keycode))
+    {
+        reports++;
+
+        // the host types a character when a key goes down
+        if (keycode && keycode != prev_keycode && n + 1 < out_size)
+        {
+            bool const shift = modifier & KEYBOARD_MODIFIER_LEFTSHIFT;
+            out[n++] = (char)keycode_to_ascii[keycode][shift ? 1 : 0];
+        }
+        prev_keycode = keycode;
+    }
+    out[n] = 0;
+
+    return reports;
+}
+
+void setUp(void)
+{
+    typer_init(&typer, typer_buf, sizeof(typer_buf));
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_distinct_characters_one_report_each(void)
+{
+    char out[32];
+    uint16_t const reports = type_out("Hello, World!", out, sizeof(out));
+
+    // "ll" needs a release, plus the final release
+    TEST_ASSERT_EQUAL_STRING("Hello, World!", out);
+    TEST_ASSERT_EQUAL(13 + 1 + 1, reports);
+    TEST_ASSERT_EQUAL(13, typer.typed);
+    TEST_ASSERT_FALSE(typer_busy(&typer));
+}
+
+void test_repeated_character_released_in_between(void)
+{
+    uint8_t modifier, keycode;
+
+    typer_write(&typer, "aa", 2);
+
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_A, keycode);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(0, keycode);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_A, keycode);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(0, keycode);
+    TEST_ASSERT_FALSE(typer_next(&typer, &modifier, &keycode));
+}
+
+void test_shift_follows_character(void)
+{
+    uint8_t modifier, keycode;
+
+    // same key with and without shift still needs a release
+    typer_write(&typer, "1!", 2);
+
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(0, modifier);
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_1, keycode);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(0, keycode);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_LEFTSHIFT, modifier);
+    TEST_ASSERT_EQUAL_HEX8(HID_KEY_1, keycode);
+}
+
+void test_crlf_is_one_enter(void)
+{
+    char out[16];
+    type_out("a\r\nb\nc", out, sizeof(out));
+
+    TEST_ASSERT_EQUAL_STRING("a\rb\rc", out);
+}
+
+void test_non_ascii_skipped(void)
+{
+    char out[16];
+
+    // "é" is two UTF-8 bytes, counted as one skipped character
+    type_out("caf\xc3\xa9!", out, sizeof(out));
+
+    TEST_ASSERT_EQUAL_STRING("caf!", out);
+    TEST_ASSERT_EQUAL(4, typer.typed);
+    TEST_ASSERT_EQUAL(1, typer.skipped);
+}
+
+void test_overflow_counted(void)
+{
+    char text[100];
+    memset(text, 'x', sizeof(text));
+
+    TEST_ASSERT_EQUAL(sizeof(typer_buf), typer_write(&typer, text, sizeof(text)));
+    TEST_ASSERT_EQUAL(sizeof(text) - sizeof(typer_buf), typer.overflow);
+    TEST_ASSERT_EQUAL(0, typer_free(&typer));
+}
+
+void test_free_space(void)
+{
+    TEST_ASSERT_EQUAL(sizeof(typer_buf), typer_free(&typer));
+    typer_write(&typer, "abc", 3);
+    TEST_ASSERT_EQUAL(sizeof(typer_buf) - 3, typer_free(&typer));
+}
+
+void test_clear_drops_text(void)
+{
+    uint8_t modifier, keycode;
+
+    typer_write(&typer, "abc", 3);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+
+    typer_clear(&typer);
+    TEST_ASSERT_FALSE(typer_busy(&typer));
+    TEST_ASSERT_FALSE(typer_next(&typer, &modifier, &keycode));
+}
+
+void test_caps_lock_inverts_shift_on_letters(void)
+{
+    char const *text = "aB!";
+    uint8_t const expected[] = {KEYBOARD_MODIFIER_LEFTSHIFT, 0, KEYBOARD_MODIFIER_LEFTSHIFT};
+    uint8_t modifier, keycode;
+
+    typer_set_caps_lock(&typer, true);
+    typer_write(&typer, text, (uint16_t)strlen(text));
+
+    for (uint8_t i = 0; i < sizeof(expected); i++)
+    {
+        TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+        TEST_ASSERT_EQUAL_HEX8(expected[i], modifier);
+    }
+}
+
+void test_caps_lock_applies_from_next_character(void)
+{
+    uint8_t modifier, keycode;
+
+    typer_write(&typer, "ab", 2);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(0, modifier);
+
+    typer_set_caps_lock(&typer, true);
+    TEST_ASSERT_TRUE(typer_next(&typer, &modifier, &keycode));
+    TEST_ASSERT_EQUAL_HEX8(KEYBOARD_MODIFIER_LEFTSHIFT, modifier);
+}
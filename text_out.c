@@ -0,0 +1,49 @@
+#include "text_out.h"
+
+static void text_out_char(text_out_t *t, char c)
+{
+    if (t->len + 1 < t->size)
+    {
+        t->buf[t->len++] = c;
+        t->buf[t->len] = '\0';
+    }
+}
+
+void text_out_init(text_out_t *t, char *buf, uint16_t size)
+{
+    t->buf = buf;
+    t->size = size;
+    t->len = 0;
+    buf[0] = '\0';
+}
+
+void text_out_str(text_out_t *t, char const *s)
+{
+    while (*s)
+    {
+        text_out_char(t, *s++);
+    }
+}
+
+void text_out_u32(text_out_t *t, uint32_t value)
+{
+    char digits[10]; // UINT32_MAX has 10
+    uint8_t n = 0;
+
+    do
+    {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    while (n)
+    {
+        text_out_char(t, digits[--n]);
+    }
+}
+
+void text_out_field(text_out_t *t, char const *name, uint32_t value)
+{
+    text_out_str(t, name);
+    text_out_u32(t, value);
+}
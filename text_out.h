@@ -0,0 +1,36 @@
+#ifndef _TEXT_OUT_H_
+#define _TEXT_OUT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Builds a UART reply line in a caller's buffer without stdio: replaces
+    // snprintf for the few formats the firmware prints (text and unsigned
+    // decimal). Output that does not fit is cut off, the buffer is always
+    // NUL terminated.
+    typedef struct
+    {
+        char *buf;
+        uint16_t size;
+        uint16_t len; // characters written, excluding the NUL
+    } text_out_t;
+
+    // size must be at least 1
+    void text_out_init(text_out_t *t, char *buf, uint16_t size);
+
+    void text_out_str(text_out_t *t, char const *s);
+
+    void text_out_u32(text_out_t *t, uint32_t value);
+
+    // name then value, e.g. text_out_field(t, ",sent=", q->sent)
+    void text_out_field(text_out_t *t, char const *name, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TEXT_OUT_H_ */
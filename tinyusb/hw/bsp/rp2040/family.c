@@ -155,7 +155,13 @@ void board_init(void)
 #ifdef UART_DEV
   bi_decl(bi_2pins_with_func(UART_TX_PIN, UART_RX_PIN, GPIO_FUNC_UART));
   uart_inst = uart_get_instance(UART_DEV);
+  #if LIB_PICO_STDIO_UART
   stdio_uart_init_full(uart_inst, CFG_BOARD_UART_BAUDRATE, UART_TX_PIN, UART_RX_PIN);
+  #else
+  uart_init(uart_inst, CFG_BOARD_UART_BAUDRATE);
+  gpio_set_function(UART_TX_PIN, GPIO_FUNC_UART);
+  gpio_set_function(UART_RX_PIN, GPIO_FUNC_UART);
+  #endif
 #endif
 
 #if defined(LOGGER_RTT)
@@ -50,7 +50,20 @@ typedef struct
   uint8_t idle_rate;     // up to application to handle idle rate
   uint16_t report_desc_len;
 
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_HID_EP_BUFSIZE];
+  // IN reports are double buffered: while epin_buf[epin_idx] is on the bus the
+  // next report is staged in the other buffer and started from hidd_xfer_cb()
+  uint8_t epin_idx;       // buffer of the current (or last) IN transfer
+  uint8_t staged_offset;  // 1 if the staged report has a report ID in its first byte
+  uint16_t staged_len;    // capacity the application asked for in tud_hid_n_report_stage()
+  bool staging;           // the application is filling in the spare buffer
+  bool staged_claimed;    // endpoint was idle and claimed when staging started
+  bool pending;           // spare buffer holds a committed report waiting for the endpoint
+  uint16_t pending_len;   // its length including report ID
+  uint16_t epin_len;      // length of the report in epin_buf[epin_idx], repeated for SET_IDLE
+
+  uint32_t idle_frame;    // frame the last report went out, SET_IDLE repeats count from here
+
+  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[2][CFG_TUD_HID_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_HID_EP_BUFSIZE];
 
   // TODO save hid descriptor since host can specifically request this after enumeration
@@ -60,49 +73,149 @@ typedef struct
 
 CFG_TUD_MEM_SECTION tu_static hidd_interface_t _hidd_itf[CFG_TUD_HID];
 
+// GET_REPORT data stage, shared by all instances since EP0 serves one request
+// at a time. Apart from the IN buffers so a control read never touches a
+// report that is on the bus or being staged
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t _hidd_ctrl_buf[CFG_TUD_HID_EP_BUFSIZE];
+
+// Instance + 1 by endpoint (number, direction) and by interface number, 0 if
+// not ours. Filled in hidd_open() so transfers and requests find their
+// instance in constant time whatever CFG_TUD_HID is.
+tu_static uint8_t _hidd_ep2idx[TUP_DCD_ENDPOINT_MAX][2];
+tu_static uint8_t _hidd_itf2idx[CFG_TUD_INTERFACE_MAX];
+
+// Frames counted on every SOF while the SOF interrupt is on for any consumer
+// (usbd_sof_enable()), not only for the idle rate: it stalls while SOF is off,
+// so only differences taken while an instance has a non-zero idle rate count
+tu_static volatile uint32_t _hidd_frame;
+tu_static volatile bool _hidd_idle_deferred; // hidd_idle_task() is queued
+tu_static bool _hidd_sof_enabled;
+
+// Reports of a boot mouse are relative motion, not state: repeating the last
+// one would move the pointer again. SET_IDLE on it only sets what GET_IDLE
+// returns, as the HID spec's recommended idle rate of 0 for mice implies
+static inline bool idle_repeats(hidd_interface_t const *p_hid)
+{
+  return p_hid->idle_rate && p_hid->itf_protocol != HID_ITF_PROTOCOL_MOUSE;
+}
+
 /*------------- Helpers -------------*/
 static inline uint8_t get_index_by_itfnum(uint8_t itf_num)
 {
-  for (uint8_t i = 0; i < CFG_TUD_HID; i++)
-  {
-    if (itf_num == _hidd_itf[i].itf_num)
-      return i;
-  }
+  if (itf_num >= CFG_TUD_INTERFACE_MAX || _hidd_itf2idx[itf_num] == 0)
+    return 0xFF;
 
-  return 0xFF;
+  return _hidd_itf2idx[itf_num] - 1;
+}
+
+static inline uint8_t get_index_by_ep(uint8_t ep_addr)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum >= TUP_DCD_ENDPOINT_MAX || _hidd_ep2idx[epnum][tu_edpt_dir(ep_addr)] == 0)
+    return 0xFF;
+
+  return _hidd_ep2idx[epnum][tu_edpt_dir(ep_addr)] - 1;
 }
 
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
+// Start the report in the spare buffer, the endpoint must be claimed
+static bool start_spare(uint8_t rhport, hidd_interface_t *p_hid, uint16_t len)
+{
+  p_hid->epin_idx ^= 1;
+  p_hid->epin_len = len;
+  p_hid->idle_frame = _hidd_frame;
+  return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf[p_hid->epin_idx], len);
+}
+
 bool tud_hid_n_ready(uint8_t instance)
 {
   uint8_t const rhport = 0;
-  uint8_t const ep_in = _hidd_itf[instance].ep_in;
-  return tud_ready() && (ep_in != 0) && !usbd_edpt_busy(rhport, ep_in);
+  hidd_interface_t const *p_hid = &_hidd_itf[instance];
+  uint8_t const ep_in = p_hid->ep_in;
+
+  // Either the endpoint is idle or the spare buffer can take the next report
+  return tud_ready() && (ep_in != 0) && !p_hid->staging &&
+         (!usbd_edpt_busy(rhport, ep_in) || !p_hid->pending);
 }
 
-bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len)
+{
+  uint8_t const rhport = 0;
+  hidd_interface_t *p_hid = &_hidd_itf[instance];
+  uint8_t const offset = report_id ? 1 : 0;
+
+  TU_VERIFY(len <= CFG_TUD_HID_EP_BUFSIZE - offset, NULL);
+  TU_VERIFY(tud_ready() && p_hid->ep_in && !p_hid->staging, NULL);
+
+  // claim endpoint if idle, otherwise stage behind the transfer on the bus
+  p_hid->staged_claimed = usbd_edpt_claim(rhport, p_hid->ep_in);
+  TU_VERIFY(p_hid->staged_claimed || !p_hid->pending, NULL);
+
+  uint8_t *buf = p_hid->epin_buf[p_hid->epin_idx ^ 1];
+  buf[0] = report_id;
+  p_hid->staged_offset = offset;
+  p_hid->staged_len = len;
+  p_hid->staging = true;
+
+  return buf + offset;
+}
+
+bool tud_hid_n_report_commit(uint8_t instance, uint16_t len)
 {
   uint8_t const rhport = 0;
   hidd_interface_t *p_hid = &_hidd_itf[instance];
 
-  // claim endpoint
-  TU_VERIFY(usbd_edpt_claim(rhport, p_hid->ep_in));
+  TU_VERIFY(p_hid->staging);
 
-  // prepare data
-  if (report_id)
+  if (len > p_hid->staged_len)
   {
-    p_hid->epin_buf[0] = report_id;
-    TU_VERIFY(0 == tu_memcpy_s(p_hid->epin_buf + 1, CFG_TUD_HID_EP_BUFSIZE - 1, report, len));
-    len++;
+    tud_hid_n_report_cancel(instance);
+    return false;
   }
-  else
+
+  p_hid->staging = false;
+
+  if (tud_hid_report_commit_cb)
   {
-    TU_VERIFY(0 == tu_memcpy_s(p_hid->epin_buf, CFG_TUD_HID_EP_BUFSIZE, report, len));
+    uint8_t const *buf = p_hid->epin_buf[p_hid->epin_idx ^ 1];
+    tud_hid_report_commit_cb(instance, p_hid->staged_offset ? buf[0] : 0, buf + p_hid->staged_offset, len);
   }
 
-  return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
+  len = (uint16_t) (len + p_hid->staged_offset);
+
+  // The transfer on the bus may have finished meanwhile
+  if (p_hid->staged_claimed || usbd_edpt_claim(rhport, p_hid->ep_in))
+  {
+    return start_spare(rhport, p_hid, len);
+  }
+
+  // hidd_xfer_cb() starts it once the current transfer is done
+  p_hid->pending = true;
+  p_hid->pending_len = len;
+  return true;
+}
+
+void tud_hid_n_report_cancel(uint8_t instance)
+{
+  uint8_t const rhport = 0;
+  hidd_interface_t *p_hid = &_hidd_itf[instance];
+
+  if (p_hid->staging && p_hid->staged_claimed)
+  {
+    usbd_edpt_release(rhport, p_hid->ep_in);
+  }
+  p_hid->staging = false;
+}
+
+bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+{
+  uint8_t *buf = (uint8_t *) tud_hid_n_report_stage(instance, report_id, len);
+  TU_VERIFY(buf);
+
+  if (len) memcpy(buf, report, len);
+  return tud_hid_n_report_commit(instance, len);
 }
 
 uint8_t tud_hid_n_interface_protocol(uint8_t instance)
@@ -117,53 +230,65 @@ uint8_t tud_hid_n_get_protocol(uint8_t instance)
 
 bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modifier, uint8_t keycode[6])
 {
-  hid_keyboard_report_t report;
+  hid_keyboard_report_t *report = (hid_keyboard_report_t *) tud_hid_n_report_stage(instance, report_id, sizeof(hid_keyboard_report_t));
+  TU_VERIFY(report);
 
-  report.modifier = modifier;
-  report.reserved = 0;
+  report->modifier = modifier;
+  report->reserved = 0;
 
   if (keycode)
   {
-    memcpy(report.keycode, keycode, sizeof(report.keycode));
+    memcpy(report->keycode, keycode, sizeof(report->keycode));
   }
   else
   {
-    tu_memclr(report.keycode, 6);
+    tu_memclr(report->keycode, 6);
   }
 
-  return tud_hid_n_report(instance, report_id, &report, sizeof(report));
+  return tud_hid_n_report_commit(instance, sizeof(hid_keyboard_report_t));
 }
 
 bool tud_hid_n_mouse_report(uint8_t instance, uint8_t report_id,
                             uint8_t buttons, int16_t x, int16_t y, int8_t vertical, int8_t horizontal)
 {
-  hid_mouse_report_t report =
-      {
-          .buttons = buttons,
-          .x = x,
-          .y = y,
-          .wheel = vertical,
-          .pan = horizontal};
+  hid_mouse_report_t *report = (hid_mouse_report_t *) tud_hid_n_report_stage(instance, report_id, sizeof(hid_mouse_report_t));
+  TU_VERIFY(report);
+
+  report->buttons = buttons;
+  report->x = x;
+  report->y = y;
+  report->wheel = vertical;
+  report->pan = horizontal;
 
-  return tud_hid_n_report(instance, report_id, &report, sizeof(report));
+  return tud_hid_n_report_commit(instance, sizeof(hid_mouse_report_t));
 }
 
 bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id,
                               int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons)
 {
-  hid_gamepad_report_t report =
-      {
-          .x = x,
-          .y = y,
-          .z = z,
-          .rz = rz,
-          .rx = rx,
-          .ry = ry,
-          .hat = hat,
-          .buttons = buttons,
-      };
-
-  return tud_hid_n_report(instance, report_id, &report, sizeof(report));
+  hid_gamepad_report_t *report = (hid_gamepad_report_t *) tud_hid_n_report_stage(instance, report_id, sizeof(hid_gamepad_report_t));
+  TU_VERIFY(report);
+
+  report->x = x;
+  report->y = y;
+  report->z = z;
+  report->rz = rz;
+  report->rx = rx;
+  report->ry = ry;
+  report->hat = hat;
+  report->buttons = buttons;
+
+  return tud_hid_n_report_commit(instance, sizeof(hid_gamepad_report_t));
+}
+
+bool tud_hid_n_consumer_report(uint8_t instance, uint8_t report_id, uint16_t usage)
+{
+  uint8_t *report = (uint8_t *) tud_hid_n_report_stage(instance, report_id, sizeof(usage));
+  TU_VERIFY(report);
+
+  tu_unaligned_write16(report, tu_htole16(usage));
+
+  return tud_hid_n_report_commit(instance, sizeof(usage));
 }
 
 //--------------------------------------------------------------------+
@@ -176,8 +301,16 @@ void hidd_init(void)
 
 void hidd_reset(uint8_t rhport)
 {
-  (void)rhport;
+  if (_hidd_sof_enabled)
+  {
+    usbd_sof_enable(rhport, SOF_CONSUMER_HID, false);
+    _hidd_sof_enabled = false;
+  }
+  _hidd_idle_deferred = false;
+
   tu_memclr(_hidd_itf, sizeof(_hidd_itf));
+  tu_memclr(_hidd_ep2idx, sizeof(_hidd_ep2idx));
+  tu_memclr(_hidd_itf2idx, sizeof(_hidd_itf2idx));
 }
 
 uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len)
@@ -202,6 +335,7 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16
     }
   }
   TU_ASSERT(p_hid, 0);
+  TU_ASSERT(desc_itf->bInterfaceNumber < CFG_TUD_INTERFACE_MAX, 0);
 
   uint8_t const *p_desc = (uint8_t const *)desc_itf;
 
@@ -220,6 +354,12 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16
   p_hid->protocol_mode = HID_PROTOCOL_REPORT; // Per Specs: default is report mode
   p_hid->itf_num = desc_itf->bInterfaceNumber;
 
+  // usbd only opens endpoints below TUP_DCD_ENDPOINT_MAX
+  _hidd_itf2idx[p_hid->itf_num] = (uint8_t)(hid_id + 1);
+  _hidd_ep2idx[tu_edpt_number(p_hid->ep_in)][TUSB_DIR_IN] = (uint8_t)(hid_id + 1);
+  if (p_hid->ep_out)
+    _hidd_ep2idx[tu_edpt_number(p_hid->ep_out)][TUSB_DIR_OUT] = (uint8_t)(hid_id + 1);
+
   // Use offsetof to avoid pointer to the odd/misaligned address
   p_hid->report_desc_len = tu_unaligned_read16((uint8_t const *)p_hid->hid_descriptor + offsetof(tusb_hid_descriptor_hid_t, wReportLength));
 
@@ -283,7 +423,7 @@ bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
         uint8_t const report_type = tu_u16_high(request->wValue);
         uint8_t const report_id = tu_u16_low(request->wValue);
 
-        uint8_t *report_buf = p_hid->epin_buf;
+        uint8_t *report_buf = _hidd_ctrl_buf;
         uint16_t req_len = tu_min16(request->wLength, CFG_TUD_HID_EP_BUFSIZE);
 
         uint16_t xferlen = 0;
@@ -300,7 +440,7 @@ bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
         xferlen += tud_hid_get_report_cb(hid_itf, report_id, (hid_report_type_t)report_type, report_buf, req_len);
         TU_ASSERT(xferlen > 0);
 
-        tud_control_xfer(rhport, request, p_hid->epin_buf, xferlen);
+        tud_control_xfer(rhport, request, _hidd_ctrl_buf, xferlen);
       }
       break;
 
@@ -333,12 +473,25 @@ bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       if (stage == CONTROL_STAGE_SETUP)
       {
         p_hid->idle_rate = tu_u16_high(request->wValue);
+        p_hid->idle_frame = _hidd_frame;
         if (tud_hid_set_idle_cb)
         {
           // stall request if callback return false
           TU_VERIFY(tud_hid_set_idle_cb(hid_itf, p_hid->idle_rate));
         }
 
+        // The frame clock only runs while some instance repeats its reports
+        bool idle_repeat = false;
+        for (uint8_t i = 0; i < CFG_TUD_HID; i++)
+        {
+          idle_repeat |= idle_repeats(&_hidd_itf[i]);
+        }
+        if (idle_repeat != _hidd_sof_enabled)
+        {
+          usbd_sof_enable(rhport, SOF_CONSUMER_HID, idle_repeat);
+          _hidd_sof_enabled = idle_repeat;
+        }
+
         tud_control_status(rhport, request);
       }
       break;
@@ -346,7 +499,6 @@ bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
     case HID_REQ_CONTROL_GET_IDLE:
       if (stage == CONTROL_STAGE_SETUP)
       {
-        // TODO idle rate of report
         tud_control_xfer(rhport, request, &p_hid->idle_rate, 1);
       }
       break;
@@ -389,24 +541,29 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 {
   (void)result;
 
-  uint8_t instance = 0;
-  hidd_interface_t *p_hid = _hidd_itf;
-
-  // Identify which interface to use
-  for (instance = 0; instance < CFG_TUD_HID; instance++)
-  {
-    p_hid = &_hidd_itf[instance];
-    if ((ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in))
-      break;
-  }
+  uint8_t const instance = get_index_by_ep(ep_addr);
   TU_ASSERT(instance < CFG_TUD_HID);
 
+  hidd_interface_t *p_hid = &_hidd_itf[instance];
+
   // Sent report successfully
   if (ep_addr == p_hid->ep_in)
   {
+    uint8_t const *report = p_hid->epin_buf[p_hid->epin_idx];
+
+    // Start the staged report first, the spare buffer is free again for the callback
+    if (p_hid->pending)
+    {
+      p_hid->pending = false;
+      if (usbd_edpt_claim(rhport, p_hid->ep_in))
+      {
+        start_spare(rhport, p_hid, p_hid->pending_len);
+      }
+    }
+
     if (tud_hid_report_complete_cb)
     {
-      tud_hid_report_complete_cb(instance, p_hid->epin_buf, (uint16_t)xferred_bytes);
+      tud_hid_report_complete_cb(instance, report, (uint16_t)xferred_bytes);
     }
   }
   // Received report
@@ -419,4 +576,57 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 }
 
+// An instance is due when its last report is older than its idle rate (4 ms units)
+static inline bool idle_due(hidd_interface_t const *p_hid)
+{
+  return idle_repeats(p_hid) && p_hid->epin_len && (_hidd_frame - p_hid->idle_frame >= 4u * p_hid->idle_rate);
+}
+
+// Send the last report again on every instance whose idle period ran out
+static void hidd_idle_task(void *param)
+{
+  (void)param;
+  uint8_t const rhport = 0;
+
+  _hidd_idle_deferred = false;
+
+  for (uint8_t instance = 0; instance < CFG_TUD_HID; instance++)
+  {
+    hidd_interface_t *p_hid = &_hidd_itf[instance];
+
+    // A report being staged or waiting goes out soon and restarts the period
+    if (!idle_due(p_hid) || p_hid->staging || p_hid->pending || !tud_ready())
+      continue;
+
+    // Busy: a report started meanwhile
+    if (!usbd_edpt_claim(rhport, p_hid->ep_in))
+      continue;
+
+    p_hid->idle_frame = _hidd_frame;
+    usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf[p_hid->epin_idx], p_hid->epin_len);
+  }
+}
+
+// SOF in ISR context: advance the frame clock and hand due repeats to tud_task()
+void hidd_sof_isr(uint8_t rhport, uint32_t frame_count)
+{
+  (void)rhport;
+  (void)frame_count;
+
+  _hidd_frame++;
+
+  if (_hidd_idle_deferred)
+    return;
+
+  for (uint8_t instance = 0; instance < CFG_TUD_HID; instance++)
+  {
+    if (idle_due(&_hidd_itf[instance]))
+    {
+      _hidd_idle_deferred = true;
+      usbd_defer_func(hidd_idle_task, NULL, true);
+      return;
+    }
+  }
+}
+
 #endif
@@ -53,7 +53,9 @@ extern "C"
   // CFG_TUD_HID > 1
   //--------------------------------------------------------------------+
 
-  // Check if the interface is ready to use
+  // Check if the interface is ready to use, i.e. can take a report. IN reports are
+  // double buffered: one report can be staged while the previous one is on the bus,
+  // the driver starts it as soon as that transfer completes
   bool tud_hid_n_ready(uint8_t instance);
 
   // Get interface supported protocol (bInterfaceProtocol) check out hid_interface_protocol_enum_t for possible values
@@ -65,6 +67,18 @@ extern "C"
   // Send report to host
   bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len);
 
+  // Zero-copy send: claim the endpoint and return its IN buffer (after the report ID,
+  // if any) for a report of up to len bytes, or NULL if the endpoint is busy or len is
+  // too large. Fill the report in place, then start the transfer with
+  // tud_hid_n_report_commit() or give the endpoint back with tud_hid_n_report_cancel()
+  void *tud_hid_n_report_stage(uint8_t instance, uint8_t report_id, uint16_t len);
+
+  // Send the staged report, len must not exceed the length it was staged with
+  bool tud_hid_n_report_commit(uint8_t instance, uint16_t len);
+
+  // Release the endpoint claimed by tud_hid_n_report_stage() without sending
+  void tud_hid_n_report_cancel(uint8_t instance);
+
   // KEYBOARD: convenient helper to send keyboard report if application
   // use template layout report as defined by hid_keyboard_report_t
   bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modifier, uint8_t keycode[6]);
@@ -77,6 +91,10 @@ extern "C"
   // use template layout report TUD_HID_REPORT_DESC_GAMEPAD
   bool tud_hid_n_gamepad_report(uint8_t instance, uint8_t report_id, int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons);
 
+  // CONSUMER: convenient helper to send consumer control report if application
+  // use template layout report TUD_HID_REPORT_DESC_CONSUMER (one 16-bit usage)
+  bool tud_hid_n_consumer_report(uint8_t instance, uint8_t report_id, uint16_t usage);
+
   //--------------------------------------------------------------------+
   // Application API (Single Port)
   //--------------------------------------------------------------------+
@@ -84,9 +102,13 @@ extern "C"
   static inline uint8_t tud_hid_interface_protocol(void);
   static inline uint8_t tud_hid_get_protocol(void);
   static inline bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len);
+  static inline void *tud_hid_report_stage(uint8_t report_id, uint16_t len);
+  static inline bool tud_hid_report_commit(uint16_t len);
+  static inline void tud_hid_report_cancel(void);
   static inline bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, uint8_t keycode[6]);
   static inline bool tud_hid_mouse_report(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
   static inline bool tud_hid_gamepad_report(uint8_t report_id, int8_t x, int8_t y, int8_t z, int8_t rz, int8_t rx, int8_t ry, uint8_t hat, uint32_t buttons);
+  static inline bool tud_hid_consumer_report(uint8_t report_id, uint16_t usage);
 
   //--------------------------------------------------------------------+
   // Callbacks (Weak is optional)
@@ -112,13 +134,21 @@ extern "C"
   // Invoked when received SET_IDLE request. return false will stall the request
   // - Idle Rate = 0 : only send report if there is changes, i.e skip duplication
   // - Idle Rate > 0 : skip duplication, but send at least 1 report every idle rate (in unit of 4 ms).
+  // The driver repeats the last report itself when nothing was sent for the idle
+  // rate, counted on the SOF frame clock. The rate applies to every report ID
   TU_ATTR_WEAK bool tud_hid_set_idle_cb(uint8_t instance, uint8_t idle_rate);
 
   // Invoked when sent REPORT successfully to host
   // Application can use this to send the next report
   // Note: For composite reports, report[0] is report ID
+  // Note: report is only valid until the next report is staged
   TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
 
+  // Invoked when a report is committed for sending, before it goes on the bus.
+  // Application can keep a copy to answer GET_REPORT with the current state
+  // Note: report excludes the report ID and is only valid during the callback
+  TU_ATTR_WEAK void tud_hid_report_commit_cb(uint8_t instance, uint8_t report_id, uint8_t const *report, uint16_t len);
+
   //--------------------------------------------------------------------+
   // Inline Functions
   //--------------------------------------------------------------------+
@@ -142,6 +172,21 @@ extern "C"
     return tud_hid_n_report(0, report_id, report, len);
   }
 
+  static inline void *tud_hid_report_stage(uint8_t report_id, uint16_t len)
+  {
+    return tud_hid_n_report_stage(0, report_id, len);
+  }
+
+  static inline bool tud_hid_report_commit(uint16_t len)
+  {
+    return tud_hid_n_report_commit(0, len);
+  }
+
+  static inline void tud_hid_report_cancel(void)
+  {
+    tud_hid_n_report_cancel(0);
+  }
+
   static inline bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, uint8_t keycode[6])
   {
     return tud_hid_n_keyboard_report(0, report_id, modifier, keycode);
@@ -157,6 +202,11 @@ extern "C"
     return tud_hid_n_gamepad_report(0, report_id, x, y, z, rz, rx, ry, hat, buttons);
   }
 
+  static inline bool tud_hid_consumer_report(uint8_t report_id, uint16_t usage)
+  {
+    return tud_hid_n_consumer_report(0, report_id, usage);
+  }
+
 /* --------------------------------------------------------------------+
  * HID Report Descriptor Template
  *
@@ -211,6 +261,44 @@ extern "C"
       HID_INPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE),                                                            \
       HID_COLLECTION_END
 
+// N-Key Rollover Keyboard Report Descriptor Template
+// Same modifier, reserved and LED fields as the boot keyboard, then one bit per
+// usage 0 .. _key_count-1 instead of the 6 byte keycode array
+#define TUD_HID_REPORT_DESC_KEYBOARD_NKRO(_key_count, ...)                                                       \
+  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                                        \
+      HID_USAGE(HID_USAGE_DESKTOP_KEYBOARD),                                                                     \
+      HID_COLLECTION(HID_COLLECTION_APPLICATION), /* Report ID if any */                                         \
+      __VA_ARGS__                                 /* 8 bits Modifier Keys (Shift, Control, Alt) */               \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_KEYBOARD),                                                                   \
+      HID_USAGE_MIN(224),                                                                                        \
+      HID_USAGE_MAX(231),                                                                                        \
+      HID_LOGICAL_MIN(0),                                                                                        \
+      HID_LOGICAL_MAX(1),                                                                                        \
+      HID_REPORT_COUNT(8),                                                                                       \
+      HID_REPORT_SIZE(1),                                                                                        \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* 8 bit reserved */                                    \
+      HID_REPORT_COUNT(1),                                                                                       \
+      HID_REPORT_SIZE(8),                                                                                        \
+      HID_INPUT(HID_CONSTANT), /* Output 5-bit LED Indicator Kana | Compose | ScrollLock | CapsLock | NumLock */ \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_LED),                                                                        \
+      HID_USAGE_MIN(1),                                                                                          \
+      HID_USAGE_MAX(5),                                                                                          \
+      HID_REPORT_COUNT(5),                                                                                       \
+      HID_REPORT_SIZE(1),                                                                                        \
+      HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* led padding */                                      \
+      HID_REPORT_COUNT(1),                                                                                       \
+      HID_REPORT_SIZE(3),                                                                                        \
+      HID_OUTPUT(HID_CONSTANT), /* Key bitmap, one bit per usage */                                              \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_KEYBOARD),                                                                   \
+      HID_USAGE_MIN(0),                                                                                          \
+      HID_USAGE_MAX_N((_key_count) - 1, 2),                                                                      \
+      HID_LOGICAL_MIN(0),                                                                                        \
+      HID_LOGICAL_MAX(1),                                                                                        \
+      HID_REPORT_COUNT_N(_key_count, 2),                                                                         \
+      HID_REPORT_SIZE(1),                                                                                        \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),                                                         \
+      HID_COLLECTION_END
+
 // Mouse Report Descriptor Template
 #define TUD_HID_REPORT_DESC_MOUSE(...)                                                          \
   HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                       \
@@ -254,6 +342,50 @@ extern "C"
       HID_COLLECTION_END,                                                                       \
       HID_COLLECTION_END
 
+// Relative Mouse Report Descriptor Template, same layout as hid_mouse_report_t
+// with X, Y as int16 deltas
+#define TUD_HID_REPORT_DESC_MOUSE_RELATIVE(...)                                                 \
+  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                       \
+      HID_USAGE(HID_USAGE_DESKTOP_MOUSE),                                                       \
+      HID_COLLECTION(HID_COLLECTION_APPLICATION), /* Report ID if any */                        \
+      __VA_ARGS__                                                                               \
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),                                                     \
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),                                                  \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),                                                    \
+      HID_USAGE_MIN(1),                                                                         \
+      HID_USAGE_MAX(5),                                                                         \
+      HID_LOGICAL_MIN(0),                                                                       \
+      HID_LOGICAL_MAX(1), /* Left, Right, Middle, Backward, Forward buttons */                  \
+      HID_REPORT_COUNT(5),                                                                      \
+      HID_REPORT_SIZE(1),                                                                       \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* 3 bit padding */                    \
+      HID_REPORT_COUNT(1),                                                                      \
+      HID_REPORT_SIZE(3),                                                                       \
+      HID_INPUT(HID_CONSTANT),                                                                  \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), /* X, Y delta [-32767, 32767] */                  \
+      HID_USAGE(HID_USAGE_DESKTOP_X),                                                           \
+      HID_USAGE(HID_USAGE_DESKTOP_Y),                                                           \
+      HID_LOGICAL_MIN_N(0x8001, 2),                                                             \
+      HID_LOGICAL_MAX_N(0x7fff, 2),                                                             \
+      HID_REPORT_COUNT(2),                                                                      \
+      HID_REPORT_SIZE(16),                                                                      \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE), /* Verital wheel scroll [-127, 127] */ \
+      HID_USAGE(HID_USAGE_DESKTOP_WHEEL),                                                       \
+      HID_LOGICAL_MIN(0x81),                                                                    \
+      HID_LOGICAL_MAX(0x7f),                                                                    \
+      HID_REPORT_COUNT(1),                                                                      \
+      HID_REPORT_SIZE(8),                                                                       \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),                                        \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER), /* Horizontal wheel scroll [-127, 127] */        \
+      HID_USAGE_N(HID_USAGE_CONSUMER_AC_PAN, 2),                                                \
+      HID_LOGICAL_MIN(0x81),                                                                    \
+      HID_LOGICAL_MAX(0x7f),                                                                    \
+      HID_REPORT_COUNT(1),                                                                      \
+      HID_REPORT_SIZE(8),                                                                       \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),                                        \
+      HID_COLLECTION_END,                                                                       \
+      HID_COLLECTION_END
+
 // Consumer Control Report Descriptor Template
 #define TUD_HID_REPORT_DESC_CONSUMER(...)                                \
   HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER),                               \
@@ -384,6 +516,7 @@ extern "C"
   uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len);
   bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request);
   bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+  void hidd_sof_isr(uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
 }
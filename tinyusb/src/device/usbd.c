@@ -81,6 +81,10 @@ typedef struct {
 
 tu_static usbd_device_t _usbd_dev;
 
+// SOF consumers (sof_consumer_t bits), kept across configuration resets:
+// class drivers drop theirs in their reset(), the application its own
+tu_static volatile uint8_t _usbd_sof_consumer;
+
 //--------------------------------------------------------------------+
 // Class Driver
 //--------------------------------------------------------------------+
@@ -124,7 +128,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
       .open             = hidd_open,
       .control_xfer_cb  = hidd_control_xfer_cb,
       .xfer_cb          = hidd_xfer_cb,
-      .sof              = NULL
+      .sof              = hidd_sof_isr
     },
     #endif
 
@@ -1118,6 +1122,13 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
         }
       }
 
+      // Application handler in ISR context as well: queueing every frame
+      // would fill the usbd queue whenever tud_task() is held up for longer
+      // than its depth in frames, losing SETUPs and bus events
+      if (tu_bit_test(_usbd_sof_consumer, SOF_CONSUMER_USER) && tud_sof_isr) {
+        tud_sof_isr(event->sof.frame_count);
+      }
+
       // skip osal queue for SOF in usbd task
       break;
 
@@ -1367,13 +1378,23 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   return;
 }
 
-void usbd_sof_enable(uint8_t rhport, bool en)
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en)
 {
   rhport = _usbd_rhport;
 
-  // TODO: Check needed if all drivers including the user sof_cb does not need an active SOF ISR any more.
-  // Only if all drivers switched off SOF calls the SOF interrupt may be disabled
-  dcd_sof_enable(rhport, en);
+  uint8_t const consumers = (uint8_t) (en ? tu_bit_set(_usbd_sof_consumer, consumer)
+                                          : tu_bit_clear(_usbd_sof_consumer, consumer));
+  if (consumers == _usbd_sof_consumer) return;
+
+  // The interrupt is on while any consumer needs it
+  bool const was_enabled = _usbd_sof_consumer != 0;
+  _usbd_sof_consumer = consumers;
+  if (was_enabled != (consumers != 0)) dcd_sof_enable(rhport, consumers != 0);
+}
+
+void tud_sof_isr_enable(bool en)
+{
+  usbd_sof_enable(_usbd_rhport, SOF_CONSUMER_USER, en);
 }
 
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size)
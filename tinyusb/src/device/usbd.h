@@ -146,6 +146,13 @@ TU_ATTR_WEAK void tud_suspend_cb(bool remote_wakeup_en);
 // Invoked when usb bus is resumed
 TU_ATTR_WEAK void tud_resume_cb(void);
 
+// Enable/Disable tud_sof_isr(), disabled by default
+void tud_sof_isr_enable(bool en);
+
+// Invoked in ISR context for every SOF while enabled, frame_count is the
+// 11-bit frame number of the bus. Keep it short, defer work to the main loop
+TU_ATTR_WEAK void tud_sof_isr(uint32_t frame_count);
+
 // Invoked when there is a new usb event, which need to be processed by tud_task()/tud_task_ext()
 void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 
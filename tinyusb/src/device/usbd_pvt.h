@@ -109,8 +109,15 @@ bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
   return !usbd_edpt_busy(rhport, ep_addr) && !usbd_edpt_stalled(rhport, ep_addr);
 }
 
-// Enable SOF interrupt
-void usbd_sof_enable(uint8_t rhport, bool en);
+// Users of the SOF interrupt, it stays enabled while any of them needs it
+typedef enum {
+  SOF_CONSUMER_USER = 0, // tud_sof_isr()
+  SOF_CONSUMER_AUDIO,
+  SOF_CONSUMER_HID,
+} sof_consumer_t;
+
+// Enable SOF interrupt for consumer
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en);
 
 /*------------------------------------------------------------------*/
 /* Helper
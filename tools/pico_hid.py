@@ -0,0 +1,452 @@
+#!/usr/bin/env python3
+"""Host-side client for the pico_hid UART command channel.
+
+Encodes the binary command frames understood by the firmware (see
+command_frame.h) and optionally writes them to a serial port:
+
+    | '~' | opcode | len | payload | crc8 |
+
+Example:
+    python3 tools/pico_hid.py --port /dev/ttyUSB0 mouse_move 100 200
+
+With --ack the frames are sent in acknowledge mode (see command_ack.h): each
+carries a sequence number and is answered with ack or nak, and no more are in
+flight than the device grants credits for.
+
+`baud <rate>` changes the link speed with the device's two-phase handshake
+(see baud_switch.h) and `baud_save` keeps it across power cycles:
+    python3 tools/pico_hid.py --port /dev/ttyUSB0 baud 3000000
+    python3 tools/pico_hid.py --port /dev/ttyUSB0 --baud 3000000 baud_save
+
+`replay <file>` plays recorded input with its original timing, scheduled on
+the device's USB frame clock (see command_schedule.h) rather than timed by
+the host. Each line of the file is `<ms> <command> [args]`, # starts a
+comment:
+    0 mouse_move 100 200
+    16 mouse_click 1
+    250 keyboard_type Hello
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+START_CHARACTER = 0x7E  # '~'
+MAX_PAYLOAD = 32
+
+OP_MOUSE_MOVE = 0x01
+OP_MOUSE_CLICK = 0x02
+OP_MOUSE_PRESS = 0x03
+OP_MOUSE_RELEASE = 0x04
+OP_MOUSE_REL_MOVE = 0x05
+OP_MOUSE_REL_CLICK = 0x06
+OP_MOUSE_REL_PRESS = 0x07
+OP_MOUSE_REL_RELEASE = 0x08
+OP_MOUSE_PATH = 0x09
+OP_MOUSE_REL_PATH = 0x0A
+OP_KEYBOARD_KEYSTROKE = 0x10
+OP_KEYBOARD_PRESS = 0x11
+OP_KEYBOARD_RELEASE = 0x12
+OP_KEYBOARD_TYPE = 0x13
+OP_KEYBOARD_LEDS = 0x14
+OP_ACK_MODE = 0x15
+OP_BAUD = 0x16
+OP_BAUD_SAVE = 0x17
+OP_FRAME = 0x18
+OP_AT = 0x40  # flag, the payload starts with the uint32 USB frame to run at
+OP_SEQ = 0x80  # flag, the first payload byte is a sequence number
+
+BAUD_SWITCH_TIMEOUT = 1.0  # s, BAUD_SWITCH_TIMEOUT_MS on the device
+
+# Frames between reading the device's frame count and the first replayed
+# event, room for the scheduled commands to get there (1 frame = 1 ms)
+REPLAY_LEAD_FRAMES = 100
+
+MOUSE_BUTTON_LEFT = 0x01
+MOUSE_BUTTON_RIGHT = 0x02
+
+
+def crc8(data, crc=0):
+    """CRC-8 with polynomial 0x07, same as command_frame_crc8()."""
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode_frame(opcode, payload=b''):
+    payload = bytes(payload)
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError('payload too long: {} > {}'.format(len(payload), MAX_PAYLOAD))
+    body = bytes([opcode, len(payload)]) + payload
+    return bytes([START_CHARACTER]) + body + bytes([crc8(body)])
+
+
+def decode_frames(data):
+    """Split encoded frames back into (opcode, payload) pairs."""
+    frames = []
+    while data:
+        length = data[2]
+        frames.append((data[1], data[3:3 + length]))
+        data = data[4 + length:]
+    return frames
+
+
+def sequenced(frame, seq):
+    """Frame with the OP_SEQ flag and seq in front of its payload."""
+    opcode, payload = decode_frames(frame)[0]
+    return encode_frame(opcode | OP_SEQ, bytes([seq & 0xFF]) + payload)
+
+
+def mouse_move(x, y):
+    return encode_frame(OP_MOUSE_MOVE, struct.pack('<hh', x, y))
+
+
+def mouse_click(button=MOUSE_BUTTON_LEFT):
+    return encode_frame(OP_MOUSE_CLICK, [button])
+
+
+def mouse_press(button=MOUSE_BUTTON_LEFT):
+    return encode_frame(OP_MOUSE_PRESS, [button])
+
+
+def mouse_release():
+    return encode_frame(OP_MOUSE_RELEASE)
+
+
+def mouse_rel_move(dx, dy):
+    return encode_frame(OP_MOUSE_REL_MOVE, struct.pack('<hh', dx, dy))
+
+
+def mouse_rel_click(button=MOUSE_BUTTON_LEFT):
+    return encode_frame(OP_MOUSE_REL_CLICK, [button])
+
+
+def mouse_rel_press(button=MOUSE_BUTTON_LEFT):
+    return encode_frame(OP_MOUSE_REL_PRESS, [button])
+
+
+def mouse_rel_release():
+    return encode_frame(OP_MOUSE_REL_RELEASE)
+
+
+def _path_payload(points, duration_ms, easing, controls):
+    if len(controls) % 2 or len(controls) > 4:
+        raise ValueError('control points come in x y pairs, at most two')
+    return (struct.pack('<' + 'h' * len(points), *points) + struct.pack('<HB', duration_ms, easing)
+            + struct.pack('<' + 'h' * len(controls), *controls))
+
+
+def mouse_path(x0, y0, x1, y1, duration_ms, easing=0, *controls):
+    """Move from x0,y0 to x1,y1 over duration_ms, interpolated on the device.
+
+    easing: 0 linear, 1 ease in, 2 ease out, 3 ease in-out. One control point
+    makes a quadratic, two a cubic Bezier curve.
+    """
+    return encode_frame(OP_MOUSE_PATH, _path_payload((x0, y0, x1, y1), duration_ms, easing, controls))
+
+
+def mouse_rel_path(dx, dy, duration_ms, easing=0, *controls):
+    """Relative version of mouse_path, control points relative to the start."""
+    return encode_frame(OP_MOUSE_REL_PATH, _path_payload((dx, dy), duration_ms, easing, controls))
+
+
+def keyboard_keystroke(keycode):
+    return encode_frame(OP_KEYBOARD_KEYSTROKE, [keycode])
+
+
+def keyboard_press(keycode):
+    return encode_frame(OP_KEYBOARD_PRESS, [keycode])
+
+
+def keyboard_release(keycode=None):
+    return encode_frame(OP_KEYBOARD_RELEASE, [] if keycode is None else [keycode])
+
+
+def keyboard_type(text):
+    """Type text on the device, split over as many frames as needed."""
+    data = text.encode('utf-8')
+    return b''.join(encode_frame(OP_KEYBOARD_TYPE, data[i:i + MAX_PAYLOAD])
+                    for i in range(0, len(data), MAX_PAYLOAD))
+
+
+def keyboard_leds():
+    """Ask for the host's keyboard LEDs, the device answers with led,<bits>."""
+    return encode_frame(OP_KEYBOARD_LEDS)
+
+
+def ack_mode(enable=1):
+    """Turn acknowledge mode on or off, which also stops the byte echo."""
+    return encode_frame(OP_ACK_MODE, [1 if enable else 0])
+
+
+def baud(rate=None):
+    """Switch to rate, or probe it after the switch; no rate asks for the current one."""
+    return encode_frame(OP_BAUD, b'' if rate is None else struct.pack('<I', rate))
+
+
+def baud_save():
+    """Keep the current rate as the power up default, the device re-enumerates."""
+    return encode_frame(OP_BAUD_SAVE)
+
+
+def usb_frame():
+    """Ask for the device's USB frame count, answered with frame,<count>."""
+    return encode_frame(OP_FRAME)
+
+
+def at(frame_count, frames):
+    """Schedule frames to run on the device when its frame count reaches frame_count.
+
+    Payloads are split so that each piece still fits behind the frame count
+    and a sequence number; the pieces run in order on the same frame.
+    """
+    step = MAX_PAYLOAD - 5
+    prefix = struct.pack('<I', frame_count & 0xFFFFFFFF)
+    return b''.join(encode_frame(opcode | OP_AT, prefix + payload[i:i + step])
+                    for opcode, payload in decode_frames(frames)
+                    for i in range(0, max(len(payload), 1), step))
+
+
+def read_usb_frame(port):
+    """Current USB frame count of the device."""
+    port.write(usb_frame())
+    while True:
+        line = port.readline().decode('ascii', 'replace').strip()
+        if not line:
+            raise TimeoutError('no answer to frame')
+        if line.startswith('frame,'):
+            return int(line[len('frame,'):])
+
+
+def _read_baud_answer(port, rate, timeout):
+    """State word of the next baud,<rate>,<state> line, None on timeout."""
+    deadline = time.monotonic() + timeout
+    prefix = 'baud,{},'.format(rate)
+    while time.monotonic() < deadline:
+        line = port.readline().decode('ascii', 'replace').strip()
+        if line.startswith(prefix):
+            return line[len(prefix):]
+    return None
+
+
+def switch_baud(port, rate):
+    """Move device and port to rate: ask at the old rate, probe at the new one.
+
+    Without a probe the device goes back to the old rate after
+    BAUD_SWITCH_TIMEOUT, so does the port here when the probe is not answered.
+    """
+    old = port.baudrate
+    port.write(baud(rate))
+    state = _read_baud_answer(port, rate, BAUD_SWITCH_TIMEOUT)
+    if state != 'switch':
+        raise RuntimeError('device refused {} baud: {}'.format(rate, state))
+
+    # The device changes rate right after its answer left the FIFO
+    port.baudrate = rate
+    time.sleep(0.01)
+    port.reset_input_buffer()
+    port.write(baud(rate))
+    if _read_baud_answer(port, rate, BAUD_SWITCH_TIMEOUT) != 'ok':
+        port.baudrate = old
+        _read_baud_answer(port, old, BAUD_SWITCH_TIMEOUT)  # revert notice
+        raise RuntimeError('no answer at {} baud, back at {}'.format(rate, old))
+
+
+# What a command costs of the device's credits: a click or keystroke is a
+# press and a release report, text one credit per CREDIT_CHARS characters of
+# typer space, everything else one report
+REPORT_SLOTS = {OP_MOUSE_CLICK: 2, OP_MOUSE_REL_CLICK: 2, OP_KEYBOARD_KEYSTROKE: 2}
+CREDIT_CHARS = 32  # COMMAND_ACK_CREDIT_CHARS in command_ack.h
+
+
+def credit_cost(opcode, payload):
+    """Credits a frame uses up until it is answered."""
+    if opcode & OP_AT:
+        return 1  # a schedule entry until its frame comes
+    if opcode & ~OP_SEQ == OP_KEYBOARD_TYPE:
+        return max(1, -(-len(payload) // CREDIT_CHARS))
+    return REPORT_SLOTS.get(opcode & ~OP_SEQ, 1)
+
+
+class AckWindow:
+    """Pipelines frames in acknowledge mode without overrunning the device.
+
+    Every frame gets the next sequence number. send() waits for answers while
+    the frames in flight cost (credit_cost()) as many credits as the device
+    granted in its last answer; with no credits and nothing in flight it asks
+    again with ack_mode.
+    """
+
+    def __init__(self, port):
+        self.port = port
+        self.seq = 0
+        self.credits = 0
+        self.in_flight = {}  # sequence number: credits
+        self.nak = []
+        self._send(ack_mode(1))
+        self.wait()
+
+    def _send(self, frame, cost=0):
+        seq = self.seq
+        self.seq = (self.seq + 1) & 0xFF
+        self.in_flight[seq] = cost
+        self.port.write(sequenced(frame, seq))
+
+    def _read_answer(self):
+        line = self.port.readline().decode('ascii', 'replace').strip()
+        if not line:
+            raise TimeoutError('no answer for sequence numbers {}'.format(sorted(self.in_flight)))
+        kind, _, rest = line.partition(',')
+        if kind not in ('ack', 'nak'):
+            return  # other output, e.g. led,<bits>
+        seq, credits = (int(v) for v in rest.split(','))
+        self.in_flight.pop(seq, None)
+        self.credits = credits
+        if kind == 'nak':
+            self.nak.append(seq)
+
+    def send(self, frames):
+        for opcode, payload in decode_frames(frames):
+            # The sequence number takes a payload byte, text goes in smaller
+            # pieces; scheduled frames come split by at()
+            step = MAX_PAYLOAD - 1 if opcode == OP_KEYBOARD_TYPE else MAX_PAYLOAD
+            for i in range(0, max(len(payload), 1), step):
+                piece = payload[i:i + step]
+                cost = credit_cost(opcode, piece)
+                while sum(self.in_flight.values()) + cost > self.credits:
+                    if self.in_flight:
+                        self._read_answer()
+                    else:
+                        time.sleep(0.001)
+                        self._send(ack_mode(1))
+                self._send(encode_frame(opcode, piece), cost)
+
+    def wait(self):
+        """Read answers until every frame sent so far has one."""
+        while self.in_flight:
+            self._read_answer()
+
+
+def replay(port, events, lead=REPLAY_LEAD_FRAMES):
+    """Play (ms, frames) events on the device with their relative timing.
+
+    Every event is scheduled for its frame ahead of time, so host and UART
+    latency do not move it; events that still arrive after their frame run at
+    once and count as late in the device's stats. Returns the AckWindow, whose
+    nak list holds the events the device could not schedule; events that
+    failed when they ran only count as failed in the stats.
+    """
+    start = read_usb_frame(port) + lead
+    window = AckWindow(port)
+    for ms, frames in events:
+        window.send(at(start + ms, frames))
+    window.wait()
+    return window
+
+
+def read_replay(lines):
+    """(ms, frames) events of a replay file, see the module doc."""
+    events = []
+    for number, line in enumerate(lines, 1):
+        fields = line.split('#', 1)[0].split()
+        if not fields:
+            continue
+        if len(fields) < 2 or fields[1] not in COMMANDS:
+            raise ValueError('line {}: expected <ms> <command> [args]'.format(number))
+        func, argc = COMMANDS[fields[1]]
+        if argc == 'text':
+            frames = func(line.split(None, 2)[2].rstrip('\n') if len(fields) > 2 else '')
+        else:
+            frames = func(*[int(a, 0) for a in fields[2:]])
+        events.append((int(fields[0], 0), frames))
+    return events
+
+
+COMMANDS = {
+    'mouse_move': (mouse_move, 2),
+    'mouse_click': (mouse_click, 1),
+    'mouse_press': (mouse_press, 1),
+    'mouse_release': (mouse_release, 0),
+    'mouse_rel_move': (mouse_rel_move, 2),
+    'mouse_rel_click': (mouse_rel_click, 1),
+    'mouse_rel_press': (mouse_rel_press, 1),
+    'mouse_rel_release': (mouse_rel_release, 0),
+    'mouse_path': (mouse_path, None),
+    'mouse_rel_path': (mouse_rel_path, None),
+    'keyboard_keystroke': (keyboard_keystroke, 1),
+    'keyboard_press': (keyboard_press, 1),
+    'keyboard_release': (keyboard_release, None),
+    'keyboard_type': (keyboard_type, 'text'),
+    'keyboard_leds': (keyboard_leds, 0),
+    'ack_mode': (ack_mode, 1),
+    'baud': (baud, None),
+    'baud_save': (baud_save, 0),
+    'usb_frame': (usb_frame, 0),
+}
+
+# Commands the device answers with a line on the UART
+QUERIES = {'keyboard_leds', 'baud', 'baud_save', 'usb_frame'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--port', help='serial port, print the frame as hex if omitted')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--ack', action='store_true', help='send in acknowledge mode and report naks')
+    parser.add_argument('command', choices=sorted(COMMANDS) + ['replay'])
+    parser.add_argument('args', nargs='*')
+    args = parser.parse_args()
+
+    if args.command == 'replay':
+        if len(args.args) != 1 or args.port is None:
+            parser.error('replay takes a file and needs --port')
+        with open(args.args[0]) as f:
+            events = read_replay(f)
+
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            window = replay(port, events)
+        if window.nak:
+            print('nak: {}'.format(' '.join(str(seq) for seq in window.nak)))
+            return 1
+        return 0
+
+    func, argc = COMMANDS[args.command]
+    if argc == 'text':
+        frame = func(' '.join(args.args))
+    else:
+        if argc is not None and len(args.args) != argc:
+            parser.error('{} takes {} argument(s)'.format(args.command, argc))
+        frame = func(*[int(a, 0) for a in args.args])
+
+    if args.port is None:
+        print(frame.hex(' '))
+        return 0
+
+    import serial  # pyserial, only needed when talking to a device
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        if args.command == 'baud' and args.args:
+            switch_baud(port, int(args.args[0], 0))
+            print('baud,{}'.format(port.baudrate))
+            return 0
+
+        if args.ack:
+            window = AckWindow(port)
+            window.send(frame)
+            window.wait()
+            if window.nak:
+                print('nak: {}'.format(' '.join(str(seq) for seq in window.nak)))
+                return 1
+            return 0
+
+        port.write(frame)
+        if args.command in QUERIES:
+            print(port.readline().decode('ascii', 'replace').strip())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""Flash and RAM use of a firmware image, optionally against a baseline.
+
+Reads the Berkeley totals of `arm-none-eabi-size`: flash is text + data (the
+initial values of .data are copied from flash), RAM is data + bss. The
+firmware build runs this after linking (see CMakeLists.txt), --record keeps
+the numbers in a JSON file next to the image.
+
+Example, the stdio-free build against the default one:
+    python3 tools/size_report.py build_nostdio/pico_hid.elf --baseline build/pico_hid.elf
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+COLUMNS = ('text', 'data', 'bss', 'flash', 'ram')
+
+
+def image_size(size_tool, elf):
+    out = subprocess.run([size_tool, '-B', '-d', elf], check=True, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout
+    text, data, bss = (int(v) for v in out.splitlines()[1].split()[:3])
+    return {'text': text, 'data': data, 'bss': bss, 'flash': text + data, 'ram': data + bss}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--size-tool', default='arm-none-eabi-size')
+    parser.add_argument('--baseline', help='image to compare against')
+    parser.add_argument('--record', help='write the sizes of the image to this JSON file')
+    parser.add_argument('elf')
+    args = parser.parse_args()
+
+    rows = [(args.elf, image_size(args.size_tool, args.elf))]
+    if args.record:
+        with open(args.record, 'w') as f:
+            json.dump(rows[0][1], f, indent=2)
+            f.write('\n')
+
+    if args.baseline:
+        base = image_size(args.size_tool, args.baseline)
+        rows.insert(0, (args.baseline, base))
+        rows.append(('change', {k: rows[1][1][k] - base[k] for k in base}))
+
+    width = max(len(name) for name, _ in rows)
+    print('{:<{w}}'.format('', w=width) + ''.join(' {:>8}'.format(c) for c in COLUMNS))
+    for name, size in rows:
+        sign = '+' if name == 'change' else ''
+        print('{:<{w}}'.format(name, w=width) + ''.join(' {:>{s}8}'.format(size[c], s=sign) for c in COLUMNS))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
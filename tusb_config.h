@@ -93,14 +93,18 @@ extern "C"
 #endif
 
     //------------- CLASS -------------//
-#define CFG_TUD_HID 2
+// the host lookup benchmark builds the HID driver with other instance counts
+#ifndef CFG_TUD_HID
+#define CFG_TUD_HID 3
+#endif
 #define CFG_TUD_CDC 0
 #define CFG_TUD_MSC 0
 #define CFG_TUD_MIDI 0
 #define CFG_TUD_VENDOR 0
 
-    // HID buffer size Should be sufficient to hold ID (if any) + Data
-#define CFG_TUD_HID_EP_BUFSIZE 8
+    // HID buffer size Should be sufficient to hold ID (if any) + Data.
+    // The 256 key NKRO report is 34 bytes, 64 is the full speed maximum
+#define CFG_TUD_HID_EP_BUFSIZE 64
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,109 @@
+#include "typer.h"
+
+static uint8_t const ascii_to_keycode[128][2] = {HID_ASCII_TO_KEYCODE};
+
+void typer_init(typer_t *t, uint8_t *buffer, uint16_t depth)
+{
+    tu_fifo_config(&t->ff, buffer, depth, 1, false);
+    t->typed = 0;
+    t->skipped = 0;
+    t->overflow = 0;
+    t->caps_lock = false;
+    typer_clear(t);
+}
+
+void typer_clear(typer_t *t)
+{
+    tu_fifo_clear(&t->ff);
+    t->modifier = 0;
+    t->keycode = 0;
+    t->prev_char = 0;
+}
+
+uint16_t typer_write(typer_t *t, char const *text, uint16_t len)
+{
+    uint16_t const n = tu_min16(len, tu_fifo_remaining(&t->ff));
+
+    tu_fifo_write_n(&t->ff, text, n);
+    t->overflow += len - n;
+    return n;
+}
+
+void typer_set_caps_lock(typer_t *t, bool on)
+{
+    t->caps_lock = on;
+}
+
+uint16_t typer_free(typer_t *t)
+{
+    return tu_fifo_remaining(&t->ff);
+}
+
+bool typer_busy(typer_t *t)
+{
+    return t->keycode || !tu_fifo_empty(&t->ff);
+}
+
+// Release the key held by the typer
+static bool typer_release(typer_t *t, uint8_t *modifier, uint8_t *keycode)
+{
+    t->modifier = 0;
+    t->keycode = 0;
+    *modifier = 0;
+    *keycode = 0;
+    return true;
+}
+
+bool typer_next(typer_t *t, uint8_t *modifier, uint8_t *keycode)
+{
+    char c;
+
+    while (tu_fifo_peek(&t->ff, &c))
+    {
+        uint8_t const uc = (uint8_t)c;
+
+        // CR LF is a single Enter
+        bool const fold = (c == '\n' && t->prev_char == '\r');
+
+        if (uc >= 128 || ascii_to_keycode[uc][1] == 0 || fold)
+        {
+            tu_fifo_read(&t->ff, &c);
+            t->prev_char = c;
+
+            // A UTF-8 sequence counts once, at its lead byte
+            if (!fold && (uc < 0x80 || uc >= 0xC0))
+            {
+                t->skipped++;
+            }
+            continue;
+        }
+
+        uint8_t const next_keycode = ascii_to_keycode[uc][1];
+        bool const letter = (uc >= 'a' && uc <= 'z') || (uc >= 'A' && uc <= 'Z');
+        bool const shift = ascii_to_keycode[uc][0] ^ (letter && t->caps_lock);
+        uint8_t const next_modifier = shift ? KEYBOARD_MODIFIER_LEFTSHIFT : 0;
+
+        // The host only sees a new character if the key goes up first
+        if (next_keycode == t->keycode)
+        {
+            return typer_release(t, modifier, keycode);
+        }
+
+        tu_fifo_read(&t->ff, &c);
+        t->prev_char = c;
+        t->typed++;
+
+        t->modifier = next_modifier;
+        t->keycode = next_keycode;
+        *modifier = next_modifier;
+        *keycode = next_keycode;
+        return true;
+    }
+
+    if (t->keycode)
+    {
+        return typer_release(t, modifier, keycode);
+    }
+
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef _TYPER_H_
+#define _TYPER_H_
+
+#include "tusb.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Turns text into a sequence of key states, one per keyboard report.
+    // Consecutive different characters go straight from one key to the next,
+    // the same key twice in a row gets a release in between. Characters
+    // without a key in HID_ASCII_TO_KEYCODE (including every non-ASCII UTF-8
+    // sequence) are skipped. With Caps Lock on, letters are typed with the
+    // opposite shift so the host still gets the case that was asked for.
+    typedef struct
+    {
+        tu_fifo_t ff;       // characters waiting to be typed
+        uint8_t modifier;   // modifier held by the typer
+        uint8_t keycode;    // key held by the typer, 0 = none
+        char prev_char;     // last character taken from the fifo, to fold CR LF
+        bool caps_lock;     // host's Caps Lock LED, from the keyboard output report
+
+        uint32_t typed;     // characters typed
+        uint32_t skipped;   // characters without a key
+        uint32_t overflow;  // characters that did not fit in the fifo
+    } typer_t;
+
+    void typer_init(typer_t *t, uint8_t *buffer, uint16_t depth);
+
+    // Drop pending text and forget the held key. Counters are kept
+    void typer_clear(typer_t *t);
+
+    // Queue text, return the number of bytes accepted
+    uint16_t typer_write(typer_t *t, char const *text, uint16_t len);
+
+    // Host turned Caps Lock on or off, applies from the next character
+    void typer_set_caps_lock(typer_t *t, bool on);
+
+    // Characters typer_write() still accepts
+    uint16_t typer_free(typer_t *t);
+
+    // True while text is pending or the typer still holds a key
+    bool typer_busy(typer_t *t);
+
+    // Advance to the next key state. Return false if there is nothing to
+    // report, otherwise modifier/keycode hold the state (0/0 = release)
+    bool typer_next(typer_t *t, uint8_t *modifier, uint8_t *keycode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TYPER_H_ */
@@ -25,6 +25,8 @@
 
 #include "bsp/board_api.h"
 #include "tusb.h"
+#include "usb_descriptors.h"
+#include "nkro.h"
 
 /* A combination of interfaces must have a unique product id, since PC will save device driver after the first plug.
  * Same VID/PID with different interface e.g MSC (first), then CDC (later) will possibly cause system error on PC.
@@ -72,12 +74,18 @@ uint8_t const *tud_descriptor_device_cb(void)
 
 uint8_t const desc_hid_report1[] =
     {
-        TUD_HID_REPORT_DESC_KEYBOARD()};
+        TUD_HID_REPORT_DESC_KEYBOARD_NKRO(NKRO_KEY_COUNT)};
+
+TU_VERIFY_STATIC(sizeof(nkro_report_t) <= CFG_TUD_HID_EP_BUFSIZE, "NKRO report does not fit CFG_TUD_HID_EP_BUFSIZE");
 
 uint8_t const desc_hid_report2[] =
     {
         TUD_HID_REPORT_DESC_MOUSE()};
 
+uint8_t const desc_hid_report3[] =
+    {
+        TUD_HID_REPORT_DESC_MOUSE_RELATIVE()};
+
 // Invoked when received GET HID REPORT DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
@@ -91,6 +99,10 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t itf)
   {
     return desc_hid_report2;
   }
+  else if (itf == 2)
+  {
+    return desc_hid_report3;
+  }
 
   return NULL;
 }
@@ -103,22 +115,57 @@ enum
 {
   ITF_NUM_HID1,
   ITF_NUM_HID2,
+  ITF_NUM_HID3,
   ITF_NUM_TOTAL
 };
 
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN)
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN + TUD_HID_DESC_LEN)
 
 #define EPNUM_HID1 0x81
 #define EPNUM_HID2 0x82
+#define EPNUM_HID3 0x83
 
-uint8_t const desc_configuration[] =
-    {
-        // Config number, interface count, string index, total length, attribute, power in mA
-        TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+// bInterval of each HID IN endpoint, see hid_poll_interval_set()
+static uint8_t hid_poll_interval[ITF_NUM_TOTAL] = {HID_POLL_INTERVAL_MS, HID_POLL_INTERVAL_MS, HID_POLL_INTERVAL_MS};
+
+TU_VERIFY_STATIC(HID_POLL_INTERVAL_MS == 1 || HID_POLL_INTERVAL_MS == 2 || HID_POLL_INTERVAL_MS == 4 ||
+                     HID_POLL_INTERVAL_MS == 8 || HID_POLL_INTERVAL_MS == 10,
+                 "HID_POLL_INTERVAL_MS must be 1, 2, 4, 8 or 10");
 
-        // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval
-        TUD_HID_DESCRIPTOR(ITF_NUM_HID1, 4, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report1), EPNUM_HID1, CFG_TUD_HID_EP_BUFSIZE, 10),
-        TUD_HID_DESCRIPTOR(ITF_NUM_HID2, 5, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report2), EPNUM_HID2, CFG_TUD_HID_EP_BUFSIZE, 10)};
+// Generated from hid_poll_interval on every request
+static uint8_t desc_configuration[CONFIG_TOTAL_LEN];
+
+bool hid_poll_interval_valid(uint8_t interval_ms)
+{
+  switch (interval_ms)
+  {
+  case 1:
+  case 2:
+  case 4:
+  case 8:
+  case 10:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool hid_poll_interval_set(uint8_t itf, uint8_t interval_ms)
+{
+  if (itf >= ITF_NUM_TOTAL || !hid_poll_interval_valid(interval_ms))
+  {
+    return false;
+  }
+
+  hid_poll_interval[itf] = interval_ms;
+  return true;
+}
+
+uint8_t hid_poll_interval_get(uint8_t itf)
+{
+  return (itf < ITF_NUM_TOTAL) ? hid_poll_interval[itf] : 0;
+}
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR
 // Application return pointer to descriptor
@@ -126,6 +173,21 @@ uint8_t const desc_configuration[] =
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 {
   (void)index; // for multiple configurations
+
+  uint8_t const desc[] =
+      {
+          // Config number, interface count, string index, total length, attribute, power in mA
+          TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+
+          // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval.
+          // Keyboard and relative mouse are boot interfaces for BIOS/UEFI, an absolute pointer has no boot format
+          TUD_HID_DESCRIPTOR(ITF_NUM_HID1, 4, HID_ITF_PROTOCOL_KEYBOARD, sizeof(desc_hid_report1), EPNUM_HID1, CFG_TUD_HID_EP_BUFSIZE, hid_poll_interval[ITF_NUM_HID1]),
+          TUD_HID_DESCRIPTOR(ITF_NUM_HID2, 5, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report2), EPNUM_HID2, CFG_TUD_HID_EP_BUFSIZE, hid_poll_interval[ITF_NUM_HID2]),
+          TUD_HID_DESCRIPTOR(ITF_NUM_HID3, 6, HID_ITF_PROTOCOL_MOUSE, sizeof(desc_hid_report3), EPNUM_HID3, CFG_TUD_HID_EP_BUFSIZE, hid_poll_interval[ITF_NUM_HID3])};
+
+  TU_VERIFY_STATIC(sizeof(desc) == CONFIG_TOTAL_LEN, "configuration descriptor length");
+  memcpy(desc_configuration, desc, sizeof(desc));
+
   return desc_configuration;
 }
 
@@ -151,6 +213,7 @@ char const *string_desc_arr[] =
         "123456",                   // 3: Serials will use unique ID if possible
         "CASUE USB Keyboard",       // 4: Interface 1 String
         "CASUE USB Mouse",          // 5: Interface 2 String
+        "CASUE USB Relative Mouse", // 6: Interface 3 String
 };
 
 static uint16_t _desc_str[32 + 1];
@@ -0,0 +1,29 @@
+#ifndef _USB_DESCRIPTORS_H_
+#define _USB_DESCRIPTORS_H_
+
+#include "tusb.h"
+
+// Default bInterval of every HID IN endpoint, in frames (ms at full speed).
+// Override at build time with -DPICO_HID_POLL_INTERVAL_MS=<1|2|4|8|10>
+#ifndef HID_POLL_INTERVAL_MS
+#define HID_POLL_INTERVAL_MS 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Polling intervals that can be advertised: 1, 2, 4, 8 or 10 ms
+    bool hid_poll_interval_valid(uint8_t interval_ms);
+
+    // Interval advertised for an interface by the next configuration descriptor.
+    // Takes effect after the host enumerates the device again
+    bool hid_poll_interval_set(uint8_t itf, uint8_t interval_ms);
+    uint8_t hid_poll_interval_get(uint8_t itf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _USB_DESCRIPTORS_H_ */